@@ -0,0 +1,204 @@
+/** @file
+
+  Adaptive concurrency limit.
+
+  Tracks the requests in flight to a server along with the moving averages of their latency and
+  error rate, and adjusts the number of requests allowed in flight with AIMD:
+
+  - While the latency stays within @c tolerance times the lowest latency seen, the limit grows by
+    one for every limit's worth of requests completed with the server in use, or by one for every
+    request before the first back off (slow start).
+  - When a request fails or the latency goes above that, the limit is multiplied by @c backoff, at
+    most once per average latency so a burst of slow responses counts as one signal.
+
+  The lowest latency drifts towards the average latency over @c drift_period, so the limit follows
+  a server whose normal latency changes. The class is not thread safe, the caller serializes access.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace ts
+{
+class ConcurrencyLimit
+{
+public:
+  struct Params {
+    int min_limit    = 10;
+    int max_limit    = 1000;
+    double tolerance = 2.0;  ///< Latency above this multiple of the lowest latency is overload.
+    double backoff   = 0.9;  ///< Factor applied to the limit on overload.
+    double alpha     = 0.05; ///< Weight of a new sample in the moving averages.
+    /// Time in nanoseconds for the lowest latency to move most of the way to a new normal latency.
+    int64_t drift_period = 60 * INT64_C(1000000000);
+  };
+
+  explicit ConcurrencyLimit(const Params &p) : _limit(p.min_limit) {}
+
+  /** Start a request, if there is room for it.
+
+      If @a enforce is false the request is started anyway, it is only counted as rejected.
+      If @a retry is true the request was already rejected, it is not counted again.
+   */
+  bool
+  acquire(const Params &p, bool enforce = true, bool retry = false)
+  {
+    _limit = std::max(p.min_limit, std::min(_limit, p.max_limit));
+    if (_in_flight >= _limit) {
+      if (!retry) {
+        ++_rejected;
+      }
+      if (enforce) {
+        return false;
+      }
+    }
+    ++_in_flight;
+    return true;
+  }
+
+  /// Drop a request started by @c acquire without using it as a sample.
+  void
+  cancel()
+  {
+    if (_in_flight > 0) {
+      --_in_flight;
+    }
+  }
+
+  /** Finish a request started by @c acquire.
+
+      @param now Current time in nanoseconds.
+      @param latency Latency of the request in nanoseconds, ignored if the request failed.
+      @param success Whether the server handled the request, a connection failure or a server error is not a success.
+   */
+  void
+  release(const Params &p, int64_t now, int64_t latency, bool success)
+  {
+    bool was_full = _in_flight >= _limit / 2;
+
+    if (_in_flight > 0) {
+      --_in_flight;
+    }
+    ++_requests;
+    _error_rate += p.alpha * ((success ? 0.0 : 1.0) - _error_rate);
+
+    if (success) {
+      double sample = static_cast<double>(std::max<int64_t>(latency, 1));
+      if (_latency == 0) {
+        _latency     = sample;
+        _min_latency = sample;
+      } else {
+        _latency += p.alpha * (sample - _latency);
+        if (sample < _min_latency) {
+          _min_latency = sample;
+        } else if (now > _last_sample) {
+          _min_latency += std::min(1.0, static_cast<double>(now - _last_sample) / p.drift_period) * (_latency - _min_latency);
+        }
+      }
+      _last_sample = now;
+    } else {
+      ++_errors;
+    }
+
+    if (!success || _latency > p.tolerance * _min_latency) {
+      if (now - _last_backoff >= static_cast<int64_t>(_latency)) {
+        _limit        = std::max(p.min_limit, static_cast<int>(_limit * p.backoff));
+        _last_backoff = now;
+        _slow_start   = false;
+        _completed    = 0;
+      }
+    } else if (was_full && _limit < p.max_limit) {
+      if (_slow_start || ++_completed >= _limit) {
+        ++_limit;
+        _completed = 0;
+      }
+    }
+  }
+
+  int
+  limit() const
+  {
+    return _limit;
+  }
+
+  int
+  in_flight() const
+  {
+    return _in_flight;
+  }
+
+  /// Moving average of the latency in nanoseconds, 0 before the first success.
+  double
+  latency() const
+  {
+    return _latency;
+  }
+
+  double
+  min_latency() const
+  {
+    return _min_latency;
+  }
+
+  /// Moving average of the fraction of failed requests.
+  double
+  error_rate() const
+  {
+    return _error_rate;
+  }
+
+  uint64_t
+  requests() const
+  {
+    return _requests;
+  }
+
+  uint64_t
+  errors() const
+  {
+    return _errors;
+  }
+
+  /// Number of times @c acquire found no room.
+  uint64_t
+  rejected() const
+  {
+    return _rejected;
+  }
+
+private:
+  int _limit;
+  int _in_flight        = 0;
+  int _completed        = 0; ///< Successes since the last change of the limit.
+  bool _slow_start      = true;
+  double _latency       = 0;
+  double _min_latency   = 0;
+  double _error_rate    = 0;
+  int64_t _last_backoff = INT64_MIN / 2;
+  int64_t _last_sample  = 0;
+  uint64_t _requests    = 0;
+  uint64_t _errors      = 0;
+  uint64_t _rejected    = 0;
+};
+
+} // namespace ts
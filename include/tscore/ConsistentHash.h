@@ -24,7 +24,7 @@
 #include "Hash.h"
 #include <cstdint>
 #include <iostream>
-#include <map>
+#include <vector>
 
 /*
   Helper class to be extended to make ring nodes.
@@ -37,7 +37,37 @@ struct ATSConsistentHashNode {
 
 std::ostream &operator<<(std::ostream &os, ATSConsistentHashNode &thing);
 
-typedef std::map<uint64_t, ATSConsistentHashNode *>::iterator ATSConsistentHashIter;
+/*
+  How a hash value is mapped to a node.
+
+  RING   - Each node is placed on a ring of 64 bit hash values replicas * weight times, a hash
+           value belongs to the next node on the ring.
+  MAGLEV - A lookup table with a prime number of entries is filled from a permutation per
+           node (Eisenbud et al., "Maglev: A Fast and Reliable Software Network Load
+           Balancer"). Lookups are a single table access.
+  JUMP   - Jump consistent hash (Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash
+           Algorithm"). No table at all, nodes get weight * 10 buckets.
+
+  With MAGLEV and JUMP, the first choice is followed by all nodes in a per hash value order,
+  so that the load of a down node is spread over all remaining nodes.
+ */
+enum ATSConsistentHashAlgorithm {
+  ATS_CONSISTENT_HASH_RING,
+  ATS_CONSISTENT_HASH_MAGLEV,
+  ATS_CONSISTENT_HASH_JUMP,
+};
+
+/*
+  Lookup position, to continue a lookup with the next node. This must be plain data, it is
+  zeroed along with the ParentResult holding it.
+ */
+struct ATSConsistentHashIter {
+  size_t pos;       // RING: index on the ring. Otherwise: number of nodes visited.
+  size_t first;     // MAGLEV, JUMP: the first choice.
+  size_t offset;    // MAGLEV, JUMP: the second choice.
+  size_t stride;    // MAGLEV, JUMP: distance to the following choices, 0 if not computed yet.
+  uint64_t hashval; // MAGLEV, JUMP: the hash value of the lookup.
+};
 
 /*
   TSConsistentHash requires a TSHash64 object
@@ -46,17 +76,40 @@ typedef std::map<uint64_t, ATSConsistentHashNode *>::iterator ATSConsistentHashI
  */
 
 struct ATSConsistentHash {
-  ATSConsistentHash(int r = 1024, ATSHash64 *h = nullptr);
+  ATSConsistentHash(int r = 1024, ATSHash64 *h = nullptr, ATSConsistentHashAlgorithm a = ATS_CONSISTENT_HASH_RING);
   void insert(ATSConsistentHashNode *node, float weight = 1.0, ATSHash64 *h = nullptr);
+  // Must be called after the last insert() with the MAGLEV algorithm, a no-op otherwise.
+  void build(ATSHash64 *h = nullptr);
   ATSConsistentHashNode *lookup(const char *url = nullptr, ATSConsistentHashIter *i = nullptr, bool *w = nullptr,
                                 ATSHash64 *h = nullptr);
   ATSConsistentHashNode *lookup_available(const char *url = nullptr, ATSConsistentHashIter *i = nullptr, bool *w = nullptr,
                                           ATSHash64 *h = nullptr);
   ATSConsistentHashNode *lookup_by_hashval(uint64_t hashval, ATSConsistentHashIter *i = nullptr, bool *w = nullptr);
+  ATSConsistentHashAlgorithm
+  algorithm() const
+  {
+    return algo;
+  }
   ~ATSConsistentHash();
 
 private:
+  size_t slots() const;
+  size_t positions() const;
+  ATSConsistentHashNode *slot_node(size_t slot) const;
+  void start(uint64_t hashval, ATSConsistentHashIter *iter) const;
+  ATSConsistentHashNode *current(ATSConsistentHashIter *iter) const;
+
   int replicas;
   ATSHash64 *hash;
-  std::map<uint64_t, ATSConsistentHashNode *> NodeMap;
+  ATSConsistentHashAlgorithm algo;
+
+  // RING: sorted hash values, and the node of each value at the same index.
+  std::vector<uint64_t> RingHashes;
+  std::vector<ATSConsistentHashNode *> RingNodes;
+
+  // MAGLEV, JUMP
+  std::vector<ATSConsistentHashNode *> Nodes;
+  std::vector<float> Weights;
+  std::vector<uint32_t> MaglevTable; // Index into Nodes.
+  std::vector<uint32_t> JumpBuckets; // Index into Nodes.
 };
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "tscore/Hash.h"
+#include "tscore/CryptoHash.h"
 #include <cstdint>
 
 /*
@@ -53,3 +54,31 @@ private:
   std::size_t total_len         = 0;
   bool finalized                = false;
 };
+
+/**
+  128 bit SipHash-2-4 as a crypto context, for the cache key hash.
+
+  This is several times faster than MD5 on URL sized input. Cache keys must be the same on every
+  run, so the default key is zero and the hash is not used as a MAC.
+ */
+class SipHashContext : public ats::CryptoContextBase
+{
+public:
+  SipHashContext();
+  SipHashContext(const unsigned char key[16]);
+  /// Update the hash with @a data of @a length bytes.
+  bool update(void const *data, int length) override;
+  /// Finalize and extract the @a hash.
+  bool finalize(CryptoHash &hash) override;
+
+private:
+  void init(std::uint64_t k0, std::uint64_t k1);
+
+  std::uint64_t v0;
+  std::uint64_t v1;
+  std::uint64_t v2;
+  std::uint64_t v3;
+  std::uint64_t total_len;
+  unsigned char block_buffer[8];
+  int block_buffer_len;
+};
@@ -57,8 +57,9 @@ namespace detail
     Metric _max; ///< Maximum value in span.
   };
 
-  class Ip4Map; // Forward declare.
-  class Ip6Map; // Forward declare.
+  class Ip4Map;      // Forward declare.
+  class Ip6Map;      // Forward declare.
+  class IpMapFrozen; // Forward declare.
 } // namespace detail
 } // namespace ts
 
@@ -90,6 +91,10 @@ namespace detail
     of disjoint ranges. Marking and unmarking can take O(log n) and
     may require memory allocation / deallocation although this is
     minimized.
+
+    A map which is no longer changed, such as one loaded from a
+    configuration file, can be frozen with @c freeze for faster
+    lookups.
 */
 
 class IpMap
@@ -330,6 +335,21 @@ public:
   */
   self &clear();
 
+  /** Compile the map into a read optimized form.
+
+      The ranges are copied into flat sorted arrays with a direct index on the leading address
+      bits, so that @c contains is a table lookup and a short binary search over contiguous memory
+      instead of a tree descent. Any later @c mark, @c unmark, @c fill or @c clear discards the
+      compiled form.
+
+      @note The client data is copied, so any @c Node::setData must be done before this.
+      @return This object.
+  */
+  self &freeze();
+
+  /// @return @c true if the map is frozen.
+  bool isFrozen() const;
+
   /// Iterator for first element.
   iterator begin() const;
   /// Iterator past last element.
@@ -354,8 +374,12 @@ protected:
   /// @return The IPv6 map.
   ts::detail::Ip6Map *force6();
 
-  ts::detail::Ip4Map *_m4; ///< Map of IPv4 addresses.
-  ts::detail::Ip6Map *_m6; ///< Map of IPv6 addresses.
+  /// Discard the compiled form, the map is changed.
+  void thaw();
+
+  ts::detail::Ip4Map *_m4;          ///< Map of IPv4 addresses.
+  ts::detail::Ip6Map *_m6;          ///< Map of IPv6 addresses.
+  ts::detail::IpMapFrozen *_frozen; ///< Compiled form of both maps, if frozen.
 };
 
 inline IpMap &
@@ -458,4 +482,10 @@ inline IpMap::iterator::pointer IpMap::iterator::operator->() const
   return _node;
 }
 
-inline IpMap::IpMap() : _m4(nullptr), _m6(nullptr) {}
+inline bool
+IpMap::isFrozen() const
+{
+  return _frozen != nullptr;
+}
+
+inline IpMap::IpMap() : _m4(nullptr), _m6(nullptr), _frozen(nullptr) {}
@@ -0,0 +1,153 @@
+/** @file
+
+  Log-linear histogram.
+
+  Values below 2 ^ SUB_BITS have a bucket each. Above that, every power of two is split into
+  2 ^ SUB_BITS buckets of equal width, so the relative error of a value read back from the
+  histogram is at most 2 ^ -SUB_BITS. This is the bucketing of HdrHistogram.
+
+  The class is a plain aggregate of counters without constructors, so it can live in zeroed
+  memory such as the per thread storage of an EThread. Only one thread may call @c record on a
+  histogram, other threads may read it at any time.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace ts
+{
+template <unsigned SUB_BITS = 3, unsigned MAX_BITS = 36> struct LogLinearHistogram {
+  static_assert(SUB_BITS < MAX_BITS && MAX_BITS < 64, "invalid histogram layout");
+
+  static constexpr unsigned SUB_BUCKETS = 1U << SUB_BITS;
+  static constexpr unsigned N_BUCKETS   = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+  /// Larger values are counted as this value.
+  static constexpr uint64_t MAX_VALUE = (uint64_t(1) << MAX_BITS) - 1;
+
+  /// The bucket of @a value.
+  static unsigned
+  bucket(uint64_t value)
+  {
+    if (value > MAX_VALUE) {
+      value = MAX_VALUE;
+    }
+    if (value < SUB_BUCKETS) {
+      return static_cast<unsigned>(value);
+    }
+    unsigned shift = (63 - __builtin_clzll(value)) - SUB_BITS;
+    return shift * SUB_BUCKETS + static_cast<unsigned>(value >> shift);
+  }
+
+  /// The smallest value in bucket @a idx.
+  static uint64_t
+  lower_bound(unsigned idx)
+  {
+    if (idx < SUB_BUCKETS) {
+      return idx;
+    }
+    unsigned shift = idx / SUB_BUCKETS - 1;
+    return static_cast<uint64_t>(idx % SUB_BUCKETS + SUB_BUCKETS) << shift;
+  }
+
+  /// The largest value in bucket @a idx.
+  static uint64_t
+  upper_bound(unsigned idx)
+  {
+    return lower_bound(idx + 1) - 1;
+  }
+
+  void
+  record(uint64_t value)
+  {
+    ++counts[bucket(value)];
+  }
+
+  void
+  clear()
+  {
+    for (auto &c : counts) {
+      c = 0;
+    }
+  }
+
+  /// Add the counts of @a that to this histogram.
+  void
+  add(const LogLinearHistogram &that)
+  {
+    for (unsigned i = 0; i < N_BUCKETS; ++i) {
+      counts[i] += that.counts[i];
+    }
+  }
+
+  /// Remove the counts of @a that, which must be an earlier copy of this histogram.
+  void
+  subtract(const LogLinearHistogram &that)
+  {
+    for (unsigned i = 0; i < N_BUCKETS; ++i) {
+      counts[i] = counts[i] > that.counts[i] ? counts[i] - that.counts[i] : 0;
+    }
+  }
+
+  uint64_t
+  count() const
+  {
+    uint64_t n = 0;
+    for (auto c : counts) {
+      n += c;
+    }
+    return n;
+  }
+
+  /** The value below which @a percent of the recorded values are.
+
+      This is the largest value of the bucket holding the value of that rank, 0 if the histogram
+      is empty.
+   */
+  uint64_t
+  percentile(double percent) const
+  {
+    uint64_t total = count();
+    if (total == 0) {
+      return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+    if (rank < 1) {
+      rank = 1;
+    } else if (rank > total) {
+      rank = total;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < N_BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen >= rank) {
+        return upper_bound(i);
+      }
+    }
+    return MAX_VALUE;
+  }
+
+  uint64_t counts[N_BUCKETS];
+};
+
+} // namespace ts
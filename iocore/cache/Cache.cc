@@ -83,6 +83,7 @@ int cache_config_mutex_retry_delay             = 2;
 int cache_read_while_writer_retry_delay        = 50;
 int cache_config_read_while_writer_max_retries = 10;
 static int enable_cache_empty_http_doc         = 0;
+static int cache_config_url_hash               = 0;
 /// Fix up a specific known problem with the 4.2.0 release.
 /// Not used for stripes with a cache version later than 4.2.0.
 int cache_config_compatibility_4_2_0_fixup = 1;
@@ -1186,6 +1187,21 @@ vol_init_dir(Vol *d)
   }
 }
 
+/// Check if the keys in a stripe were made with a different URL hash than the configured one.
+static bool
+vol_url_hash_changed(VolHeaderFooter const *header)
+{
+  if (header->url_hash == URLHashContext::UNSPECIFIED) {
+    // Written before the hash was recorded, with the default hash (or MMH, see CB_After_Cache_Init).
+#if TS_ENABLE_FIPS == 0
+    return URLHashContext::type() == URLHashContext::SIPHASH;
+#else
+    return false;
+#endif
+  }
+  return header->url_hash != static_cast<uint32_t>(URLHashContext::type());
+}
+
 void
 vol_clear_init(Vol *d)
 {
@@ -1195,6 +1211,7 @@ vol_clear_init(Vol *d)
   d->header->magic             = VOL_MAGIC;
   d->header->version.ink_major = CACHE_DB_MAJOR_VERSION;
   d->header->version.ink_minor = CACHE_DB_MINOR_VERSION;
+  d->header->url_hash          = URLHashContext::type();
   d->scan_pos = d->header->agg_pos = d->header->write_pos = d->start;
   d->header->last_write_pos                               = d->header->write_pos;
   d->header->phase                                        = 0;
@@ -1374,6 +1391,11 @@ Vol::handle_dir_read(int event, void *data)
     clear_dir();
     return EVENT_DONE;
   }
+  if (vol_url_hash_changed(header)) {
+    Warning("cache directory '%s' has keys from a different URL hash, clearing", hash_text.get());
+    clear_dir();
+    return EVENT_DONE;
+  }
   CHECK_DIR(this);
 
   sector_size = header->sector_size;
@@ -3223,6 +3245,16 @@ ink_cache_init(ModuleVersion v)
   REC_EstablishStaticConfigInt32(cache_config_enable_checksum, "proxy.config.cache.enable_checksum");
   Debug("cache_init", "proxy.config.cache.enable_checksum = %d", cache_config_enable_checksum);
 
+  // The stripes are checked against this when they are opened, so it must be set first. Only the
+  // keys of URLs change, the stripe ids and the other hashes keep the global CryptoContext::Setting.
+  REC_ReadConfigInt32(cache_config_url_hash, "proxy.config.cache.url_hash");
+#if TS_ENABLE_FIPS == 0
+  if (cache_config_url_hash == 1) {
+    URLHashContext::Setting = URLHashContext::SIPHASH;
+  }
+#endif
+  Debug("cache_init", "proxy.config.cache.url_hash = %d", cache_config_url_hash);
+
   REC_EstablishStaticConfigInt32(cache_config_alt_rewrite_max_size, "proxy.config.cache.alt_rewrite_max_size");
   Debug("cache_init", "proxy.config.cache.alt_rewrite_max_size = %d", cache_config_alt_rewrite_max_size);
 
@@ -88,7 +88,7 @@ struct VolHeaderFooter {
   uint32_t write_serial;
   uint32_t dirty;
   uint32_t sector_size;
-  uint32_t unused; // pad out to 8 byte boundary
+  uint32_t url_hash; // CryptoContext::HashType of the cache keys, zero before this was recorded
   uint16_t freelist[1];
 };
 
@@ -29,6 +29,7 @@
 ****************************************************************************/
 
 #include "P_EventSystem.h"
+#include "I_EventTiming.h"
 
 void
 ink_event_system_init(ModuleVersion v)
@@ -43,6 +44,9 @@ ink_event_system_init(ModuleVersion v)
 
   REC_EstablishStaticConfigInt32(thread_freelist_low_watermark, "proxy.config.allocator.thread_freelist_low_watermark");
 
+  REC_EstablishStaticConfigInt32(event_timing_enabled, "proxy.config.eventloop.timing");
+  REC_EstablishStaticConfigInt32(event_timing_slow_threshold_ms, "proxy.config.eventloop.slow_event_threshold_ms");
+
   REC_ReadConfigInteger(config_max_iobuffer_size, "proxy.config.io.max_buffer_size");
 
   max_iobuffer_size = buffer_size_to_index(config_max_iobuffer_size, DEFAULT_BUFFER_SIZES - 1);
@@ -0,0 +1,192 @@
+/** @file
+
+  Timing of event dispatch.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "P_EventSystem.h"
+#include "I_EventTiming.h"
+
+#include <algorithm>
+#include <vector>
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+int event_timing_enabled           = 0;
+int event_timing_slow_threshold_ms = 10;
+
+namespace
+{
+constexpr int N_HANDLER_BITS = 9;
+constexpr int MAX_PROBES     = 8;
+
+static_assert((1 << N_HANDLER_BITS) == EventTiming::N_HANDLERS, "handler table size mismatch");
+
+// Name of a handler, from the symbol table if there is no debug name.
+std::string
+handler_name(uintptr_t key, const char *name)
+{
+  char buf[64];
+
+  if (name) {
+    return name;
+  }
+  if (key == 0) {
+    return "other";
+  }
+  // Itanium ABI: an odd value is the vtable offset of a virtual function, plus one.
+  if (key & 1) {
+    snprintf(buf, sizeof(buf), "virtual handler at vtable offset %" PRIuPTR, key - 1);
+    return buf;
+  }
+
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void *>(key), &info) && info.dli_sname) {
+    int status      = 0;
+    char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string result(status == 0 && demangled ? demangled : info.dli_sname);
+    ats_free(demangled);
+    return result;
+  }
+
+  snprintf(buf, sizeof(buf), "0x%" PRIxPTR, key);
+  return buf;
+}
+} // namespace
+
+uintptr_t
+EventTiming::handler_key(const Continuation *c, const char **name)
+{
+  uintptr_t key;
+
+  // The first word of a pointer to member function is the code address of a non virtual function.
+  static_assert(sizeof(c->handler) >= sizeof(key), "unexpected pointer to member function layout");
+  memcpy(&key, &c->handler, sizeof(key));
+#ifdef DEBUG
+  *name = c->handler_name;
+#else
+  *name = nullptr;
+#endif
+  return key;
+}
+
+void
+EventTiming::record(uintptr_t key, const char *name, int event, ink_hrtime start, ink_hrtime duration)
+{
+  Handler *h   = &other;
+  unsigned idx = static_cast<unsigned>((key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - N_HANDLER_BITS));
+
+  for (int probe = 0; probe < MAX_PROBES; ++probe) {
+    Handler &slot = handlers[(idx + probe) & (N_HANDLERS - 1)];
+    if (slot.key == key) {
+      h = &slot;
+      break;
+    }
+    if (slot.key == 0) {
+      // Readers may look at the slot as soon as the key is set.
+      slot.name = name;
+      slot.key  = key;
+      h         = &slot;
+      break;
+    }
+  }
+
+  ++h->count;
+  h->total += duration;
+  if (duration > h->max) {
+    h->max = duration;
+  }
+
+  if (event_timing_slow_threshold_ms > 0 && duration >= HRTIME_MSECONDS(event_timing_slow_threshold_ms)) {
+    SlowEvent &slow = slow_events[n_slow_events % N_SLOW_EVENTS];
+    slow.start      = start;
+    slow.duration   = duration;
+    slow.key        = key;
+    slow.name       = name;
+    slow.event      = event;
+    ++n_slow_events;
+  }
+}
+
+void
+EventTiming::dump(std::string &out, int top) const
+{
+  char line[512];
+  std::vector<const Handler *> sorted;
+
+  for (const Handler &h : handlers) {
+    if (h.key != 0 && h.count > 0) {
+      sorted.push_back(&h);
+    }
+  }
+  if (other.count > 0) {
+    sorted.push_back(&other);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const Handler *a, const Handler *b) { return a->total > b->total; });
+  if (static_cast<int>(sorted.size()) > top) {
+    sorted.resize(top);
+  }
+
+  snprintf(line, sizeof(line), "  %-12s %-12s %-10s %-8s %s\n", "calls", "total ms", "avg us", "max ms", "handler");
+  out += line;
+  for (const Handler *h : sorted) {
+    snprintf(line, sizeof(line), "  %-12" PRIu64 " %-12.1f %-10.1f %-8.1f %s\n", h->count,
+             static_cast<double>(h->total) / HRTIME_MSECOND, static_cast<double>(h->total) / h->count / HRTIME_USECOND,
+             static_cast<double>(h->max) / HRTIME_MSECOND, handler_name(h->key, h->name).c_str());
+    out += line;
+  }
+
+  uint64_t n = n_slow_events;
+  if (n > 0) {
+    ink_hrtime now = ink_get_hrtime_internal();
+
+    snprintf(line, sizeof(line), "  %" PRIu64 " slow events, most recent first:\n", n);
+    out += line;
+    for (uint64_t i = 0; i < std::min<uint64_t>(n, N_SLOW_EVENTS); ++i) {
+      const SlowEvent &slow = slow_events[(n - 1 - i) % N_SLOW_EVENTS];
+      snprintf(line, sizeof(line), "  %.3fs ago took %.1f ms, event %d, %s\n",
+               static_cast<double>(now - slow.start) / HRTIME_SECOND, static_cast<double>(slow.duration) / HRTIME_MSECOND,
+               slow.event, handler_name(slow.key, slow.name).c_str());
+      out += line;
+    }
+  }
+}
+
+void
+event_timing_dump(int top)
+{
+  if (!event_timing_enabled) {
+    Note("event timing is disabled, set proxy.config.eventloop.timing to enable it");
+    return;
+  }
+
+  for (int g = 0; g < eventProcessor.n_thread_groups; ++g) {
+    int i = 0;
+    for (EThread *t : eventProcessor.active_group_threads(g)) {
+      const EventTiming *timing = t->event_timing;
+      if (timing) {
+        std::string out;
+        timing->dump(out, top);
+        Note("event timing of thread %s %d:\n%s", eventProcessor.thread_group[g]._name.c_str(), i, out.c_str());
+      }
+      ++i;
+    }
+  }
+}
@@ -45,6 +45,7 @@ struct EventIO;
 class ServerSessionPool;
 class Event;
 class Continuation;
+struct EventTiming;
 
 enum ThreadType {
   REGULAR = 0,
@@ -354,6 +355,9 @@ public:
 
   ServerSessionPool *server_session_pool = nullptr;
 
+  /// Dispatch timing, allocated when a regular thread starts.
+  EventTiming *event_timing = nullptr;
+
   /** Default handler used until it is overridden.
 
       This uses the cond var wait in @a ExternalQueue.
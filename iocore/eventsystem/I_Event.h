@@ -207,7 +207,7 @@ public:
   unsigned int in_the_priority_queue : 1;
   unsigned int immediate : 1;
   unsigned int globally_allocated : 1;
-  unsigned int in_heap : 4;
+  unsigned int in_heap : 12; ///< Slot of the event in the PriorityEventQueue.
   int callback_event = 0;
 
   ink_hrtime timeout_at = 0;
@@ -0,0 +1,107 @@
+/** @file
+
+  Timing of event dispatch.
+
+  When proxy.config.eventloop.timing is set, each event thread times the handlers it calls. It
+  keeps per handler call counts and times, the most recent events which took longer than
+  proxy.config.eventloop.slow_event_threshold_ms and a histogram of how late scheduled events
+  were dispatched. Handlers are keyed by the code address of their member function, names are
+  looked up when the data is dumped.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "tscore/ink_hrtime.h"
+#include "tscore/LogLinearHistogram.h"
+
+class Continuation;
+
+/// Event timing data of one thread, written only by that thread.
+struct EventTiming {
+  static constexpr int N_HANDLERS    = 512; ///< Handler slots, a power of 2. Later handlers count as "other".
+  static constexpr int N_SLOW_EVENTS = 64;  ///< Slow events kept.
+
+  struct Handler {
+    uintptr_t key;    ///< Code address of the handler, 0 for an unused slot.
+    const char *name; ///< Name of the handler, in debug builds.
+    uint64_t count;
+    ink_hrtime total;
+    ink_hrtime max;
+  };
+
+  struct SlowEvent {
+    ink_hrtime start;
+    ink_hrtime duration;
+    uintptr_t key;
+    const char *name;
+    int event;
+  };
+
+  /// How late scheduled events are dispatched, in microseconds.
+  ts::LogLinearHistogram<3, 36> dispatch_delay;
+
+  Handler handlers[N_HANDLERS];
+  Handler other;
+
+  SlowEvent slow_events[N_SLOW_EVENTS];
+  uint64_t n_slow_events; ///< Total, the next one goes to slot n_slow_events % N_SLOW_EVENTS.
+
+  int depth; ///< Accounted calls in progress, a nested call is part of the outermost one.
+
+  /// The key and debug name of the current handler of @a c.
+  static uintptr_t handler_key(const Continuation *c, const char **name);
+
+  /// Account a handler call of @a duration which started at @a start.
+  void record(uintptr_t key, const char *name, int event, ink_hrtime start, ink_hrtime duration);
+
+  /// Call the handler of @a c for @a event through @a f, and account it.
+  template <typename F>
+  void
+  call(const Continuation *c, int event, F &&f)
+  {
+    if (depth > 0) {
+      f();
+      return;
+    }
+
+    const char *name = nullptr;
+    uintptr_t key    = handler_key(c, &name);
+    ink_hrtime start = ink_get_hrtime_internal();
+
+    ++depth;
+    f();
+    --depth;
+    record(key, name, event, start, ink_get_hrtime_internal() - start);
+  }
+
+  /// Add a human readable report of this thread to @a out.
+  void dump(std::string &out, int top) const;
+};
+
+/// proxy.config.eventloop.timing
+extern int event_timing_enabled;
+/// proxy.config.eventloop.slow_event_threshold_ms
+extern int event_timing_slow_threshold_ms;
+
+/// Log the timing data of all event threads, with the @a top handlers of each thread by total time.
+void event_timing_dump(int top = 20);
@@ -2,6 +2,12 @@
 
   Queue of Events sorted by the "at_timeout" field
 
+  The queue is a hierarchical timing wheel. Time is counted in ticks of @c TICK. Level 0 has a slot
+  for each of the next @c SLOTS ticks, a slot of level n covers @c SLOTS ^ n ticks. An event goes in
+  the lowest level which reaches its timeout and moves down (cascades) when the current tick reaches
+  the start of its slot, so an event is moved at most once per level. Inserting and removing an
+  event is O(1), the events of a level 0 slot expire together.
+
   @section license License
 
   Licensed to the Apache Software Foundation (ASF) under one
@@ -26,63 +32,30 @@
 #include "tscore/ink_platform.h"
 #include "I_Event.h"
 
-// <5ms, 10, 20, 40, 80, 160, 320, 640, 1280, 2560, 5120
-#define N_PQ_LIST 10
-#define PQ_BUCKET_TIME(_i) (HRTIME_MSECONDS(5) << (_i))
-
 class EThread;
 
 struct PriorityEventQueue {
-  Que(Event, link) after[N_PQ_LIST];
+  static constexpr int LEVEL_BITS        = 8;
+  static constexpr int SLOTS             = 1 << LEVEL_BITS;
+  static constexpr int LEVELS            = 4; // 2^32 ticks, longer timeouts are cascaded again.
+  static constexpr int WORDS             = SLOTS / 64;
+  static constexpr ink_hrtime TICK       = HRTIME_MSECOND;
+  static constexpr unsigned int IN_READY = LEVELS * SLOTS; ///< @c Event::in_heap of an expired event.
+
+  Que(Event, link) ready; ///< Expired events, in order of expiration.
+  Que(Event, link) slots[LEVELS][SLOTS];
+  uint64_t occupied[LEVELS][WORDS]; ///< Bit map of the slots which are not empty.
+  uint64_t current_tick;            ///< All ticks up to this one have expired.
   ink_hrtime last_check_time;
-  uint32_t last_check_buckets;
 
   void
   enqueue(Event *e, ink_hrtime now)
   {
-    ink_hrtime t = e->timeout_at - now;
-    int i        = 0;
-    // equivalent but faster
-    if (t <= PQ_BUCKET_TIME(3)) {
-      if (t <= PQ_BUCKET_TIME(1)) {
-        if (t <= PQ_BUCKET_TIME(0)) {
-          i = 0;
-        } else {
-          i = 1;
-        }
-      } else {
-        if (t <= PQ_BUCKET_TIME(2)) {
-          i = 2;
-        } else {
-          i = 3;
-        }
-      }
-    } else {
-      if (t <= PQ_BUCKET_TIME(7)) {
-        if (t <= PQ_BUCKET_TIME(5)) {
-          if (t <= PQ_BUCKET_TIME(4)) {
-            i = 4;
-          } else {
-            i = 5;
-          }
-        } else {
-          if (t <= PQ_BUCKET_TIME(6)) {
-            i = 6;
-          } else {
-            i = 7;
-          }
-        }
-      } else {
-        if (t <= PQ_BUCKET_TIME(8)) {
-          i = 8;
-        } else {
-          i = 9;
-        }
-      }
+    if (static_cast<uint64_t>(now / TICK) < current_tick) {
+      rebase(now);
     }
     e->in_the_priority_queue = 1;
-    e->in_heap               = i;
-    after[i].enqueue(e);
+    insert(e);
   }
 
   void
@@ -90,14 +63,23 @@ struct PriorityEventQueue {
   {
     ink_assert(e->in_the_priority_queue);
     e->in_the_priority_queue = 0;
-    after[e->in_heap].remove(e);
+    if (e->in_heap == IN_READY) {
+      ready.remove(e);
+    } else {
+      int level = e->in_heap / SLOTS;
+      int slot  = e->in_heap % SLOTS;
+      slots[level][slot].remove(e);
+      if (slots[level][slot].head == nullptr) {
+        occupied[level][slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+      }
+    }
   }
 
   Event *
   dequeue_ready(ink_hrtime t)
   {
     (void)t;
-    Event *e = after[0].dequeue();
+    Event *e = ready.dequeue();
     if (e) {
       ink_assert(e->in_the_priority_queue);
       e->in_the_priority_queue = 0;
@@ -105,18 +87,47 @@ struct PriorityEventQueue {
     return e;
   }
 
+  /// Expire the events due at @a now and cascade the levels above, freeing cancelled events.
   void check_ready(ink_hrtime now, EThread *t);
 
-  ink_hrtime
-  earliest_timeout()
+  ink_hrtime earliest_timeout();
+
+  PriorityEventQueue();
+
+private:
+  /// Put @a e in the slot for its timeout, relative to the current tick.
+  void
+  insert(Event *e)
   {
-    for (int i = 0; i < N_PQ_LIST; i++) {
-      if (after[i].head) {
-        return last_check_time + (PQ_BUCKET_TIME(i) / 2);
-      }
+    // Round up, an event does not expire before its timeout.
+    uint64_t tick = (e->timeout_at + TICK - 1) / TICK;
+    if (tick <= current_tick) {
+      e->in_heap = IN_READY;
+      ready.enqueue(e);
+      return;
+    }
+
+    uint64_t delta = tick - current_tick;
+    int level      = 0;
+    while (level < LEVELS - 1 && (delta >> (LEVEL_BITS * (level + 1))) != 0) {
+      ++level;
     }
-    return last_check_time + HRTIME_FOREVER;
+    if ((delta >> (LEVEL_BITS * LEVELS)) != 0) {
+      tick = current_tick + (UINT64_C(1) << (LEVEL_BITS * LEVELS)) - 1;
+    }
+    int slot   = (tick >> (LEVEL_BITS * level)) & (SLOTS - 1);
+    e->in_heap = level * SLOTS + slot;
+    slots[level][slot].enqueue(e);
+    occupied[level][slot / 64] |= UINT64_C(1) << (slot % 64);
   }
 
-  PriorityEventQueue();
+  /// The first slot of @a level which is not empty, starting at @a from and wrapping around, or -1.
+  int find_slot(int level, int from) const;
+
+  /** Move the wheel back to @a now, after the clock stepped back.
+
+      The ticks only move forward, the timeouts of the pending events are moved back by the step and
+      they expire as far from @a now as they were from the current tick.
+   */
+  void rebase(ink_hrtime now);
 };
@@ -0,0 +1,75 @@
+/** @file
+
+  Work stealing pool for relocatable work.
+
+  Work scheduled on this pool must not depend on the thread it runs on, for instance compressing
+  or transforming a chunk of data, formatting log entries or parsing a document. Each ET_WORK
+  thread has a deque of pending work. A thread runs its own work newest first, and when it runs
+  out it takes the oldest work of another thread, so a thread busy with a long item does not hold
+  up the work queued behind it. Work submitted from an ET_WORK thread goes to the deque of that
+  thread, other work is spread round robin.
+
+  The ET_WORK threads are regular event threads, work can schedule events on @c this_ethread()
+  as usual. Delayed and periodic work is scheduled on the ET_WORK timers and is not moved.
+
+  If proxy.config.work_threads is 0 no threads are started and work goes to ET_TASK.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include "I_EventSystem.h"
+
+extern EventType ET_WORK;
+
+class WorkThread;
+
+class WorkProcessor : public Processor
+{
+public:
+  /// Start @a work_threads ET_WORK threads, must be called after the task processor is started.
+  int start(int work_threads, size_t stacksize = DEFAULT_STACKSIZE) override;
+
+  /// Run @a c on the pool as soon as possible.
+  Event *schedule_imm(Continuation *c, int callback_event = EVENT_IMMEDIATE, void *cookie = nullptr);
+  /// Run @a c on an ET_WORK thread after @a atimeout.
+  Event *schedule_in(Continuation *c, ink_hrtime atimeout, int callback_event = EVENT_INTERVAL, void *cookie = nullptr);
+  /// Run @a c on an ET_WORK thread every @a aperiod.
+  Event *schedule_every(Continuation *c, ink_hrtime aperiod, int callback_event = EVENT_INTERVAL, void *cookie = nullptr);
+
+  /// Number of ET_WORK threads, 0 if the pool is not running.
+  int
+  n_threads() const
+  {
+    return _n_threads;
+  }
+
+private:
+  /// The worker of the calling thread, if it is an ET_WORK thread.
+  WorkThread *current() const;
+
+  WorkThread **_threads = nullptr;
+  int _n_threads        = 0;
+  unsigned _next        = 0; ///< Round robin position for work from other threads.
+
+  friend class WorkThread;
+};
+
+extern WorkProcessor workProcessor;
@@ -1,6 +1,6 @@
 /** @file
 
-  Queue of Events sorted by the "timeout_at" field impl as binary heap
+  Queue of Events sorted by the "timeout_at" field impl as hierarchical timing wheel
 
   @section license License
 
@@ -25,40 +25,140 @@
 
 PriorityEventQueue::PriorityEventQueue()
 {
-  last_check_time    = Thread::get_hrtime_updated();
-  last_check_buckets = last_check_time / PQ_BUCKET_TIME(0);
+  memset(occupied, 0, sizeof(occupied));
+  last_check_time = Thread::get_hrtime_updated();
+  current_tick    = last_check_time / TICK;
+}
+
+int
+PriorityEventQueue::find_slot(int level, int from) const
+{
+  const uint64_t *bits = occupied[level];
+  int w                = from / 64;
+  uint64_t word        = bits[w] & (~UINT64_C(0) << (from % 64));
+
+  for (int i = 0; i <= WORDS; ++i) {
+    if (word) {
+      return w * 64 + __builtin_ctzll(word);
+    }
+    w    = (w + 1) % WORDS;
+    word = bits[w];
+    if (i == WORDS - 1) {
+      // Back at the first word, only the slots before the start are left.
+      word &= ~(~UINT64_C(0) << (from % 64));
+    }
+  }
+  return -1;
+}
+
+void
+PriorityEventQueue::rebase(ink_hrtime now)
+{
+  uint64_t target  = now / TICK;
+  ink_hrtime shift = static_cast<ink_hrtime>(current_tick - target) * TICK;
+  Que(Event, link) pending;
+  Event *e;
+
+  Warning("clock stepped back by %" PRId64 " ms, moving back the timeouts of the pending events", shift / HRTIME_MSECOND);
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      pending.append(slots[level][slot]);
+      slots[level][slot].clear();
+    }
+  }
+  memset(occupied, 0, sizeof(occupied));
+
+  current_tick    = target;
+  last_check_time = now;
+  while ((e = pending.dequeue()) != nullptr) {
+    e->timeout_at -= shift;
+    insert(e);
+  }
 }
 
 void
 PriorityEventQueue::check_ready(ink_hrtime now, EThread *t)
 {
-  int i, j, k = 0;
-  uint32_t check_buckets = (uint32_t)(now / PQ_BUCKET_TIME(0));
-  uint32_t todo_buckets  = check_buckets ^ last_check_buckets;
-  last_check_time        = now;
-  last_check_buckets     = check_buckets;
-  todo_buckets &= ((1 << (N_PQ_LIST - 1)) - 1);
-  while (todo_buckets) {
-    k++;
-    todo_buckets >>= 1;
+  uint64_t target = now / TICK;
+  if (target < current_tick) {
+    rebase(now);
   }
-  for (i = 1; i <= k; i++) {
-    Event *e;
-    Que(Event, link) q = after[i];
-    after[i].clear();
-    while ((e = q.dequeue()) != nullptr) {
-      if (e->cancelled) {
-        e->in_the_priority_queue = 0;
-        e->cancelled             = 0;
-        EVENT_FREE(e, eventAllocator, t);
-      } else {
-        ink_hrtime tt = e->timeout_at - now;
-        for (j = i; j > 0 && tt <= PQ_BUCKET_TIME(j - 1);) {
-          j--;
+  last_check_time = now;
+
+  while (current_tick < target) {
+    uint64_t tick = current_tick + 1;
+    int slot      = tick & (SLOTS - 1);
+
+    if (slot != 0) {
+      // Skip the empty level 0 slots, up to the next cascade.
+      uint64_t limit = std::min(target, tick | (SLOTS - 1));
+      int next       = find_slot(0, slot);
+      if (next < slot || tick + (next - slot) > limit) {
+        current_tick = limit;
+        continue;
+      }
+      tick += next - slot;
+      slot = next;
+    }
+    current_tick = tick;
+
+    // Cascade the levels whose slot starts at this tick, the highest first.
+    for (int level = LEVELS - 1; level > 0; --level) {
+      if ((tick & ((UINT64_C(1) << (LEVEL_BITS * level)) - 1)) == 0) {
+        int cascade = (tick >> (LEVEL_BITS * level)) & (SLOTS - 1);
+        Que(Event, link) q = slots[level][cascade];
+        Event *e;
+
+        slots[level][cascade].clear();
+        occupied[level][cascade / 64] &= ~(UINT64_C(1) << (cascade % 64));
+        while ((e = q.dequeue()) != nullptr) {
+          if (e->cancelled) {
+            e->in_the_priority_queue = 0;
+            e->cancelled             = 0;
+            EVENT_FREE(e, eventAllocator, t);
+          } else {
+            insert(e);
+          }
         }
-        e->in_heap = j;
-        after[j].enqueue(e);
       }
     }
+
+    // The whole slot expires at once.
+    Que(Event, link) &expired = slots[0][slot];
+    if (expired.head) {
+      for (Event *e = expired.head; e; e = e->link.next) {
+        e->in_heap = IN_READY;
+      }
+      ready.append(expired);
+      expired.clear();
+      occupied[0][slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+    }
+  }
+}
+
+ink_hrtime
+PriorityEventQueue::earliest_timeout()
+{
+  if (ready.head) {
+    return last_check_time;
+  }
+
+  uint64_t earliest = UINT64_MAX;
+  for (int level = 0; level < LEVELS; ++level) {
+    // A level 0 slot expires at its tick, the slot of a higher level cascades at its first tick.
+    uint64_t base = current_tick >> (LEVEL_BITS * level);
+    int start     = (base + 1) & (SLOTS - 1);
+    int slot      = find_slot(level, start);
+    if (slot >= 0) {
+      uint64_t ahead = (slot - base) & (SLOTS - 1);
+      if (ahead == 0) {
+        ahead = SLOTS;
+      }
+      earliest = std::min(earliest, (base + ahead) << (LEVEL_BITS * level));
+    }
+  }
+  if (earliest == UINT64_MAX) {
+    return last_check_time + HRTIME_FOREVER;
   }
+  return earliest * TICK;
 }
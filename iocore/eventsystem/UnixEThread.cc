@@ -27,6 +27,7 @@
 //
 /////////////////////////////////////////////////////////////////////
 #include "P_EventSystem.h"
+#include "I_EventTiming.h"
 
 #if HAVE_EVENTFD
 #include <sys/eventfd.h>
@@ -128,7 +129,15 @@ EThread::process_event(Event *e, int calling_code)
       return;
     }
     Continuation *c_temp = e->continuation;
-    e->continuation->handleEvent(calling_code, e);
+    if (unlikely(event_timing_enabled) && event_timing) {
+      if (e->timeout_at > 0) {
+        event_timing->dispatch_delay.record(std::max<ink_hrtime>(0, this->get_hrtime_updated() - e->timeout_at) /
+                                            HRTIME_USECOND);
+      }
+      event_timing->call(e->continuation, calling_code, [&]() { e->continuation->handleEvent(calling_code, e); });
+    } else {
+      e->continuation->handleEvent(calling_code, e);
+    }
     ink_assert(!e->in_the_priority_queue);
     ink_assert(c_temp == e->continuation);
     MUTEX_RELEASE(lock);
@@ -322,6 +331,8 @@ EThread::execute()
 
   switch (tt) {
   case REGULAR: {
+    // Up front, proxy.config.eventloop.timing can be turned on at any time.
+    event_timing = new EventTiming();
     this->execute_regular();
     break;
   }
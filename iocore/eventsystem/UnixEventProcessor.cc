@@ -22,6 +22,7 @@
  */
 
 #include "P_EventSystem.h" /* MAGIC_EDITING_TAG */
+#include "I_EventTiming.h"
 #include <sched.h>
 #if TS_USE_HWLOC
 #if HAVE_ALLOCA_H
@@ -118,6 +119,62 @@ EventMetricStatSync(const char *, RecDataT, RecData *, RecRawStatBlock *rsb, int
   return REC_ERR_OKAY;
 }
 
+// Percentiles of the dispatch delay of scheduled events, over the last one to two windows.
+using DelayHistogram = decltype(EventTiming::dispatch_delay);
+
+struct DelayPercentile {
+  const char *name;
+  double percent;
+};
+
+const DelayPercentile DELAY_PERCENTILES[] = {{"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p999", 99.9}};
+
+constexpr int N_DELAY_PERCENTILES = sizeof(DELAY_PERCENTILES) / sizeof(DELAY_PERCENTILES[0]);
+constexpr int STAT_SLOW_EVENTS    = N_DELAY_PERCENTILES;
+constexpr ink_hrtime DELAY_WINDOW = HRTIME_SECONDS(10);
+
+int
+EventTimingStatSync(const char *, RecDataT, RecData *, RecRawStatBlock *rsb, int)
+{
+  static DelayHistogram older_base;
+  static DelayHistogram newer_base;
+  static ink_hrtime base_time = 0;
+
+  DelayHistogram window = {};
+  uint64_t slow_events  = 0;
+
+  for (int g = 0; g < eventProcessor.n_thread_groups; ++g) {
+    for (EThread *t : eventProcessor.active_group_threads(g)) {
+      const EventTiming *timing = t->event_timing;
+      if (timing) {
+        window.add(timing->dispatch_delay);
+        slow_events += timing->n_slow_events;
+      }
+    }
+  }
+
+  ink_hrtime now = ink_get_hrtime_internal();
+  if (now - base_time >= DELAY_WINDOW) {
+    older_base = newer_base;
+    newer_base = window;
+    base_time  = now;
+  }
+  window.subtract(older_base);
+
+  ink_mutex_acquire(&(rsb->mutex));
+  for (int id = 0; id < N_DELAY_PERCENTILES; ++id) {
+    rsb->global[id]->sum   = window.percentile(DELAY_PERCENTILES[id].percent);
+    rsb->global[id]->count = 1;
+    RecRawStatUpdateSum(rsb, id);
+  }
+  rsb->global[STAT_SLOW_EVENTS]->sum   = slow_events;
+  rsb->global[STAT_SLOW_EVENTS]->count = 1;
+  RecRawStatUpdateSum(rsb, STAT_SLOW_EVENTS);
+  ink_mutex_release(&(rsb->mutex));
+
+  return REC_ERR_OKAY;
+}
+
 /// This is a wrapper used to convert a static function into a continuation. The function pointer is
 /// passed in the cookie. For this reason the class is used as a singleton.
 /// @internal This is the implementation for @c schedule_spawn... overloads.
@@ -452,6 +509,15 @@ EventProcessor::start(int n_event_threads, size_t stacksize)
   // Name must be that of a stat, pick one at random since we do all of them in one pass/callback.
   RecRegisterRawStatSyncCb(name, EventMetricStatSync, rsb, 0);
 
+  RecRawStatBlock *timing_rsb = RecAllocateRawStatBlock(N_DELAY_PERCENTILES + 1);
+  for (int id = 0; id < N_DELAY_PERCENTILES; ++id) {
+    snprintf(name, sizeof(name), "proxy.process.eventloop.dispatch_delay.%s", DELAY_PERCENTILES[id].name);
+    RecRegisterRawStat(timing_rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT, id, NULL);
+  }
+  RecRegisterRawStat(timing_rsb, RECT_PROCESS, "proxy.process.eventloop.slow_events", RECD_INT, RECP_NON_PERSISTENT,
+                     STAT_SLOW_EVENTS, NULL);
+  RecRegisterRawStatSyncCb("proxy.process.eventloop.slow_events", EventTimingStatSync, timing_rsb, 0);
+
   this->spawn_event_threads(ET_CALL, n_event_threads, stacksize);
 
   Debug("iocore_thread", "Created event thread group id %d with %d threads", ET_CALL, n_event_threads);
@@ -0,0 +1,295 @@
+/** @file
+
+  Work stealing pool for relocatable work.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "P_EventSystem.h"
+#include "I_Tasks.h"
+#include "I_WorkProcessor.h"
+
+#include <atomic>
+#include <deque>
+
+// Globals
+EventType ET_WORK = ET_CALL;
+WorkProcessor workProcessor;
+
+namespace
+{
+/// Work run before going back to the event loop, so the events of a busy thread are not starved.
+constexpr int WORK_BATCH = 16;
+
+enum { STAT_EXECUTED, STAT_STOLEN, N_WORK_STATS };
+} // namespace
+
+/** The work deque of an ET_WORK thread.
+
+    It is also the tail handler of the thread, the thread runs its work and steals work from the
+    other threads at the end of its event loop, and only sleeps when there is nothing to do.
+ */
+class WorkThread : public EThread::LoopTailHandler
+{
+public:
+  explicit WorkThread(int index) : _index(index) { ink_mutex_init(&_mutex); }
+
+  int waitForActivity(ink_hrtime timeout) override;
+  void signalActivity() override;
+
+  /// Add @a e to this deque and make sure some thread will run it.
+  void push(Event *e);
+
+  /// Spawn callback of the ET_WORK threads.
+  static void initialize(EThread *t);
+  /// Sync callback of the pool stats.
+  static int stat_sync(const char *, RecDataT, RecData *, RecRawStatBlock *rsb, int);
+
+  std::atomic<EThread *> thread{nullptr}; ///< Set when the thread starts.
+
+  // Written only by the thread.
+  uint64_t executed = 0;
+  uint64_t stolen   = 0;
+
+private:
+  /// Take the newest work of this thread or else the oldest work of another thread.
+  Event *next(EThread *t);
+
+  Event *
+  pop_back()
+  {
+    Event *e = nullptr;
+    ink_scoped_mutex_lock lock(_mutex);
+    if (!_queue.empty()) {
+      e = _queue.back();
+      _queue.pop_back();
+    }
+    return e;
+  }
+
+  Event *
+  pop_front()
+  {
+    Event *e = nullptr;
+    ink_scoped_mutex_lock lock(_mutex);
+    if (!_queue.empty()) {
+      e = _queue.front();
+      _queue.pop_front();
+    }
+    return e;
+  }
+
+  bool
+  empty()
+  {
+    ink_scoped_mutex_lock lock(_mutex);
+    return _queue.empty();
+  }
+
+  int _index;
+  ink_mutex _mutex;
+  std::deque<Event *> _queue;
+  std::atomic<bool> _idle{false};
+};
+
+void
+WorkThread::push(Event *e)
+{
+  {
+    ink_scoped_mutex_lock lock(_mutex);
+    _queue.push_back(e);
+  }
+
+  // An idle owner is woken up. A busy owner checks the deque before it sleeps again, but another
+  // thread may be idle and can take the work sooner.
+  int n = workProcessor._n_threads;
+  for (int i = 0; i < n; ++i) {
+    WorkThread *w = workProcessor._threads[(_index + i) % n];
+    if (w->_idle) {
+      w->signalActivity();
+      break;
+    }
+  }
+}
+
+void
+WorkThread::signalActivity()
+{
+  EThread *t = thread;
+
+  // Before the thread starts, its first loop finds the work.
+  if (t) {
+    t->EventQueueExternal.signal();
+  }
+}
+
+Event *
+WorkThread::next(EThread *t)
+{
+  Event *e = this->pop_back();
+
+  if (e == nullptr) {
+    int n          = workProcessor._n_threads;
+    unsigned start = t->generator.random();
+    for (int i = 0; i < n && e == nullptr; ++i) {
+      WorkThread *victim = workProcessor._threads[(start + i) % n];
+      if (victim != this && (e = victim->pop_front()) != nullptr) {
+        ++stolen;
+      }
+    }
+  }
+  return e;
+}
+
+int
+WorkThread::waitForActivity(ink_hrtime timeout)
+{
+  EThread *t = thread;
+  int n      = 0;
+
+  for (Event *e; n < WORK_BATCH && (e = this->next(t)) != nullptr; ++n) {
+    // A continuation locked elsewhere is left to the event loop, which retries it.
+    e->ethread = t;
+    t->process_event(e, e->callback_event);
+    ++executed;
+  }
+  if (n > 0) {
+    return 0;
+  }
+
+  // Nothing to do. The idle flag is set and the deque checked under the lock of the event queue,
+  // so work pushed after the check signals the condition while this thread waits on it.
+  ProtectedQueue &q = t->EventQueueExternal;
+  ink_mutex_acquire(&q.lock);
+  _idle = true;
+  if (INK_ATOMICLIST_EMPTY(q.al) && this->empty()) {
+    timespec ts = ink_hrtime_to_timespec(Thread::get_hrtime_updated() + timeout);
+    ink_cond_timedwait(&q.might_have_data, &q.lock, &ts);
+  }
+  _idle = false;
+  ink_mutex_release(&q.lock);
+  return 0;
+}
+
+void
+WorkThread::initialize(EThread *t)
+{
+  WorkThread *w = workProcessor._threads[t->id];
+  w->thread     = t;
+  t->set_tail_handler(w);
+}
+
+int
+WorkThread::stat_sync(const char *, RecDataT, RecData *, RecRawStatBlock *rsb, int)
+{
+  uint64_t executed = 0;
+  uint64_t stolen   = 0;
+
+  for (int i = 0; i < workProcessor._n_threads; ++i) {
+    executed += workProcessor._threads[i]->executed;
+    stolen += workProcessor._threads[i]->stolen;
+  }
+
+  ink_mutex_acquire(&(rsb->mutex));
+  rsb->global[STAT_EXECUTED]->sum   = executed;
+  rsb->global[STAT_EXECUTED]->count = 1;
+  RecRawStatUpdateSum(rsb, STAT_EXECUTED);
+  rsb->global[STAT_STOLEN]->sum   = stolen;
+  rsb->global[STAT_STOLEN]->count = 1;
+  RecRawStatUpdateSum(rsb, STAT_STOLEN);
+  ink_mutex_release(&(rsb->mutex));
+
+  return REC_ERR_OKAY;
+}
+
+// Note that if the number of work_threads is 0, all work scheduled on the pool ends up running on
+// ET_TASK.
+int
+WorkProcessor::start(int work_threads, size_t stacksize)
+{
+  if (work_threads <= 0) {
+    ET_WORK = ET_TASK;
+    return 0;
+  }
+
+  _threads = new WorkThread *[work_threads];
+  for (int i = 0; i < work_threads; ++i) {
+    _threads[i] = new WorkThread(i);
+  }
+  _n_threads = work_threads;
+
+  RecRawStatBlock *rsb = RecAllocateRawStatBlock(N_WORK_STATS);
+  RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.work.executed", RECD_INT, RECP_NON_PERSISTENT, STAT_EXECUTED, nullptr);
+  RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.work.stolen", RECD_INT, RECP_NON_PERSISTENT, STAT_STOLEN, nullptr);
+  RecRegisterRawStatSyncCb("proxy.process.work.executed", WorkThread::stat_sync, rsb, STAT_EXECUTED);
+  RecRegisterRawStatSyncCb("proxy.process.work.stolen", WorkThread::stat_sync, rsb, STAT_STOLEN);
+
+  ET_WORK = eventProcessor.register_event_type("ET_WORK");
+  eventProcessor.schedule_spawn(&WorkThread::initialize, ET_WORK);
+  eventProcessor.spawn_event_threads(ET_WORK, work_threads, stacksize);
+  return 0;
+}
+
+WorkThread *
+WorkProcessor::current() const
+{
+  EThread *t = this_ethread();
+
+  if (_n_threads > 0 && t && t->is_event_type(ET_WORK)) {
+    return _threads[t->id];
+  }
+  return nullptr;
+}
+
+Event *
+WorkProcessor::schedule_imm(Continuation *c, int callback_event, void *cookie)
+{
+  if (_n_threads == 0) {
+    return eventProcessor.schedule_imm(c, ET_WORK, callback_event, cookie);
+  }
+
+  Event *e          = eventAllocator.alloc();
+  e->callback_event = callback_event;
+  e->cookie         = cookie;
+  e->init(c, 0, 0);
+  // The work can run on any thread, so it can't borrow the mutex of one.
+  if (!c->mutex) {
+    c->mutex = new_ProxyMutex();
+  }
+  e->mutex = c->mutex;
+
+  WorkThread *w = this->current();
+  if (w == nullptr) {
+    w = _threads[ink_atomic_increment(&_next, 1U) % _n_threads];
+  }
+  w->push(e);
+  return e;
+}
+
+Event *
+WorkProcessor::schedule_in(Continuation *c, ink_hrtime atimeout, int callback_event, void *cookie)
+{
+  return eventProcessor.schedule_in(c, atimeout, ET_WORK, callback_event, cookie);
+}
+
+Event *
+WorkProcessor::schedule_every(Continuation *c, ink_hrtime aperiod, int callback_event, void *cookie)
+{
+  return eventProcessor.schedule_every(c, aperiod, ET_WORK, callback_event, cookie);
+}
@@ -0,0 +1,163 @@
+/** @file
+
+  Micro benchmark of timer churn on an event thread.
+
+  Keeps a number of timers scheduled on one event thread, like the inactivity timeouts of idle
+  connections, and reschedules or cancels and replaces a number of them every millisecond. Reports
+  the CPU time of the event thread per timer operation.
+
+    benchmark_EventQueue [timers [operations per millisecond [seconds]]]
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "I_EventSystem.h"
+#include "tscore/I_Layout.h"
+
+#include "diags.i"
+
+#include <sys/resource.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+int n_timers       = 500000;
+int ops_per_ms     = 500;
+int seconds        = 10;
+volatile bool done = false;
+
+ink_hrtime
+thread_cpu_time()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return HRTIME_SECONDS(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         HRTIME_USECONDS(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+struct Timer : public Continuation {
+  uint64_t fired = 0;
+
+  Timer() : Continuation(nullptr) { SET_HANDLER(&Timer::handle); }
+
+  int
+  handle(int /* event ATS_UNUSED */, Event *e)
+  {
+    // Keep the event alive, the driver holds on to it.
+    ++fired;
+    e->schedule_in(HRTIME_SECONDS(30));
+    return EVENT_CONT;
+  }
+};
+
+struct Driver : public Continuation {
+  Timer timer;
+  std::vector<Event *> events;
+  std::mt19937_64 rng{1};
+  uint64_t rescheduled = 0;
+  uint64_t cancelled   = 0;
+  ink_hrtime start     = 0;
+  ink_hrtime cpu_start = 0;
+
+  Driver() : Continuation(nullptr) { SET_HANDLER(&Driver::handle_start); }
+
+  ink_hrtime
+  random_timeout()
+  {
+    // Inactivity and keep alive timeouts, from a few seconds to a couple of minutes.
+    return HRTIME_MSECONDS(2000 + rng() % 118000);
+  }
+
+  int
+  handle_start(int /* event ATS_UNUSED */, Event *e)
+  {
+    EThread *t  = e->ethread;
+    timer.mutex = mutex;
+    events.resize(n_timers);
+    for (Event *&timer_event : events) {
+      timer_event = t->schedule_in_local(&timer, random_timeout());
+    }
+    start     = Thread::get_hrtime_updated();
+    cpu_start = thread_cpu_time();
+    SET_HANDLER(&Driver::handle_churn);
+    t->schedule_every_local(this, HRTIME_MSECOND);
+    return EVENT_DONE;
+  }
+
+  int
+  handle_churn(int /* event ATS_UNUSED */, Event *e)
+  {
+    EThread *t = e->ethread;
+
+    for (int i = 0; i < ops_per_ms; ++i) {
+      Event *&timer_event = events[rng() % events.size()];
+      if (rng() % 4 == 0) {
+        timer_event->cancel();
+        timer_event = t->schedule_in_local(&timer, random_timeout());
+        ++cancelled;
+      } else {
+        timer_event->schedule_in(random_timeout());
+        ++rescheduled;
+      }
+    }
+
+    ink_hrtime elapsed = Thread::get_hrtime_updated() - start;
+    if (elapsed >= HRTIME_SECONDS(seconds)) {
+      ink_hrtime cpu = thread_cpu_time() - cpu_start;
+      uint64_t ops   = rescheduled + cancelled;
+      printf("%d timers, %" PRIu64 " rescheduled, %" PRIu64 " cancelled and replaced, %" PRIu64 " fired in %.1f s\n", n_timers,
+             rescheduled, cancelled, timer.fired, static_cast<double>(elapsed) / HRTIME_SECOND);
+      printf("event thread CPU %.3f s, %.1f%% busy, %.1f ns per operation\n", static_cast<double>(cpu) / HRTIME_SECOND,
+             100.0 * cpu / elapsed, ops ? static_cast<double>(cpu) / ops : 0.0);
+      e->cancel();
+      done = true;
+    }
+    return EVENT_CONT;
+  }
+};
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  if (argc > 1) {
+    n_timers = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    ops_per_ms = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    seconds = atoi(argv[3]);
+  }
+
+  Layout::create();
+  init_diags("", nullptr);
+  RecProcessInit(RECM_STAND_ALONE);
+
+  ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
+  eventProcessor.start(1, 1048576); // Hardcoded stacksize at 1MB
+
+  Driver *driver = new Driver;
+  eventProcessor.schedule_imm(driver, ET_CALL);
+  while (!done) {
+    sleep(1);
+  }
+  return 0;
+}
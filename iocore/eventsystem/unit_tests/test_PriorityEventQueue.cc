@@ -0,0 +1,233 @@
+/** @file
+
+    Catch-based unit tests for the PriorityEventQueue timing wheel.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+ */
+
+#define CATCH_CONFIG_RUNNER
+#include "catch.hpp"
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "I_EventSystem.h"
+#include "tscore/I_Layout.h"
+
+#include "diags.i"
+
+namespace
+{
+const ink_hrtime TICK  = PriorityEventQueue::TICK;
+const ink_hrtime START = HRTIME_SECONDS(1000000) + 123456;
+
+struct Dummy : public Continuation {
+  Dummy() : Continuation(nullptr) {}
+};
+Dummy dummy;
+
+PriorityEventQueue *
+make_queue(ink_hrtime now)
+{
+  PriorityEventQueue *q = new PriorityEventQueue;
+  q->current_tick       = now / TICK;
+  q->last_check_time    = now;
+  return q;
+}
+
+Event *
+make_event(ink_hrtime timeout_at)
+{
+  Event *e = eventAllocator.alloc();
+  e->init(&dummy, timeout_at, 0);
+  return e;
+}
+
+// The events which are due at @a now, in the order the queue returns them.
+std::vector<Event *>
+expire(PriorityEventQueue *q, ink_hrtime now)
+{
+  std::vector<Event *> result;
+  Event *e;
+
+  q->check_ready(now, this_ethread());
+  while ((e = q->dequeue_ready(now)) != nullptr) {
+    result.push_back(e);
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("PriorityEventQueue expiry", "[iocore][PriorityEventQueue]")
+{
+  PriorityEventQueue *q = make_queue(START);
+
+  REQUIRE(q->earliest_timeout() >= START + HRTIME_DAYS(1));
+
+  Event *soon  = make_event(START + HRTIME_MSECONDS(3));
+  Event *later = make_event(START + HRTIME_SECONDS(2));
+  Event *far   = make_event(START + HRTIME_HOURS(5));
+  q->enqueue(soon, START);
+  q->enqueue(later, START);
+  q->enqueue(far, START);
+
+  // Not early, and the loop sleeps until the first one.
+  REQUIRE(q->earliest_timeout() <= soon->timeout_at + TICK);
+  REQUIRE(expire(q, START + HRTIME_MSECONDS(2)).empty());
+  std::vector<Event *> fired = expire(q, START + HRTIME_MSECONDS(4));
+  REQUIRE(fired.size() == 1);
+  REQUIRE(fired[0] == soon);
+  REQUIRE(!soon->in_the_priority_queue);
+
+  // Removed before it expires.
+  q->remove(later);
+  REQUIRE(!later->in_the_priority_queue);
+  REQUIRE(expire(q, START + HRTIME_SECONDS(3)).empty());
+
+  // Cascaded down from the top levels.
+  REQUIRE(expire(q, far->timeout_at - TICK).empty());
+  fired = expire(q, far->timeout_at + TICK);
+  REQUIRE(fired.size() == 1);
+  REQUIRE(fired[0] == far);
+
+  // An event already due goes straight to the ready queue, and can be removed from there.
+  Event *due = make_event(START);
+  q->enqueue(due, q->last_check_time);
+  REQUIRE(q->earliest_timeout() == q->last_check_time);
+  q->remove(due);
+  REQUIRE(q->dequeue_ready(START) == nullptr);
+
+  for (Event *e : {soon, later, far, due}) {
+    e->free();
+  }
+  delete q;
+}
+
+TEST_CASE("PriorityEventQueue clock step back", "[iocore][PriorityEventQueue]")
+{
+  PriorityEventQueue *q = make_queue(START);
+
+  Event *soon  = make_event(START + HRTIME_SECONDS(2));
+  Event *later = make_event(START + HRTIME_HOURS(1));
+  q->enqueue(soon, START);
+  q->enqueue(later, START);
+
+  // The clock goes back two hours, then an event is scheduled from the new time.
+  ink_hrtime now = START - HRTIME_HOURS(2);
+  Event *step    = make_event(now + HRTIME_MSECONDS(5));
+  q->enqueue(step, now);
+
+  // Nothing fires early, nothing waits for the clock to catch up.
+  REQUIRE(expire(q, now).empty());
+  REQUIRE(q->earliest_timeout() <= now + HRTIME_MSECONDS(5) + TICK);
+  std::vector<Event *> fired = expire(q, now + HRTIME_MSECONDS(5) + TICK);
+  REQUIRE(fired.size() == 1);
+  REQUIRE(fired[0] == step);
+
+  REQUIRE(expire(q, now + HRTIME_SECONDS(2) - TICK).empty());
+  fired = expire(q, now + HRTIME_SECONDS(2) + TICK);
+  REQUIRE(fired.size() == 1);
+  REQUIRE(fired[0] == soon);
+
+  REQUIRE(expire(q, now + HRTIME_HOURS(1) - TICK).empty());
+  fired = expire(q, now + HRTIME_HOURS(1) + TICK);
+  REQUIRE(fired.size() == 1);
+  REQUIRE(fired[0] == later);
+
+  for (Event *e : {soon, later, step}) {
+    e->free();
+  }
+  delete q;
+}
+
+TEST_CASE("PriorityEventQueue random", "[iocore][PriorityEventQueue]")
+{
+  std::mt19937_64 rng(42);
+  PriorityEventQueue *q = make_queue(START);
+  std::set<std::pair<ink_hrtime, Event *>> pending; // By timeout.
+  ink_hrtime now = START;
+
+  auto random_timeout = [&]() -> ink_hrtime {
+    // Mostly short timeouts, with some up to several days.
+    switch (rng() % 4) {
+    case 0:
+      return rng() % HRTIME_MSECONDS(300);
+    case 1:
+      return rng() % HRTIME_SECONDS(120);
+    case 2:
+      return rng() % HRTIME_HOURS(6);
+    default:
+      return rng() % HRTIME_DAYS(60);
+    }
+  };
+
+  for (int round = 0; round < 20000; ++round) {
+    Event *e = nullptr;
+    for (int i = 0; i < 5; ++i) {
+      e = make_event(now + random_timeout());
+      q->enqueue(e, now);
+      pending.emplace(e->timeout_at, e);
+    }
+    // Remove some, as a rescheduled timer does.
+    if (rng() % 2) {
+      q->remove(e);
+      pending.erase({e->timeout_at, e});
+      e->free();
+    }
+
+    ink_hrtime earliest = pending.empty() ? HRTIME_FOREVER : pending.begin()->first;
+    ink_hrtime next     = q->earliest_timeout();
+    REQUIRE(next <= std::max(now, (earliest + TICK - 1) / TICK * TICK));
+
+    // Move to the next timeout or by a random step, sometimes a long one.
+    ink_hrtime step = rng() % 8 == 0 ? rng() % HRTIME_HOURS(4) : rng() % HRTIME_MSECONDS(50);
+    now             = std::max(now + 1, std::min(now + step, next));
+
+    for (Event *fired : expire(q, now)) {
+      REQUIRE(pending.erase({fired->timeout_at, fired}) == 1);
+      REQUIRE(fired->timeout_at <= now);
+      fired->free();
+    }
+    // Nothing due is left behind, up to the tick rounding.
+    if (!pending.empty()) {
+      REQUIRE(pending.begin()->first > now / TICK * TICK);
+    }
+  }
+
+  for (auto &p : pending) {
+    q->remove(p.second);
+    p.second->free();
+  }
+  delete q;
+}
+
+int
+main(int argc, char *argv[])
+{
+  Layout::create();
+  init_diags("", nullptr);
+  RecProcessInit(RECM_STAND_ALONE);
+  ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
+
+  Thread *main_thread = new EThread;
+  main_thread->set_specific();
+
+  return Catch::Session().run(argc, argv);
+}
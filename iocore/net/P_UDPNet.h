@@ -43,6 +43,11 @@ static inline PollCont *get_UDPPollCont(EThread *);
 class UDPNetHandler;
 
 struct UDPNetProcessorInternal : public UDPNetProcessor {
+  /// Datagrams received with one system call.
+  static constexpr int RECV_BATCH = 16;
+  /// Blocks of BUFFER_SIZE_INDEX_2K for a datagram, enough for the largest one.
+  static constexpr int RECV_NIOV = 32;
+
   int start(int n_udp_threads, size_t stacksize) override;
   void udp_read_from_net(UDPNetHandler *nh, UDPConnection *uc);
   int udp_callback(UDPNetHandler *nh, UDPConnection *uc, EThread *thread);
@@ -291,8 +296,15 @@ public:
 
   void service(UDPNetHandler *);
 
+  /// Packets sent with one system call.
+  static constexpr int SEND_BATCH = 64;
+  /// Segments of a GSO send, the kernel limit.
+  static constexpr int MAX_SEGMENTS = 64;
+
   void SendPackets();
   void SendUDPPacket(UDPPacketInternal *p, int32_t pktLen);
+  /// Send and free @a n packets, with sendmmsg and GSO where available.
+  void SendMultipleUDPPackets(UDPPacketInternal **p, int n);
 
   // Interface exported to the outside world
   void send(UDPPacket *p);
@@ -317,6 +329,8 @@ public:
   Que(UnixUDPConnection, link) open_list;
   // to be called back with data
   Que(UnixUDPConnection, callback_link) udp_callbacks;
+  // receive buffers, the blocks which did not get any data are kept for the next read
+  Ptr<IOBufferBlock> recv_chain[UDPNetProcessorInternal::RECV_BATCH];
 
   Event *trigger_event = nullptr;
   ink_hrtime nextCheck;
@@ -22,6 +22,7 @@
 */
 
 #include "P_Net.h"
+#include "I_EventTiming.h"
 #include "tscore/ink_platform.h"
 #include "tscore/InkErrno.h"
 #include "Log.h"
@@ -75,12 +76,27 @@ net_activity(UnixNetVConnection *vc, EThread *thread)
 //
 // Signal an event
 //
+
+// The NetHandler calls the continuations of the VIOs from its poll loop and not through events, so they are accounted
+// here for proxy.config.eventloop.timing.
+static inline void
+vio_signal(int event, VIO *vio)
+{
+  EThread *thread = this_ethread();
+
+  if (unlikely(event_timing_enabled) && thread->event_timing) {
+    thread->event_timing->call(vio->cont, event, [&]() { vio->cont->handleEvent(event, vio); });
+  } else {
+    vio->cont->handleEvent(event, vio);
+  }
+}
+
 static inline int
 read_signal_and_update(int event, UnixNetVConnection *vc)
 {
   vc->recursion++;
   if (vc->read.vio.cont) {
-    vc->read.vio.cont->handleEvent(event, &vc->read.vio);
+    vio_signal(event, &vc->read.vio);
   } else {
     switch (event) {
     case VC_EVENT_EOS:
@@ -111,7 +127,7 @@ write_signal_and_update(int event, UnixNetVConnection *vc)
 {
   vc->recursion++;
   if (vc->write.vio.cont) {
-    vc->write.vio.cont->handleEvent(event, &vc->write.vio);
+    vio_signal(event, &vc->write.vio);
   } else {
     switch (event) {
     case VC_EVENT_EOS:
@@ -32,6 +32,8 @@
 #include "P_Net.h"
 #include "P_UDPNet.h"
 
+#include <netinet/udp.h>
+
 using UDPNetContHandler = int (UDPNetHandler::*)(int, void *);
 
 inkcoreapi ClassAllocator<UDPPacketInternal> udpPacketAllocator("udpPacketAllocator");
@@ -47,6 +49,93 @@ UDPNetProcessor &udpNet = udpNetInternal;
 int32_t g_udp_periodicCleanupSlots;
 int32_t g_udp_periodicFreeCancelledPkts;
 int32_t g_udp_numSendRetries;
+int32_t g_udp_enableGSO; // segmentation offload of sends, cleared if the kernel does not support it.
+int32_t g_udp_enableGRO; // receive offload, for the UDPConnections of UDPBind.
+
+#if HAVE_SENDMMSG || HAVE_RECVMMSG
+using UDPMessage = struct mmsghdr;
+#else
+// Like a struct mmsghdr, the messages are sent and received one at a time.
+struct UDPMessage {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+#endif
+
+// Receive up to @a n datagrams, return the number received or -errno.
+static int
+udp_recv_messages(int fd, UDPMessage *msgs, int n)
+{
+#if HAVE_RECVMMSG
+  int r;
+  do {
+    if (unlikely((r = ::recvmmsg(fd, msgs, n, 0, nullptr)) < 0)) {
+      r = -errno;
+    }
+  } while (r == -EINTR);
+  return r;
+#else
+  for (int i = 0; i < n; i++) {
+    int r = socketManager.recvmsg(fd, &msgs[i].msg_hdr, 0);
+    if (r < 0) {
+      return i > 0 ? i : r;
+    }
+    msgs[i].msg_len = r;
+  }
+  return n;
+#endif
+}
+
+// Send up to @a n messages, return the number sent or -errno if the first one failed.
+static int
+udp_send_messages(int fd, UDPMessage *msgs, int n)
+{
+#if HAVE_SENDMMSG
+  int r;
+  do {
+    if (unlikely((r = ::sendmmsg(fd, msgs, n, 0)) < 0)) {
+      r = -errno;
+    }
+  } while (r == -EINTR);
+  return r;
+#else
+  for (int i = 0; i < n; i++) {
+    int r = socketManager.sendmsg(fd, &msgs[i].msg_hdr, 0);
+    if (r < 0) {
+      return i > 0 ? i : r;
+    }
+    msgs[i].msg_len = r;
+  }
+  return n;
+#endif
+}
+
+// A chain of clones of the blocks of @a b, for the @a len bytes starting at @a offset.
+static IOBufferBlock *
+udp_slice_chain(IOBufferBlock *b, int64_t offset, int64_t len)
+{
+  IOBufferBlock *head = nullptr;
+  IOBufferBlock *last = nullptr;
+
+  for (; b && offset >= b->read_avail(); b = b->next.get()) {
+    offset -= b->read_avail();
+  }
+  for (; b && len > 0; b = b->next.get()) {
+    IOBufferBlock *c = b->clone();
+    c->consume(offset);
+    int64_t n = std::min(len, c->read_avail());
+    c->_end   = c->_start + n;
+    len -= n;
+    offset = 0;
+    if (last == nullptr) {
+      head = c;
+    } else {
+      last->next = c;
+    }
+    last = c;
+  }
+  return head;
+}
 
 #include "P_LibBulkIO.h"
 
@@ -93,6 +182,29 @@ UDPNetProcessorInternal::start(int n_upd_threads, size_t stacksize)
     return -1;
   }
 
+  REC_ReadConfigInt32(g_udp_enableGSO, "proxy.config.udp.enable_gso");
+  REC_ReadConfigInt32(g_udp_enableGRO, "proxy.config.udp.enable_gro");
+#ifdef UDP_SEGMENT
+  // Probe the kernel (Linux 4.18) for GSO support.
+  if (g_udp_enableGSO) {
+    int probe     = socket(AF_INET, SOCK_DGRAM, 0);
+    int val       = 0;
+    socklen_t len = sizeof(val);
+    if (probe < 0 || getsockopt(probe, SOL_UDP, UDP_SEGMENT, &val, &len) < 0) {
+      Debug("udpnet", "UDP GSO is not supported");
+      g_udp_enableGSO = 0;
+    }
+    if (probe >= 0) {
+      close(probe);
+    }
+  }
+#else
+  g_udp_enableGSO = 0;
+#endif
+#ifndef UDP_GRO
+  g_udp_enableGRO = 0;
+#endif
+
   pollCont_offset      = eventProcessor.allocate(sizeof(PollCont));
   udpNetHandler_offset = eventProcessor.allocate(sizeof(UDPNetHandler));
 
@@ -108,95 +220,127 @@ UDPNetProcessorInternal::udp_read_from_net(UDPNetHandler *nh, UDPConnection *xuc
 {
   UnixUDPConnection *uc = (UnixUDPConnection *)xuc;
 
-  // receive packet and queue onto UDPConnection.
+  // receive packets and queue onto UDPConnection.
   // don't call back connection at this time.
-  int64_t r;
-  int iters         = 0;
-  unsigned max_niov = 32;
-
-  struct msghdr msg;
-  Ptr<IOBufferBlock> chain, next_chain;
-  struct iovec tiovec[max_niov];
+  int n;
+  int iters   = 0;
+  int rebuild = RECV_BATCH;
+
+  UDPMessage msgs[RECV_BATCH];
+  struct iovec tiovec[RECV_BATCH][RECV_NIOV];
+  sockaddr_in6 fromaddr[RECV_BATCH];
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control[RECV_BATCH];
   int64_t size_index  = BUFFER_SIZE_INDEX_2K;
   int64_t buffer_size = BUFFER_SIZE_FOR_INDEX(size_index);
   // The max length of receive buffer is 32 * buffer_size (2048) = 65536 bytes.
   // Because the 'UDP Length' is type of uint16_t defined in RFC 768.
   // And there is 8 octets in 'User Datagram Header' which means the max length of payload is no more than 65527 bytes.
+  // With GRO the kernel may put several datagrams of the same size in one buffer, up to the same length.
   do {
-    // create IOBufferBlock chain to receive data
-    unsigned int niov;
-    IOBufferBlock *b, *last;
-
-    // build struct iov
-    // reuse the block in chain if available
-    b    = chain.get();
-    last = nullptr;
-    for (niov = 0; niov < max_niov; niov++) {
-      if (b == nullptr) {
-        b = new_IOBufferBlock();
-        b->alloc(size_index);
-        if (last == nullptr) {
-          chain = b;
-        } else {
-          last->next = b;
+    // build struct iov of the buffers which were used by the last read
+    // reuse the blocks in chain if available
+    for (int m = 0; m < rebuild; m++) {
+      IOBufferBlock *b    = nh->recv_chain[m].get();
+      IOBufferBlock *last = nullptr;
+      for (int niov = 0; niov < RECV_NIOV; niov++) {
+        if (b == nullptr) {
+          b = new_IOBufferBlock();
+          b->alloc(size_index);
+          if (last == nullptr) {
+            nh->recv_chain[m] = b;
+          } else {
+            last->next = b;
+          }
         }
-      }
 
-      tiovec[niov].iov_base = b->buf();
-      tiovec[niov].iov_len  = b->block_size();
+        tiovec[m][niov].iov_base = b->buf();
+        tiovec[m][niov].iov_len  = b->block_size();
 
-      last = b;
-      b    = b->next.get();
+        last = b;
+        b    = b->next.get();
+      }
     }
 
     // build struct msghdr
-    sockaddr_in6 fromaddr;
-    msg.msg_name       = &fromaddr;
-    msg.msg_namelen    = sizeof(fromaddr);
-    msg.msg_iov        = tiovec;
-    msg.msg_iovlen     = niov;
-    msg.msg_control    = nullptr;
-    msg.msg_controllen = 0;
-
-    // receive data by recvmsg
-    r = socketManager.recvmsg(uc->getFd(), &msg, 0);
-    if (r <= 0) {
+    for (int m = 0; m < RECV_BATCH; m++) {
+      struct msghdr &msg = msgs[m].msg_hdr;
+      msg.msg_name       = &fromaddr[m];
+      msg.msg_namelen    = sizeof(fromaddr[m]);
+      msg.msg_iov        = tiovec[m];
+      msg.msg_iovlen     = RECV_NIOV;
+      msg.msg_control    = control[m].buf;
+      msg.msg_controllen = sizeof(control[m].buf);
+      msg.msg_flags      = 0;
+    }
+
+    // receive data by recvmmsg
+    n = udp_recv_messages(uc->getFd(), msgs, RECV_BATCH);
+    if (n <= 0) {
       // error
       break;
     }
 
-    // truncated check
-    if (msg.msg_flags & MSG_TRUNC) {
-      Debug("udp-read", "The UDP packet is truncated");
-    }
+    for (int m = 0; m < n; m++) {
+      struct msghdr &msg = msgs[m].msg_hdr;
+      int64_t r          = msgs[m].msg_len;
+      int gso_size       = 0;
+
+      if (r == 0) {
+        continue;
+      }
+
+      // truncated check
+      if (msg.msg_flags & MSG_TRUNC) {
+        Debug("udp-read", "The UDP packet is truncated");
+      }
+#ifdef UDP_GRO
+      for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+          memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+        }
+      }
+#endif
+
+      // fill the IOBufferBlock chain, the unused blocks stay for the next read
+      Ptr<IOBufferBlock> chain = nh->recv_chain[m];
+      int64_t saved            = r;
+      IOBufferBlock *b         = chain.get();
+      while (b && saved > 0) {
+        if (saved > buffer_size) {
+          b->fill(buffer_size);
+          saved -= buffer_size;
+          b = b->next.get();
+        } else {
+          b->fill(saved);
+          saved             = 0;
+          nh->recv_chain[m] = b->next;
+          b->next           = nullptr;
+        }
+      }
 
-    // fill the IOBufferBlock chain
-    int64_t saved = r;
-    b             = chain.get();
-    while (b && saved > 0) {
-      if (saved > buffer_size) {
-        b->fill(buffer_size);
-        saved -= buffer_size;
-        b = b->next.get();
+      // create packet, one for each datagram coalesced by GRO
+      if (gso_size > 0 && r > gso_size) {
+        for (int64_t offset = 0; offset < r; offset += gso_size) {
+          Ptr<IOBufferBlock> segment(udp_slice_chain(chain.get(), offset, std::min<int64_t>(gso_size, r - offset)));
+          UDPPacket *p = new_incoming_UDPPacket(ats_ip_sa_cast(&fromaddr[m]), segment);
+          p->setConnection(uc);
+          uc->inQueue.push((UDPPacketInternal *)p);
+        }
       } else {
-        b->fill(saved);
-        saved      = 0;
-        next_chain = b->next.get();
-        b->next    = nullptr;
+        UDPPacket *p = new_incoming_UDPPacket(ats_ip_sa_cast(&fromaddr[m]), chain);
+        p->setConnection(uc);
+        // queue onto the UDPConnection
+        uc->inQueue.push((UDPPacketInternal *)p);
       }
     }
 
-    // create packet
-    UDPPacket *p = new_incoming_UDPPacket(ats_ip_sa_cast(&fromaddr), chain);
-    p->setConnection(uc);
-    // queue onto the UDPConnection
-    uc->inQueue.push((UDPPacketInternal *)p);
-
-    // reload the unused block
-    chain      = next_chain;
-    next_chain = nullptr;
-    iters++;
-  } while (r > 0);
+    rebuild = n;
+    iters += n;
+    // A short batch means the socket is drained.
+  } while (n == RECV_BATCH);
   if (iters >= 1) {
     Debug("udp-read", "read %d at a time", iters);
   }
@@ -688,6 +832,16 @@ UDPNetProcessor::UDPBind(Continuation *cont, sockaddr const *addr, int send_bufs
     goto Lerror;
   }
 
+#ifdef UDP_GRO
+  // Received datagrams are split again in udp_read_from_net().
+  if (g_udp_enableGRO) {
+    int enable_gro = 1;
+    if (safe_setsockopt(fd, SOL_UDP, UDP_GRO, (char *)&enable_gro, sizeof(enable_gro)) < 0) {
+      Debug("udpnet", "UDP GRO is not supported");
+    }
+  }
+#endif
+
   if (recv_bufsize) {
     if (unlikely(socketManager.set_rcvbuf_size(fd, recv_bufsize))) {
       Debug("udpnet", "set_dnsbuf_size(%d) failed", recv_bufsize);
@@ -786,6 +940,8 @@ UDPQueue::SendPackets()
   int32_t bytesThisSlot = INT_MAX, bytesUsed = 0;
   int32_t bytesThisPipe, sentOne;
   int64_t pktLen;
+  UDPPacketInternal *batch[SEND_BATCH];
+  int nbatch = 0;
 
   bytesThisSlot = INT_MAX;
 
@@ -804,9 +960,19 @@ sendPackets:
       goto next_pkt;
     }
 
-    SendUDPPacket(p, pktLen);
+    // The packet is freed once it is sent with the rest of the batch.
+    batch[nbatch++] = p;
+    if (nbatch == SEND_BATCH) {
+      SendMultipleUDPPackets(batch, nbatch);
+      nbatch = 0;
+    }
     bytesUsed += pktLen;
     bytesThisPipe -= pktLen;
+    sentOne = true;
+    if (bytesThisPipe < 0) {
+      break;
+    }
+    continue;
   next_pkt:
     sentOne = true;
     p->free();
@@ -815,6 +981,10 @@ sendPackets:
       break;
     }
   }
+  if (nbatch > 0) {
+    SendMultipleUDPPackets(batch, nbatch);
+    nbatch = 0;
+  }
 
   bytesThisSlot -= bytesUsed;
 
@@ -881,6 +1051,135 @@ UDPQueue::SendUDPPacket(UDPPacketInternal *p, int32_t /* pktLen ATS_UNUSED */)
   }
 }
 
+void
+UDPQueue::SendMultipleUDPPackets(UDPPacketInternal **p, int n)
+{
+  static constexpr int MAX_IOV     = SEND_BATCH * 4;
+  static constexpr int MAX_PAYLOAD = 65507; // Of an IPv4 datagram.
+
+  UDPMessage msgs[SEND_BATCH];
+  struct iovec iov[MAX_IOV];
+  union {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    struct cmsghdr align;
+  } control[SEND_BATCH];
+  int first[SEND_BATCH + 1]; // The packets of msgs[m] are p[first[m]] up to p[first[m + 1]].
+  int nmsg = 0;
+  int niov = 0;
+  int fd   = NO_FD;
+
+  auto flush = [&]() {
+    int sent  = 0;
+    int count = 0;
+    while (sent < nmsg) {
+      int r = udp_send_messages(fd, msgs + sent, nmsg - sent);
+      if (r > 0) {
+        sent += r;
+      } else if (r == -EAGAIN) {
+        // stupid Linux problem: sendmsg can return EAGAIN
+        ++count;
+        if ((g_udp_numSendRetries > 0) && (count >= g_udp_numSendRetries)) {
+          // tried too many times; give up
+          Debug("udpnet", "Send failed: too many retries");
+          break;
+        }
+      } else if (msgs[sent].msg_hdr.msg_controllen > 0 && (r == -EIO || r == -EINVAL)) {
+        // The route or device can't do GSO, send the datagrams one by one from now on.
+        Debug("udpnet", "GSO send failed with errno %d, disabling UDP GSO", -r);
+        g_udp_enableGSO = 0;
+        for (int k = first[sent]; k < first[sent + 1]; ++k) {
+          SendUDPPacket(p[k], 0);
+        }
+        ++sent;
+      } else {
+        // some random error happened, skip this datagram.
+        Debug("udpnet", "Send failed with errno %d", -r);
+        ++sent;
+      }
+    }
+    for (int k = first[0]; k < first[nmsg]; ++k) {
+      p[k]->free();
+    }
+    nmsg = 0;
+    niov = 0;
+  };
+
+  for (int i = 0; i < n;) {
+    UDPConnectionInternal *conn = p[i]->conn;
+    int64_t seg_len             = p[i]->getPktLength();
+    int64_t total               = 0;
+    int max_seg                 = (g_udp_enableGSO && seg_len <= INK_ETHERNET_MTU_SIZE) ? MAX_SEGMENTS : 1;
+    int nblocks                 = 0;
+    int nseg                    = 0;
+
+    // With GSO, datagrams of the same size to the same address are sent as one buffer which the
+    // kernel splits again. Only the last one can be shorter.
+    while (i + nseg < n && nseg < max_seg) {
+      UDPPacketInternal *q = p[i + nseg];
+      int64_t len          = q->getPktLength();
+      int blocks           = 0;
+      for (IOBufferBlock *b = q->chain.get(); b != nullptr; b = b->next.get()) {
+        ++blocks;
+      }
+      if (nseg > 0 && (q->conn != conn || !ats_ip_addr_port_eq(&q->to.sa, &p[i]->to.sa) || len > seg_len ||
+                       total + len > MAX_PAYLOAD || nblocks + blocks > MAX_IOV)) {
+        break;
+      }
+      nblocks += blocks;
+      total += len;
+      ++nseg;
+      if (len < seg_len) {
+        break;
+      }
+    }
+
+    // Send the pending messages if this one is for another socket or does not fit.
+    if (nmsg > 0 && (conn->getFd() != fd || nmsg == SEND_BATCH || niov + nblocks > MAX_IOV)) {
+      flush();
+    }
+    if (nblocks > MAX_IOV) {
+      Debug("udpnet", "Dropping a packet of %d blocks", nblocks);
+      p[i++]->free();
+      continue;
+    }
+
+    struct msghdr &msg = msgs[nmsg].msg_hdr;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name    = (caddr_t)&p[i]->to.sa;
+    msg.msg_namelen = ats_ip_size(&p[i]->to.sa);
+    msg.msg_iov     = iov + niov;
+    msg.msg_iovlen  = nblocks;
+    for (int k = i; k < i + nseg; ++k) {
+      p[k]->conn->lastSentPktStartTime = p[k]->delivery_time;
+      for (IOBufferBlock *b = p[k]->chain.get(); b != nullptr; b = b->next.get()) {
+        iov[niov].iov_base = (caddr_t)b->start();
+        iov[niov].iov_len  = b->size();
+        ++niov;
+      }
+    }
+#ifdef UDP_SEGMENT
+    if (nseg > 1) {
+      uint16_t segment_size = seg_len;
+      msg.msg_control       = control[nmsg].buf;
+      msg.msg_controllen    = sizeof(control[nmsg].buf);
+      struct cmsghdr *cmsg  = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level      = SOL_UDP;
+      cmsg->cmsg_type       = UDP_SEGMENT;
+      cmsg->cmsg_len        = CMSG_LEN(sizeof(segment_size));
+      memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+#endif
+    Debug("udp-send", "Sending %d packets from %p", nseg, p[i]);
+    fd            = conn->getFd();
+    first[nmsg]   = i;
+    first[++nmsg] = i + nseg;
+    i += nseg;
+  }
+  if (nmsg > 0) {
+    flush();
+  }
+}
+
 void
 UDPQueue::send(UDPPacket *p)
 {
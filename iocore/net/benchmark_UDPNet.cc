@@ -0,0 +1,204 @@
+/** @file
+
+  Loopback throughput benchmark of the UDPNetProcessor.
+
+  One ET_UDP thread sends datagrams from one UDPConnection to another on the loopback interface
+  every millisecond and receives them. Reports the throughput and the CPU time of the thread per
+  datagram. Segmentation and receive offload (GSO / GRO) are used if the kernel supports them,
+  unless offload is 0.
+
+    benchmark_UDPNet [payload size [datagrams per millisecond [seconds [offload]]]]
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <sys/resource.h>
+#include <vector>
+
+#include "tscore/I_Layout.h"
+
+#include "I_EventSystem.h"
+#include "I_Net.h"
+#include "I_UDPNet.h"
+#include "I_UDPPacket.h"
+#include "I_UDPConnection.h"
+
+#include "diags.i"
+
+extern int32_t g_udp_enableGSO;
+
+namespace
+{
+int payload_size   = 1200;
+int per_ms         = 200;
+int seconds        = 10;
+int offload        = 1;
+volatile bool done = false;
+
+ink_hrtime
+thread_cpu_time()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return HRTIME_SECONDS(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         HRTIME_USECONDS(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+class Bench : public Continuation
+{
+public:
+  Bench() : Continuation(new_ProxyMutex()) { SET_HANDLER(&Bench::handle_start); }
+
+  int
+  handle_start(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    sockaddr_in addr;
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+
+    SET_HANDLER(&Bench::handle_packet);
+    payload.resize(payload_size, 'x');
+    udpNet.UDPBind(this, reinterpret_cast<sockaddr const *>(&addr), 4 << 20, 4 << 20);
+    udpNet.UDPBind(this, reinterpret_cast<sockaddr const *>(&addr), 4 << 20, 4 << 20);
+    return EVENT_DONE;
+  }
+
+  int
+  handle_packet(int event, void *data)
+  {
+    switch (event) {
+    case NET_EVENT_DATAGRAM_OPEN:
+      if (receiver == nullptr) {
+        receiver = static_cast<UDPConnection *>(data);
+        receiver->getBinding(&to.sa);
+      } else {
+        // Give the UDPNetHandler a pass to set up the connections before sending.
+        sender = static_cast<UDPConnection *>(data);
+        eventProcessor.schedule_in(this, HRTIME_MSECONDS(10), ET_UDP);
+      }
+      break;
+
+    case NET_EVENT_DATAGRAM_READ_READY: {
+      Queue<UDPPacket> *q = static_cast<Queue<UDPPacket> *>(data);
+      while (UDPPacket *p = q->pop()) {
+        ++received;
+        received_bytes += p->getPktLength();
+        p->free();
+      }
+      break;
+    }
+
+    case NET_EVENT_DATAGRAM_READ_ERROR:
+    case NET_EVENT_DATAGRAM_WRITE_ERROR:
+      fprintf(stderr, "UDP error %d\n", event);
+      exit(EXIT_FAILURE);
+
+    case EVENT_INTERVAL:
+      if (start == 0) {
+        start     = Thread::get_hrtime_updated();
+        cpu_start = thread_cpu_time();
+        SET_HANDLER(&Bench::handle_send);
+        this_ethread()->schedule_every(this, HRTIME_MSECOND);
+      }
+      break;
+
+    default:
+      break;
+    }
+    return EVENT_CONT;
+  }
+
+  int
+  handle_send(int event, void *data)
+  {
+    if (event != EVENT_INTERVAL) {
+      return handle_packet(event, data);
+    }
+
+    ink_hrtime elapsed = Thread::get_hrtime_updated() - start;
+    if (elapsed < HRTIME_SECONDS(seconds)) {
+      for (int i = 0; i < per_ms; ++i) {
+        sender->send(this, new_UDPPacket(&to.sa, 0, payload.data(), payload.size()));
+      }
+      sent += per_ms;
+    } else if (elapsed >= HRTIME_SECONDS(seconds) + HRTIME_MSECONDS(100)) {
+      // The last datagrams had time to arrive.
+      ink_hrtime cpu = thread_cpu_time() - cpu_start;
+      printf("%d byte datagrams, GSO %s: %" PRIu64 " sent, %" PRIu64 " received in %.1f s\n", payload_size,
+             g_udp_enableGSO ? "on" : "off", sent, received, static_cast<double>(elapsed) / HRTIME_SECOND);
+      printf("%.0f datagrams/s, %.1f Mbit/s, thread CPU %.1f%%, %.0f ns per datagram\n",
+             received * static_cast<double>(HRTIME_SECOND) / elapsed, received_bytes * 8.0 * HRTIME_SECOND / elapsed / 1e6,
+             100.0 * cpu / elapsed, received ? static_cast<double>(cpu) / received : 0.0);
+      static_cast<Event *>(data)->cancel();
+      done = true;
+    }
+    return EVENT_CONT;
+  }
+
+private:
+  std::vector<char> payload;
+  UDPConnection *receiver = nullptr;
+  UDPConnection *sender   = nullptr;
+  IpEndpoint to;
+  uint64_t sent           = 0;
+  uint64_t received       = 0;
+  uint64_t received_bytes = 0;
+  ink_hrtime start        = 0;
+  ink_hrtime cpu_start    = 0;
+};
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  if (argc > 1) {
+    payload_size = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    per_ms = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    seconds = atoi(argv[3]);
+  }
+  if (argc > 4) {
+    offload = atoi(argv[4]);
+  }
+
+  Layout::create();
+  init_diags("", nullptr);
+  RecProcessInit(RECM_STAND_ALONE);
+  RecRegisterConfigInt(RECT_CONFIG, "proxy.config.udp.enable_gso", offload, RECU_NULL, RECC_NULL, nullptr, REC_SOURCE_DEFAULT);
+  RecRegisterConfigInt(RECT_CONFIG, "proxy.config.udp.enable_gro", offload, RECU_NULL, RECC_NULL, nullptr, REC_SOURCE_DEFAULT);
+
+  Thread *main_thread = new EThread();
+  main_thread->set_specific();
+  net_config_poll_timeout = 1;
+
+  ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
+  eventProcessor.start(1);
+  udpNet.start(1, 1048576);
+
+  Bench *bench = new Bench;
+  eventProcessor.schedule_imm(bench, ET_UDP);
+  while (!done) {
+    sleep(1);
+  }
+  return 0;
+}
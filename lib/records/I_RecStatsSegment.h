@@ -0,0 +1,149 @@
+/** @file
+
+  Shared memory stats segment.
+
+  traffic_server copies the values of all stats into a memory mapped file after every raw stat
+  sync, so local tools can read them without a round trip through traffic_manager. The file
+  holds a header, the names and types of the stats and their values. Names are only ever
+  appended, a name is visible once @c num_entries covers it. The values are protected by a
+  seqlock: the writer makes @c sequence odd while it copies them in, a reader copies them out and
+  retries if @c sequence was odd or changed meanwhile.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+#include "I_RecDefs.h"
+
+#define REC_STATS_SEGMENT_FILE "stats.segment"
+#define REC_STATS_SEGMENT_MAGIC 0x47535354 // "TSSG"
+#define REC_STATS_SEGMENT_VERSION 1
+#define REC_STATS_SEGMENT_NAME_LEN 128
+#define REC_STATS_SEGMENT_STRING_LEN 32
+
+struct RecRecord;
+
+struct RecStatsSegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t max_entries;
+  std::atomic<uint32_t> num_entries; ///< Number of entries with a name, written after the names.
+  std::atomic<uint64_t> sequence;    ///< Seqlock of the values, odd while the values are written.
+  int64_t update_time;               ///< Time of the last update in seconds, protected by @c sequence.
+  int64_t pid;                       ///< Process id of the writer.
+};
+
+struct RecStatsSegmentEntry {
+  char name[REC_STATS_SEGMENT_NAME_LEN];
+  int32_t data_type; ///< @c RecDataT of the stat.
+};
+
+union RecStatsSegmentValue {
+  int64_t rec_int; ///< RECD_INT and RECD_COUNTER.
+  double rec_float;
+  char rec_string[REC_STATS_SEGMENT_STRING_LEN]; ///< Truncated, always nul terminated.
+};
+
+/// Size of a segment with room for @a max_entries stats.
+size_t RecStatsSegmentSize(uint32_t max_entries);
+
+//-------------------------------------------------------------------------
+// Writer, in traffic_server
+//-------------------------------------------------------------------------
+
+/// Create the segment if proxy.config.stats.segment.enabled is set.
+void RecStatsSegmentInit();
+
+/// Copy the value of the stat record @a r at index @a rec_idx, with the record locked.
+void RecStatsSegmentStage(int rec_idx, const RecRecord *r);
+
+/// Make the staged values visible to readers.
+void RecStatsSegmentPublish();
+
+//-------------------------------------------------------------------------
+// Reader
+//-------------------------------------------------------------------------
+
+/** A read only view of the stats segment.
+
+    Reading a stat does not make any system call, @c snapshot copies all values at once and the
+    accessors return the values of the last snapshot.
+ */
+class RecStatsSegmentReader
+{
+public:
+  ~RecStatsSegmentReader();
+
+  bool open(const char *path);
+  void close();
+
+  bool
+  is_open() const
+  {
+    return _header != nullptr;
+  }
+
+  /// Map the segment again if traffic_server replaced it since it was opened, e.g. on restart.
+  bool reopen_if_replaced();
+
+  /// Copy a consistent set of values out of the segment. Fails if the writer does not finish.
+  bool snapshot();
+
+  /// Index of the stat @a name, or -1.
+  int find(const char *name) const;
+
+  int
+  count() const
+  {
+    return static_cast<int>(_values.size());
+  }
+
+  const char *name(int idx) const;
+  RecDataT type(int idx) const;
+  int64_t get_int(int idx) const;
+  double get_float(int idx) const;
+  const char *get_string(int idx) const;
+
+  /// Time of the update of the last snapshot, in seconds.
+  int64_t
+  update_time() const
+  {
+    return _update_time;
+  }
+
+private:
+  std::string _path;
+  void *_base                          = nullptr;
+  size_t _size                         = 0;
+  ino_t _inode                         = 0;
+  const RecStatsSegmentHeader *_header = nullptr;
+  const RecStatsSegmentEntry *_entries = nullptr;
+  const RecStatsSegmentValue *_shared  = nullptr;
+
+  std::vector<RecStatsSegmentValue> _values;
+  std::unordered_map<std::string, int> _index;
+  int64_t _update_time = 0;
+};
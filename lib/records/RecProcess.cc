@@ -32,6 +32,7 @@
 #include "P_RecMessage.h"
 #include "P_RecUtils.h"
 #include "P_RecFile.h"
+#include "I_RecStatsSegment.h"
 
 #include "mgmtapi.h"
 #include "ProcessManager.h"
@@ -274,6 +275,8 @@ RecProcessStart()
     return REC_ERR_OKAY;
   }
 
+  RecStatsSegmentInit();
+
   Debug("statsproc", "Starting sync continuations:");
   raw_stat_sync_cont *rssc = new raw_stat_sync_cont(new_ProxyMutex());
   Debug("statsproc", "raw-stat syncer");
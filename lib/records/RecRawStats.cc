@@ -23,6 +23,7 @@
 
 #include "P_RecCore.h"
 #include "P_RecProcess.h"
+#include "I_RecStatsSegment.h"
 #include <string_view>
 
 //-------------------------------------------------------------------------
@@ -586,9 +587,11 @@ RecExecRawStatSyncCbs()
         }
         r->sync_required = REC_SYNC_REQUIRED;
       }
+      RecStatsSegmentStage(i, r);
     }
     rec_mutex_release(&(r->lock));
   }
+  RecStatsSegmentPublish();
 
   return REC_ERR_OKAY;
 }
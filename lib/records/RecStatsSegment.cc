@@ -0,0 +1,360 @@
+/** @file
+
+  Shared memory stats segment.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "tscore/ink_platform.h"
+#include "tscore/ink_string.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "P_RecCore.h"
+#include "P_RecUtils.h"
+#include "I_RecStatsSegment.h"
+
+namespace
+{
+constexpr size_t
+align64(size_t n)
+{
+  return (n + 63) & ~static_cast<size_t>(63);
+}
+
+inline size_t
+entries_offset()
+{
+  return align64(sizeof(RecStatsSegmentHeader));
+}
+
+inline size_t
+values_offset(uint32_t max_entries)
+{
+  return entries_offset() + align64(max_entries * sizeof(RecStatsSegmentEntry));
+}
+
+// Readers give up after this many attempts at a consistent copy.
+constexpr int SNAPSHOT_RETRIES = 1000;
+
+// Writer state. Stage and publish are only called from the raw stat sync, one at a time.
+RecStatsSegmentHeader *g_segment = nullptr;
+RecStatsSegmentEntry *g_entries  = nullptr;
+RecStatsSegmentValue *g_values   = nullptr;
+std::vector<int> g_slots; // Index of each record in the segment, -1 if not added yet.
+std::vector<RecStatsSegmentValue> g_staged;
+uint32_t g_num_staged = 0;
+} // namespace
+
+size_t
+RecStatsSegmentSize(uint32_t max_entries)
+{
+  return values_offset(max_entries) + max_entries * sizeof(RecStatsSegmentValue);
+}
+
+//-------------------------------------------------------------------------
+// RecStatsSegmentInit
+//-------------------------------------------------------------------------
+void
+RecStatsSegmentInit()
+{
+  RecInt enabled = 0;
+
+  if (g_segment != nullptr || RecGetRecordInt("proxy.config.stats.segment.enabled", &enabled) != REC_ERR_OKAY || !enabled) {
+    return;
+  }
+
+  // Build the segment under a temporary name, so readers never see a partial header.
+  std::string rundir(RecConfigReadRuntimeDir());
+  std::string path = rundir + "/" + REC_STATS_SEGMENT_FILE;
+  std::string tmp  = path + ".tmp";
+  size_t size      = RecStatsSegmentSize(REC_MAX_RECORDS);
+
+  int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+  if (fd < 0) {
+    Warning("unable to create stats segment '%s': %s", tmp.c_str(), strerror(errno));
+    return;
+  }
+  if (ftruncate(fd, size) < 0) {
+    Warning("unable to size stats segment '%s': %s", tmp.c_str(), strerror(errno));
+    ::close(fd);
+    return;
+  }
+
+  void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    Warning("unable to map stats segment '%s': %s", tmp.c_str(), strerror(errno));
+    return;
+  }
+
+  g_segment              = new (base) RecStatsSegmentHeader;
+  g_segment->magic       = REC_STATS_SEGMENT_MAGIC;
+  g_segment->version     = REC_STATS_SEGMENT_VERSION;
+  g_segment->max_entries = REC_MAX_RECORDS;
+  g_segment->num_entries.store(0, std::memory_order_relaxed);
+  g_segment->sequence.store(0, std::memory_order_relaxed);
+  g_segment->update_time = 0;
+  g_segment->pid         = getpid();
+  g_entries              = reinterpret_cast<RecStatsSegmentEntry *>(static_cast<char *>(base) + entries_offset());
+  g_values               = reinterpret_cast<RecStatsSegmentValue *>(static_cast<char *>(base) + values_offset(REC_MAX_RECORDS));
+
+  g_slots.assign(REC_MAX_RECORDS, -1);
+  g_staged.resize(REC_MAX_RECORDS);
+
+  if (rename(tmp.c_str(), path.c_str()) < 0) {
+    Warning("unable to rename stats segment '%s': %s", tmp.c_str(), strerror(errno));
+    munmap(base, size);
+    g_segment = nullptr;
+    return;
+  }
+
+  Note("stats segment '%s' with room for %d stats", path.c_str(), REC_MAX_RECORDS);
+}
+
+//-------------------------------------------------------------------------
+// RecStatsSegmentStage
+//-------------------------------------------------------------------------
+void
+RecStatsSegmentStage(int rec_idx, const RecRecord *r)
+{
+  if (g_segment == nullptr || rec_idx >= REC_MAX_RECORDS) {
+    return;
+  }
+
+  int slot = g_slots[rec_idx];
+  if (slot == -1) {
+    // A new stat, its name is published with the next values.
+    if (strlen(r->name) >= REC_STATS_SEGMENT_NAME_LEN) {
+      Warning("stat name '%s' is too long for the stats segment", r->name);
+      g_slots[rec_idx] = -2;
+      return;
+    }
+    slot = g_num_staged++;
+    ink_strlcpy(g_entries[slot].name, r->name, REC_STATS_SEGMENT_NAME_LEN);
+    g_entries[slot].data_type = r->data_type;
+    g_slots[rec_idx]          = slot;
+  } else if (slot < 0) {
+    return;
+  }
+
+  RecStatsSegmentValue &value = g_staged[slot];
+  switch (r->data_type) {
+  case RECD_INT:
+    value.rec_int = r->data.rec_int;
+    break;
+  case RECD_COUNTER:
+    value.rec_int = r->data.rec_counter;
+    break;
+  case RECD_FLOAT:
+    value.rec_float = r->data.rec_float;
+    break;
+  case RECD_STRING:
+    ink_strlcpy(value.rec_string, r->data.rec_string ? r->data.rec_string : "", REC_STATS_SEGMENT_STRING_LEN);
+    break;
+  default:
+    break;
+  }
+}
+
+//-------------------------------------------------------------------------
+// RecStatsSegmentPublish
+//-------------------------------------------------------------------------
+void
+RecStatsSegmentPublish()
+{
+  if (g_segment == nullptr) {
+    return;
+  }
+
+  uint64_t seq = g_segment->sequence.load(std::memory_order_relaxed);
+
+  g_segment->sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(g_values, g_staged.data(), g_num_staged * sizeof(RecStatsSegmentValue));
+  g_segment->update_time = time(nullptr);
+  g_segment->sequence.store(seq + 2, std::memory_order_release);
+
+  // The names of new stats were written during staging.
+  g_segment->num_entries.store(g_num_staged, std::memory_order_release);
+}
+
+//-------------------------------------------------------------------------
+// RecStatsSegmentReader
+//-------------------------------------------------------------------------
+RecStatsSegmentReader::~RecStatsSegmentReader()
+{
+  close();
+}
+
+bool
+RecStatsSegmentReader::open(const char *path)
+{
+  struct stat st;
+
+  close();
+  _path = path;
+
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(RecStatsSegmentHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  const RecStatsSegmentHeader *header = static_cast<const RecStatsSegmentHeader *>(base);
+  if (header->magic != REC_STATS_SEGMENT_MAGIC || header->version != REC_STATS_SEGMENT_VERSION ||
+      RecStatsSegmentSize(header->max_entries) > static_cast<size_t>(st.st_size)) {
+    munmap(base, st.st_size);
+    return false;
+  }
+
+  _base    = base;
+  _size    = st.st_size;
+  _inode   = st.st_ino;
+  _header  = header;
+  _entries = reinterpret_cast<const RecStatsSegmentEntry *>(static_cast<const char *>(base) + entries_offset());
+  _shared  = reinterpret_cast<const RecStatsSegmentValue *>(static_cast<const char *>(base) + values_offset(header->max_entries));
+  return true;
+}
+
+void
+RecStatsSegmentReader::close()
+{
+  if (_base) {
+    munmap(_base, _size);
+  }
+  _base        = nullptr;
+  _size        = 0;
+  _header      = nullptr;
+  _entries     = nullptr;
+  _shared      = nullptr;
+  _update_time = 0;
+  _values.clear();
+  _index.clear();
+}
+
+bool
+RecStatsSegmentReader::reopen_if_replaced()
+{
+  struct stat st;
+
+  if (stat(_path.c_str(), &st) < 0) {
+    return is_open();
+  }
+  if (is_open() && st.st_ino == _inode) {
+    return true;
+  }
+
+  std::string path(_path);
+  return open(path.c_str());
+}
+
+bool
+RecStatsSegmentReader::snapshot()
+{
+  if (!is_open()) {
+    return false;
+  }
+
+  uint32_t n = std::min(_header->num_entries.load(std::memory_order_acquire), _header->max_entries);
+
+  // Names are immutable once published.
+  for (uint32_t i = _values.size(); i < n; ++i) {
+    _index.emplace(std::string(_entries[i].name, strnlen(_entries[i].name, REC_STATS_SEGMENT_NAME_LEN)), i);
+  }
+  _values.resize(n);
+
+  for (int attempt = 0; attempt < SNAPSHOT_RETRIES; ++attempt) {
+    uint64_t before = _header->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      sched_yield();
+      continue;
+    }
+    memcpy(_values.data(), _shared, n * sizeof(RecStatsSegmentValue));
+    int64_t update_time = _header->update_time;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_header->sequence.load(std::memory_order_relaxed) == before) {
+      _update_time = update_time;
+      return true;
+    }
+  }
+  return false;
+}
+
+int
+RecStatsSegmentReader::find(const char *name) const
+{
+  auto spot = _index.find(name);
+  return spot == _index.end() ? -1 : spot->second;
+}
+
+const char *
+RecStatsSegmentReader::name(int idx) const
+{
+  return _entries[idx].name;
+}
+
+RecDataT
+RecStatsSegmentReader::type(int idx) const
+{
+  return static_cast<RecDataT>(_entries[idx].data_type);
+}
+
+int64_t
+RecStatsSegmentReader::get_int(int idx) const
+{
+  switch (type(idx)) {
+  case RECD_INT:
+  case RECD_COUNTER:
+    return _values[idx].rec_int;
+  case RECD_FLOAT:
+    return static_cast<int64_t>(_values[idx].rec_float);
+  default:
+    return 0;
+  }
+}
+
+double
+RecStatsSegmentReader::get_float(int idx) const
+{
+  return type(idx) == RECD_FLOAT ? _values[idx].rec_float : static_cast<double>(get_int(idx));
+}
+
+const char *
+RecStatsSegmentReader::get_string(int idx) const
+{
+  if (type(idx) != RECD_STRING) {
+    return "";
+  }
+  // The writer keeps strings terminated, but do not trust the copy of a torn update.
+  const char *s = _values[idx].rec_string;
+  return memchr(s, '\0', REC_STATS_SEGMENT_STRING_LEN) ? s : "";
+}
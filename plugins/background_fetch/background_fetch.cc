@@ -31,6 +31,7 @@
 #include <cinttypes>
 #include <string_view>
 #include <array>
+#include <deque>
 
 #include "ts/ts.h"
 #include "ts/remap.h"
@@ -55,12 +56,26 @@ static const std::array<const std::string_view, 6> FILTER_HEADERS{
 // Hold the global background fetch state. This is currently shared across all
 // configurations, as a singleton. ToDo: Would it ever make sense to do this
 // per remap rule? Maybe for per-remap logging ??
-typedef std::unordered_map<std::string, bool> OutstandingRequests;
+//
+// This is also the scheduler of the fetches: a fetch runs right away unless
+// that would exceed the limit of running fetches, in total or to its origin.
+// Otherwise it waits in a bounded queue, and the queued fetch that was asked
+// for the most times runs next.
+struct BgFetchData;
 
 class BgFetchState
 {
 public:
-  BgFetchState()                     = default;
+  enum Admission { RUN, QUEUED, DUPLICATE, DROPPED };
+
+  BgFetchState()
+  {
+    _stats[STAT_QUEUED]       = createStat("queued");
+    _stats[STAT_RUNNING]      = createStat("running");
+    _stats[STAT_DROPPED]      = createStat("dropped");
+    _stats[STAT_DEDUPLICATED] = createStat("deduplicated");
+  }
+
   BgFetchState(BgFetchState const &) = delete;
   void operator=(BgFetchState const &) = delete;
 
@@ -90,44 +105,68 @@ public:
     return _log;
   }
 
-  bool
-  acquire(const std::string &url)
+  // The limits are global too, the last configuration to set them wins.
+  void
+  setLimits(const BgFetchConfig &config)
   {
-    bool ret;
-
     TSMutexLock(_lock);
-    if (_urls.end() == _urls.find(url)) {
-      _urls[url] = true;
-      ret        = true;
-    } else {
-      ret = false;
-    }
+    _max_fetches    = config.maxFetches();
+    _origin_fetches = config.originFetches();
+    _max_queued     = config.maxQueued();
     TSMutexUnlock(_lock);
+    TSDebug(PLUGIN_NAME, "Limits: %d fetches, %d per origin, %d queued", _max_fetches, _origin_fetches, _max_queued);
+  }
 
-    TSDebug(PLUGIN_NAME, "BgFetchState.acquire(): ret = %d, url = %s", ret, url.c_str());
+  Admission submit(BgFetchData *data);
+  BgFetchData *finish(const BgFetchData *data);
 
-    return ret;
-  }
+private:
+  enum { STAT_QUEUED, STAT_RUNNING, STAT_DROPPED, STAT_DEDUPLICATED, N_STATS };
 
-  bool
-  release(const std::string &url)
+  struct Origin {
+    int running = 0;
+    std::deque<BgFetchData *> queue;
+  };
+
+  static int
+  createStat(const char *name)
   {
-    bool ret;
+    std::string full = std::string("plugin.") + PLUGIN_NAME + ".fetches." + name;
+    int id;
 
-    TSMutexLock(_lock);
-    if (_urls.end() == _urls.find(url)) {
-      ret = false;
-    } else {
-      _urls.erase(url);
-      ret = true;
+    if (TS_ERROR == TSStatFindName(full.c_str(), &id)) {
+      id = TSStatCreate(full.c_str(), TS_RECORDDATATYPE_INT, TS_STAT_NON_PERSISTENT, TS_STAT_SYNC_SUM);
+      if (TS_ERROR == id) {
+        TSError("[%s] Failed to create the %s statistic", PLUGIN_NAME, full.c_str());
+      }
     }
-    TSMutexUnlock(_lock);
+    return id;
+  }
+
+  void
+  statIncrement(int stat, int64_t n = 1) const
+  {
+    if (TS_ERROR != _stats[stat]) {
+      TSStatIntIncrement(_stats[stat], n);
+    }
+  }
 
-    return ret;
+  bool
+  canRun(const Origin &origin) const
+  {
+    return (0 == _max_fetches || _running < _max_fetches) && (0 == _origin_fetches || origin.running < _origin_fetches);
   }
 
-private:
-  OutstandingRequests _urls;
+  BgFetchData *dequeue();
+
+  std::unordered_map<std::string, BgFetchData *> _urls; // Running or queued, by cache URL
+  std::unordered_map<std::string, Origin> _origins;
+  int _running        = 0;
+  int _queued         = 0;
+  int _max_fetches    = 0;
+  int _origin_fetches = 0;
+  int _max_queued     = 0;
+  int _stats[N_STATS];
   TSTextLogObject _log = nullptr;
   TSMutex _lock        = TSMutexCreate();
 };
@@ -152,10 +191,13 @@ struct BgFetchData {
       vc = nullptr;
     }
 
-    // If we got schedule, also clean that up
+    // If we got schedule, also clean that up, and start the next fetch if one was waiting for this.
     if (_cont) {
-      releaseUrl();
+      BgFetchData *next = BgFetchState::getInstance().finish(this);
 
+      if (next) {
+        next->schedule();
+      }
       TSContDestroy(_cont);
       _cont = nullptr;
       TSIOBufferReaderFree(req_io_buf_reader);
@@ -165,23 +207,21 @@ struct BgFetchData {
     }
   }
 
-  bool
-  acquireUrl() const
-  {
-    return BgFetchState::getInstance().acquire(_url);
-  }
-  bool
-  releaseUrl() const
+  const std::string &
+  getUrl() const
   {
-    return BgFetchState::getInstance().release(_url);
+    return _url;
   }
 
-  const char *
-  getUrl() const
+  const std::string &
+  getOrigin() const
   {
-    return _url.c_str();
+    return _origin;
   }
 
+  // How many times this fetch was asked for, only touched by the BgFetchState while it holds its lock.
+  int hits = 1;
+
   void
   addBytes(int64_t b)
   {
@@ -209,6 +249,7 @@ struct BgFetchData {
 
 private:
   std::string _url;
+  std::string _origin;
   int64_t _bytes = 0;
   TSCont _cont   = nullptr;
 };
@@ -244,6 +285,18 @@ BgFetchData::initialize(TSMBuffer request, TSMLoc req_hdr, TSHttpTxn txnp)
     return false;
   }
 
+  // The request is remapped by now, so its URL has the origin host the fetch is limited by.
+  TSMLoc o_url;
+  if (TS_SUCCESS == TSHttpHdrUrlGet(request, req_hdr, &o_url)) {
+    int len;
+    const char *host = TSUrlHostGet(request, o_url, &len);
+
+    if (host) {
+      _origin.assign(host, len);
+    }
+    TSHandleMLocRelease(request, req_hdr, o_url);
+  }
+
   hdr_loc = TSHttpHdrCreate(mbuf);
   if (TS_SUCCESS == TSHttpHdrCopy(mbuf, hdr_loc, request, req_hdr)) {
     TSMLoc p_url;
@@ -318,6 +371,122 @@ BgFetchData::schedule()
   TSContSchedule(_cont, 0, TS_THREAD_POOL_NET);
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Admit a new fetch: it either runs, waits, is already running or waiting (its
+// popularity goes up), or is dropped because the queue is full. Only a fetch
+// that is to RUN or is QUEUED is kept, the caller deletes the others.
+BgFetchState::Admission
+BgFetchState::submit(BgFetchData *data)
+{
+  Admission ret;
+
+  TSMutexLock(_lock);
+  auto known = _urls.find(data->getUrl());
+
+  if (_urls.end() != known) {
+    ++known->second->hits;
+    ret = DUPLICATE;
+  } else {
+    Origin &origin = _origins[data->getOrigin()];
+
+    if (canRun(origin)) {
+      ++origin.running;
+      ++_running;
+      ret = RUN;
+    } else if (0 == _max_queued || _queued < _max_queued) {
+      origin.queue.push_back(data);
+      ++_queued;
+      ret = QUEUED;
+    } else {
+      if (0 == origin.running && origin.queue.empty()) {
+        _origins.erase(data->getOrigin());
+      }
+      ret = DROPPED;
+    }
+    if (DROPPED != ret) {
+      _urls[data->getUrl()] = data;
+    }
+  }
+  TSMutexUnlock(_lock);
+
+  switch (ret) {
+  case RUN:
+    statIncrement(STAT_RUNNING);
+    break;
+  case QUEUED:
+    statIncrement(STAT_QUEUED);
+    break;
+  case DUPLICATE:
+    statIncrement(STAT_DEDUPLICATED);
+    break;
+  case DROPPED:
+    statIncrement(STAT_DROPPED);
+    break;
+  }
+  TSDebug(PLUGIN_NAME, "BgFetchState.submit(): ret = %d, url = %s", ret, data->getUrl().c_str());
+
+  return ret;
+}
+
+// A running fetch is done, @return the queued fetch to run in its place, if any.
+BgFetchData *
+BgFetchState::finish(const BgFetchData *data)
+{
+  BgFetchData *next;
+
+  TSMutexLock(_lock);
+  auto origin = _origins.find(data->getOrigin());
+
+  _urls.erase(data->getUrl());
+  --_running;
+  if (_origins.end() != origin && 0 == --origin->second.running && origin->second.queue.empty()) {
+    _origins.erase(origin);
+  }
+  next = dequeue();
+  TSMutexUnlock(_lock);
+
+  statIncrement(STAT_RUNNING, -1);
+  if (next) {
+    statIncrement(STAT_QUEUED, -1);
+    statIncrement(STAT_RUNNING);
+  }
+
+  return next;
+}
+
+// Take the most popular queued fetch that may run now, the oldest of those on a tie. The queue
+// is bounded, so a scan is fine. Called with the lock held.
+BgFetchData *
+BgFetchState::dequeue()
+{
+  Origin *best_origin = nullptr;
+  std::deque<BgFetchData *>::iterator best;
+
+  for (auto &origin : _origins) {
+    if (canRun(origin.second)) {
+      for (auto it = origin.second.queue.begin(); it != origin.second.queue.end(); ++it) {
+        if (!best_origin || (*it)->hits > (*best)->hits) {
+          best_origin = &origin.second;
+          best        = it;
+        }
+      }
+    }
+  }
+
+  if (!best_origin) {
+    return nullptr;
+  }
+
+  BgFetchData *data = *best;
+
+  best_origin->queue.erase(best);
+  ++best_origin->running;
+  ++_running;
+  --_queued;
+
+  return data;
+}
+
 // Log format is:
 //    remap-tag bytes status url
 void
@@ -473,9 +642,19 @@ cont_check_cacheable(TSCont contp, TSEvent /* event ATS_UNUSED */, void *edata)
       if (cacheable) {
         BgFetchData *data = new BgFetchData();
 
-        // Initialize the data structure (can fail) and acquire a privileged lock on the URL
-        if (data->initialize(request, req_hdr, txnp) && data->acquireUrl()) {
-          data->schedule();
+        // Initialize the data structure (can fail) and hand it to the scheduler, which also
+        // makes sure there is only one fetch per URL.
+        if (data->initialize(request, req_hdr, txnp)) {
+          switch (BgFetchState::getInstance().submit(data)) {
+          case BgFetchState::RUN:
+            data->schedule();
+            break;
+          case BgFetchState::QUEUED:
+            break;
+          default:
+            delete data;
+            break;
+          }
         } else {
           delete data; // Not sure why this would happen, but ok.
         }
@@ -567,6 +746,9 @@ TSPluginInit(int argc, const char *argv[])
     TSError("[%s] Plugin registration failed", PLUGIN_NAME);
   }
 
+  // Creates the statistics.
+  BgFetchState::getInstance();
+
   TSCont cont = TSContCreate(cont_handle_response, nullptr);
 
   gConfig = new BgFetchConfig(cont);
@@ -577,6 +759,9 @@ TSPluginInit(int argc, const char *argv[])
     if (!gConfig->logFile().empty()) {
       BgFetchState::getInstance().createLog(gConfig->logFile());
     }
+    if (gConfig->hasLimits()) {
+      BgFetchState::getInstance().setLimits(*gConfig);
+    }
     TSDebug(PLUGIN_NAME, "Initialized");
     TSHttpHookAdd(TS_HTTP_READ_RESPONSE_HDR_HOOK, cont);
   } else {
@@ -605,6 +790,9 @@ TSRemapInit(TSRemapInterface *api_info, char *errbuf, int errbuf_size)
     return TS_ERROR;
   }
 
+  // Creates the statistics.
+  BgFetchState::getInstance();
+
   TSDebug(PLUGIN_NAME, "background fetch remap is successfully initialized");
   return TS_SUCCESS;
 }
@@ -637,6 +825,9 @@ TSRemapNewInstance(int argc, char *argv[], void **ih, char * /* errbuf */, int /
       if (config->logFile().size()) {
         BgFetchState::getInstance().createLog(config->logFile());
       }
+      if (config->hasLimits()) {
+        BgFetchState::getInstance().setLimits(*config);
+      }
     } else {
       success = false;
     }
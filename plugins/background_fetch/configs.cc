@@ -25,6 +25,7 @@
 #include <getopt.h>
 #include <cstdio>
 #include <memory.h>
+#include <algorithm>
 
 #include "configs.h"
 
@@ -37,6 +38,9 @@ BgFetchConfig::parseOptions(int argc, const char *argv[])
   static const struct option longopt[] = {{const_cast<char *>("log"), required_argument, nullptr, 'l'},
                                           {const_cast<char *>("config"), required_argument, nullptr, 'c'},
                                           {const_cast<char *>("allow-304"), no_argument, nullptr, 'a'},
+                                          {const_cast<char *>("max-fetches"), required_argument, nullptr, 'f'},
+                                          {const_cast<char *>("origin-fetches"), required_argument, nullptr, 'o'},
+                                          {const_cast<char *>("max-queued"), required_argument, nullptr, 'q'},
                                           {nullptr, no_argument, nullptr, '\0'}};
 
   while (true) {
@@ -62,6 +66,21 @@ BgFetchConfig::parseOptions(int argc, const char *argv[])
       TSDebug(PLUGIN_NAME, "option: --allow-304 set");
       _allow_304 = true;
       break;
+    case 'f':
+      TSDebug(PLUGIN_NAME, "option: --max-fetches %s", optarg);
+      _max_fetches = std::max(0, atoi(optarg));
+      _has_limits  = true;
+      break;
+    case 'o':
+      TSDebug(PLUGIN_NAME, "option: --origin-fetches %s", optarg);
+      _origin_fetches = std::max(0, atoi(optarg));
+      _has_limits     = true;
+      break;
+    case 'q':
+      TSDebug(PLUGIN_NAME, "option: --max-queued %s", optarg);
+      _max_queued = std::max(0, atoi(optarg));
+      _has_limits = true;
+      break;
     default:
       TSError("[%s] invalid plugin option: %c", PLUGIN_NAME, opt);
       return false;
@@ -32,6 +32,8 @@
 
 // Constants
 const char PLUGIN_NAME[] = "background_fetch";
+// Fetches waiting for a slot, when the running fetches are limited.
+const int DEFAULT_MAX_QUEUED = 1000;
 
 ///////////////////////////////////////////////////////////////////////////
 // This holds one complete background fetch rule, which is also ref-counted.
@@ -75,6 +77,31 @@ public:
     return _allow_304;
   }
 
+  // Limits of the background fetches, 0 is unlimited.
+  int
+  maxFetches() const
+  {
+    return _max_fetches;
+  }
+
+  int
+  originFetches() const
+  {
+    return _origin_fetches;
+  }
+
+  int
+  maxQueued() const
+  {
+    return _max_queued;
+  }
+
+  bool
+  hasLimits() const
+  {
+    return _has_limits;
+  }
+
   // This parses and populates the BgFetchRule linked list (_rules).
   bool readConfig(const char *file_name);
 
@@ -84,5 +111,9 @@ private:
   TSCont _cont        = nullptr;
   BgFetchRule *_rules = nullptr;
   bool _allow_304     = false;
+  bool _has_limits    = false;
+  int _max_fetches    = 0;
+  int _origin_fetches = 0;
+  int _max_queued     = DEFAULT_MAX_QUEUED;
   std::string _log_file;
 };
@@ -32,10 +32,16 @@
 #include "ts/remap.h"
 #include "tscore/ink_config.h"
 
+#include "counting_bloom.h"
+
 #define MINIMUM_BUCKET_SIZE 10
 
 static const char *PLUGIN_NAME = "cache_promote";
 
+// Stats, shared by all remap rules using this plugin
+static int lookups_stat  = -1;
+static int promoted_stat = -1;
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 // Note that all options for all policies has to go here. Not particularly pretty...
 //
@@ -43,7 +49,7 @@ static const struct option longopt[] = {
   {const_cast<char *>("policy"), required_argument, nullptr, 'p'},
   // This is for both Chance and LRU (optional) policy
   {const_cast<char *>("sample"), required_argument, nullptr, 's'},
-  // For the LRU policy
+  // For the LRU and Bloom policies
   {const_cast<char *>("buckets"), required_argument, nullptr, 'b'},
   {const_cast<char *>("hits"), required_argument, nullptr, 'h'},
   // EOF
@@ -100,6 +106,13 @@ public:
     return false;
   }
 
+  // Called once all options are parsed
+  virtual bool
+  stage()
+  {
+    return true;
+  }
+
   // These are pure virtual
   virtual bool doPromote(TSHttpTxn txnp) = 0;
   virtual const char *policyName() const = 0;
@@ -144,6 +157,7 @@ public:
 class LRUHash
 {
   friend struct LRUHashHasher;
+  friend class BloomPolicy;
 
 public:
   LRUHash() { TSDebug(PLUGIN_NAME, "In LRUHash()"); }
@@ -192,6 +206,30 @@ typedef std::unordered_map<const LRUHash *, LRUList::iterator, LRUHashHasher, LR
 
 static LRUEntry NULL_LRU_ENTRY; // Used to create an "empty" new LRUEntry
 
+// Get the cache key URL (for now), since this has better lookup behavior when using
+// e.g. the cachekey plugin. The returned string has to be TSfree()'d.
+static char *
+get_cache_url(TSHttpTxn txnp, int *url_len)
+{
+  char *url = nullptr;
+  TSMBuffer request;
+  TSMLoc req_hdr;
+
+  if (TS_SUCCESS == TSHttpTxnClientReqGet(txnp, &request, &req_hdr)) {
+    TSMLoc c_url = TS_NULL_MLOC;
+
+    if (TS_SUCCESS == TSUrlCreate(request, &c_url)) {
+      if (TS_SUCCESS == TSHttpTxnCacheLookupUrlGet(txnp, request, c_url)) {
+        url = TSUrlStringGet(request, c_url, url_len);
+        TSHandleMLocRelease(request, TS_NULL_MLOC, c_url);
+      }
+    }
+    TSHandleMLocRelease(request, TS_NULL_MLOC, req_hdr);
+  }
+
+  return url;
+}
+
 class LRUPolicy : public PromotionPolicy
 {
 public:
@@ -243,25 +281,9 @@ public:
   {
     LRUHash hash;
     LRUMap::iterator map_it;
-    char *url   = nullptr;
     int url_len = 0;
+    char *url   = get_cache_url(txnp, &url_len);
     bool ret    = false;
-    TSMBuffer request;
-    TSMLoc req_hdr;
-
-    if (TS_SUCCESS == TSHttpTxnClientReqGet(txnp, &request, &req_hdr)) {
-      TSMLoc c_url = TS_NULL_MLOC;
-
-      // Get the cache key URL (for now), since this has better lookup behavior when using
-      // e.g. the cachekey plugin.
-      if (TS_SUCCESS == TSUrlCreate(request, &c_url)) {
-        if (TS_SUCCESS == TSHttpTxnCacheLookupUrlGet(txnp, request, c_url)) {
-          url = TSUrlStringGet(request, c_url, &url_len);
-          TSHandleMLocRelease(request, TS_NULL_MLOC, c_url);
-        }
-      }
-      TSHandleMLocRelease(request, TS_NULL_MLOC, req_hdr);
-    }
 
     // Generally shouldn't happen ...
     if (!url) {
@@ -343,6 +365,102 @@ private:
   size_t _list_size, _freelist_size;
 };
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+// The Bloom policy has the same <buckets> and <hits> semantics as the LRU policy, but keeps
+// the counters in a counting Bloom filter instead of a locked list. Each URL maps to a few
+// 8-bit counters, which are updated with atomic operations only, so concurrent transactions
+// never wait on each other. The estimated hit count of a URL is the smallest of its counters.
+//
+// Instead of evicting the least recently used entry, every request halves a few counters,
+// such that all of them are halved once per <buckets> requests. A URL that is not requested
+// again is forgotten after a few such periods, much like it falls off the end of the LRU.
+//
+class BloomPolicy : public PromotionPolicy
+{
+public:
+  BloomPolicy() : PromotionPolicy() {}
+  ~BloomPolicy() override { TSDebug(PLUGIN_NAME, "deleting BloomPolicy object"); }
+
+  bool
+  parseOption(int opt, char *optarg) override
+  {
+    switch (opt) {
+    case 'b':
+      _buckets = static_cast<unsigned>(strtol(optarg, nullptr, 10));
+      if (_buckets < MINIMUM_BUCKET_SIZE) {
+        TSError("%s: Enforcing minimum bucket size of %d", PLUGIN_NAME, MINIMUM_BUCKET_SIZE);
+        _buckets = MINIMUM_BUCKET_SIZE;
+      }
+      break;
+    case 'h':
+      _hits = static_cast<unsigned>(strtol(optarg, nullptr, 10));
+      if (_hits > UINT8_MAX) {
+        TSError("%s: Enforcing maximum hits of %d for the bloom policy", PLUGIN_NAME, UINT8_MAX);
+        _hits = UINT8_MAX;
+      }
+      break;
+    default:
+      // All other options are unsupported for this policy
+      return false;
+    }
+
+    return true;
+  }
+
+  bool
+  stage() override
+  {
+    _filter.init(_buckets);
+    TSDebug(PLUGIN_NAME, "BloomPolicy using %zu counters for %u buckets", _filter.size(), _buckets);
+
+    return true;
+  }
+
+  bool
+  doPromote(TSHttpTxn txnp) override
+  {
+    LRUHash hash;
+    int url_len = 0;
+    char *url   = get_cache_url(txnp, &url_len);
+
+    // Generally shouldn't happen ...
+    if (!url) {
+      return false;
+    }
+
+    TSDebug(PLUGIN_NAME, "BloomPolicy::doPromote(%.*s%s)", url_len > 100 ? 100 : url_len, url, url_len > 100 ? "..." : "");
+    hash.init(url, url_len);
+    TSfree(url);
+
+    // The SHA1 is 20 bytes, plenty for four independent 32-bit slot indexes
+    static_assert(CountingBloom::HASH_SIZE <= sizeof(hash._hash), "not enough hash bits for the bloom filter");
+    if (_filter.hit(hash._hash, _hits)) {
+      return true;
+    }
+
+    TSDebug(PLUGIN_NAME, "still not promoted, got %u hits so far", _filter.count(hash._hash));
+    return false;
+  }
+
+  void
+  usage() const override
+  {
+    TSError("[%s] Usage: @plugin=%s.so @pparam=--policy=bloom @pparam=--buckets=<n> --hits=<m> --sample=<x>", PLUGIN_NAME,
+            PLUGIN_NAME);
+  }
+
+  const char *
+  policyName() const override
+  {
+    return "Bloom";
+  }
+
+private:
+  unsigned _buckets = 1000;
+  unsigned _hits    = 10;
+  CountingBloom _filter;
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 // This holds the configuration for a remap rule, as well as parses the configurations.
 //
@@ -371,6 +489,8 @@ public:
           _policy = new ChancePolicy();
         } else if (0 == strncasecmp(optarg, "lru", 3)) {
           _policy = new LRUPolicy();
+        } else if (0 == strncasecmp(optarg, "bloom", 5)) {
+          _policy = new BloomPolicy();
         } else {
           TSError("[%s] Unknown policy --policy=%s", PLUGIN_NAME, optarg);
           return false;
@@ -398,7 +518,7 @@ public:
       }
     }
 
-    return true;
+    return _policy ? _policy->stage() : true;
   }
 
 private:
@@ -429,8 +549,10 @@ cont_handle_policy(TSCont contp, TSEvent event, void *edata)
         switch (obj_status) {
         case TS_CACHE_LOOKUP_MISS:
         case TS_CACHE_LOOKUP_SKIPPED:
+          TSStatIntIncrement(lookups_stat, 1);
           if (config->getPolicy()->doSample() && config->getPolicy()->doPromote(txnp)) {
             TSDebug(PLUGIN_NAME, "cache-status is %d, and leaving cache on (promoted)", obj_status);
+            TSStatIntIncrement(promoted_stat, 1);
           } else {
             TSDebug(PLUGIN_NAME, "cache-status is %d, and turning off the cache (not promoted)", obj_status);
             TSHttpTxnServerRespNoStoreSet(txnp, 1);
@@ -475,6 +597,15 @@ TSRemapInit(TSRemapInterface *api_info, char *errbuf, int errbuf_size)
     return TS_ERROR;
   }
 
+  if (TS_ERROR == TSStatFindName("plugin.cache_promote.lookups", &lookups_stat)) {
+    lookups_stat =
+      TSStatCreate("plugin.cache_promote.lookups", TS_RECORDDATATYPE_INT, TS_STAT_NON_PERSISTENT, TS_STAT_SYNC_COUNT);
+  }
+  if (TS_ERROR == TSStatFindName("plugin.cache_promote.promoted", &promoted_stat)) {
+    promoted_stat =
+      TSStatCreate("plugin.cache_promote.promoted", TS_RECORDDATATYPE_INT, TS_STAT_NON_PERSISTENT, TS_STAT_SYNC_COUNT);
+  }
+
   TSDebug(PLUGIN_NAME, "remap plugin is successfully initialized");
   return TS_SUCCESS; /* success */
 }
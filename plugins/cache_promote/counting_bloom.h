@@ -0,0 +1,146 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// A counting Bloom filter of the hits on URLs, updated with atomic operations only. The
+// count of a URL is the lowest of its counters, other URLs sharing those counters can only
+// make it higher. Counters are aged by halving them, a few counters on every request, such
+// that all of them have been halved once every <buckets> requests.
+//
+class CountingBloom
+{
+public:
+  static const unsigned NUM_HASHES      = 4; // Counters per URL
+  static const unsigned SLOTS_PER_ENTRY = 4; // Counters allocated per bucket
+  static const size_t HASH_SIZE         = NUM_HASHES * sizeof(uint32_t);
+
+  // Size the filter for <buckets> URLs
+  void
+  init(unsigned buckets)
+  {
+    // Round up to a power of two, such that a slot is just a mask away
+    size_t slots = 1;
+
+    while (slots < static_cast<size_t>(buckets) * SLOTS_PER_ENTRY) {
+      slots <<= 1;
+    }
+    _mask      = slots - 1;
+    _age_slice = (slots + buckets - 1) / buckets;
+    _counters  = std::unique_ptr<std::atomic<uint8_t>[]>(new std::atomic<uint8_t>[slots]);
+    for (size_t i = 0; i < slots; ++i) {
+      _counters[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  size_t
+  size() const
+  {
+    return _mask + 1;
+  }
+
+  // Count a hit on the URL with the (at least HASH_SIZE bytes) digest <hash>. Returns true if
+  // the URL reached <hits> and is promoted, its hits are then taken back out of the filter.
+  // Like the LRU policy, a URL is never promoted on its first hit.
+  bool
+  hit(const unsigned char *hash, unsigned hits)
+  {
+    uint32_t slot[NUM_HASHES];
+    unsigned count = UINT8_MAX;
+
+    hits = std::min(std::max(hits, 2U), static_cast<unsigned>(UINT8_MAX));
+    memcpy(slot, hash, sizeof(slot));
+    for (unsigned i = 0; i < NUM_HASHES; ++i) {
+      count = std::min(count, increment(_counters[slot[i] & _mask]));
+    }
+    age();
+
+    if (count >= hits) {
+      for (unsigned i = 0; i < NUM_HASHES; ++i) {
+        decrement(_counters[slot[i] & _mask], hits);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  // The estimated hits on the URL with the digest <hash>
+  unsigned
+  count(const unsigned char *hash) const
+  {
+    uint32_t slot[NUM_HASHES];
+    unsigned count = UINT8_MAX;
+
+    memcpy(slot, hash, sizeof(slot));
+    for (unsigned i = 0; i < NUM_HASHES; ++i) {
+      count = std::min(count, static_cast<unsigned>(_counters[slot[i] & _mask].load(std::memory_order_relaxed)));
+    }
+    return count;
+  }
+
+private:
+  // Saturating increment, returns the new value
+  static unsigned
+  increment(std::atomic<uint8_t> &counter)
+  {
+    uint8_t c = counter.load(std::memory_order_relaxed);
+
+    while (c < UINT8_MAX && !counter.compare_exchange_weak(c, static_cast<uint8_t>(c + 1), std::memory_order_relaxed)) {
+      ;
+    }
+    return c < UINT8_MAX ? c + 1 : c;
+  }
+
+  static void
+  decrement(std::atomic<uint8_t> &counter, unsigned n)
+  {
+    uint8_t c = counter.load(std::memory_order_relaxed);
+
+    while (!counter.compare_exchange_weak(c, static_cast<uint8_t>(c > n ? c - n : 0), std::memory_order_relaxed)) {
+      ;
+    }
+  }
+
+  // Halve the next slice of counters, each request takes its own slice so there is no waiting on other threads
+  void
+  age()
+  {
+    size_t start = _age_cursor.fetch_add(_age_slice, std::memory_order_relaxed);
+
+    for (size_t i = start; i < start + _age_slice; ++i) {
+      std::atomic<uint8_t> &counter = _counters[i & _mask];
+      uint8_t c                     = counter.load(std::memory_order_relaxed);
+
+      while (c > 0 && !counter.compare_exchange_weak(c, static_cast<uint8_t>(c >> 1), std::memory_order_relaxed)) {
+        ;
+      }
+    }
+  }
+
+  size_t _mask      = 0;
+  size_t _age_slice = 1;
+  std::unique_ptr<std::atomic<uint8_t>[]> _counters;
+  std::atomic<size_t> _age_cursor{0};
+};
@@ -0,0 +1,107 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * @file test_cache_promote.cc
+ * @brief Unit tests for the counting Bloom filter of the cache_promote bloom policy.
+ */
+
+#define CATCH_CONFIG_MAIN /* include main function */
+#include <catch.hpp>      /* catch unit-test framework */
+#include <cstdint>
+#include <cstring>
+#include "../counting_bloom.h"
+
+namespace
+{
+// A digest for URL number <n>, spread over all the bits like the SHA1 of the URL would be.
+struct Digest {
+  unsigned char bytes[CountingBloom::HASH_SIZE];
+
+  explicit Digest(uint64_t n)
+  {
+    for (size_t i = 0; i < sizeof(bytes); i += sizeof(uint64_t)) {
+      uint64_t z = (n += 0x9e3779b97f4a7c15ULL);
+      z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z          = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      z ^= z >> 31;
+      memcpy(bytes + i, &z, sizeof(z));
+    }
+  }
+};
+
+const unsigned BUCKETS = 1000;
+} // namespace
+
+TEST_CASE("CountingBloom sizing", "[cache_promote][bloom]")
+{
+  CountingBloom filter;
+
+  filter.init(BUCKETS);
+  REQUIRE(filter.size() == 4096);
+  REQUIRE(filter.count(Digest(1).bytes) == 0);
+}
+
+TEST_CASE("CountingBloom promotes after hits", "[cache_promote][bloom]")
+{
+  CountingBloom filter;
+  Digest url(1);
+
+  filter.init(BUCKETS);
+  for (unsigned i = 1; i < 10; ++i) {
+    REQUIRE(!filter.hit(url.bytes, 10));
+  }
+  REQUIRE(filter.hit(url.bytes, 10));
+
+  // The hits were taken back out, it starts over
+  REQUIRE(filter.count(url.bytes) < 10);
+  REQUIRE(!filter.hit(url.bytes, 10));
+}
+
+TEST_CASE("CountingBloom never promotes on the first hit", "[cache_promote][bloom]")
+{
+  CountingBloom filter;
+
+  filter.init(BUCKETS);
+  for (unsigned hits = 0; hits <= 2; ++hits) {
+    Digest url(100 + hits);
+
+    // Same as the LRU policy, the second hit is the earliest to promote
+    REQUIRE(!filter.hit(url.bytes, hits));
+    REQUIRE(filter.hit(url.bytes, hits));
+  }
+}
+
+TEST_CASE("CountingBloom ages out URLs", "[cache_promote][bloom]")
+{
+  CountingBloom filter;
+  Digest url(1);
+
+  filter.init(BUCKETS);
+  for (unsigned i = 1; i < 10; ++i) {
+    REQUIRE(!filter.hit(url.bytes, 10));
+  }
+  REQUIRE(filter.count(url.bytes) >= 9);
+
+  // Every counter is halved once per BUCKETS hits, even with other URLs filling the filter
+  for (uint64_t n = 2; n < 2 + 2 * BUCKETS; ++n) {
+    filter.hit(Digest(n).bytes, 10);
+  }
+  REQUIRE(filter.count(url.bytes) < 9);
+  REQUIRE(!filter.hit(url.bytes, 10));
+}
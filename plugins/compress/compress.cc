@@ -1,6 +1,6 @@
 /** @file
 
-  Transforms content using gzip, deflate or brotli
+  Transforms content using gzip, deflate, brotli or zstd
 
   @section license License
 
@@ -62,17 +62,29 @@ const int BROTLI_COMPRESSION_LEVEL = 6;
 const int BROTLI_LGW               = 16;
 #endif
 
+// zstd compression level 1-19, level '3' is the library default.
+#if HAVE_ZSTD_H
+const int ZSTD_COMPRESSION_LEVEL = 3;
+#endif
+const char *TS_HTTP_VALUE_ZSTD = "zstd";
+const int TS_HTTP_LEN_ZSTD     = 4;
+
 static const char *global_hidden_header_name = nullptr;
 
 // Current global configuration, and the previous one (for cleanup)
 Configuration *cur_config  = nullptr;
 Configuration *prev_config = nullptr;
 
+static int
+zlib_window_bits(int compression_type)
+{
+  return (compression_type & COMPRESSION_TYPE_DEFLATE) ? WINDOW_BITS_DEFLATE : WINDOW_BITS_GZIP;
+}
+
 static Data *
 data_alloc(int compression_type, int compression_algorithms)
 {
   Data *data;
-  int err;
 
   data                         = (Data *)TSmalloc(sizeof(Data));
   data->downstream_vio         = nullptr;
@@ -82,33 +94,12 @@ data_alloc(int compression_type, int compression_algorithms)
   data->state                  = transform_state_initialized;
   data->compression_type       = compression_type;
   data->compression_algorithms = compression_algorithms;
-  data->zstrm.next_in          = Z_NULL;
-  data->zstrm.avail_in         = 0;
-  data->zstrm.total_in         = 0;
-  data->zstrm.next_out         = Z_NULL;
-  data->zstrm.avail_out        = 0;
-  data->zstrm.total_out        = 0;
-  data->zstrm.zalloc           = gzip_alloc;
-  data->zstrm.zfree            = gzip_free;
-  data->zstrm.opaque           = (voidpf) nullptr;
-  data->zstrm.data_type        = Z_ASCII;
-
-  int window_bits = WINDOW_BITS_GZIP;
-  if (compression_type & COMPRESSION_TYPE_DEFLATE) {
-    window_bits = WINDOW_BITS_DEFLATE;
-  }
+  data->zstrm                  = nullptr;
 
-  err = deflateInit2(&data->zstrm, ZLIB_COMPRESSION_LEVEL, Z_DEFLATED, window_bits, ZLIB_MEMLEVEL, Z_DEFAULT_STRATEGY);
-
-  if (err != Z_OK) {
-    fatal("gzip-transform: ERROR: deflateInit (%d)!", err);
-  }
-
-  if (dictionary) {
-    err = deflateSetDictionary(&data->zstrm, (const Bytef *)dictionary, strlen(dictionary));
-    if (err != Z_OK) {
-      fatal("gzip-transform: ERROR: deflateSetDictionary (%d)!", err);
-    }
+  // The deflate stream is taken from the per thread pool, and only if it is going to be used
+  if ((compression_type & (COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_DEFLATE)) &&
+      (compression_algorithms & (ALGORITHM_GZIP | ALGORITHM_DEFLATE))) {
+    data->zstrm = gzip_stream_acquire(zlib_window_bits(compression_type), ZLIB_COMPRESSION_LEVEL, dictionary);
   }
 #if HAVE_BROTLI_ENCODE_H
   data->bstrm.br = nullptr;
@@ -127,6 +118,14 @@ data_alloc(int compression_type, int compression_algorithms)
     data->bstrm.avail_out = 0;
     data->bstrm.total_out = 0;
   }
+#endif
+#if HAVE_ZSTD_H
+  data->zctx          = nullptr;
+  data->zstd_total_in = 0;
+  if ((compression_type & COMPRESSION_TYPE_ZSTD) && (compression_algorithms & ALGORITHM_ZSTD)) {
+    debug("zstd compression. Get a zstd context.");
+    data->zctx = zstd_context_acquire(ZSTD_COMPRESSION_LEVEL);
+  }
 #endif
   return data;
 }
@@ -136,9 +135,9 @@ data_destroy(Data *data)
 {
   TSReleaseAssert(data);
 
-  // deflateEnd returnvalue ignore is intentional
-  // it would spew log on every client abort
-  deflateEnd(&data->zstrm);
+  if (data->zstrm) {
+    gzip_stream_release(data->zstrm, zlib_window_bits(data->compression_type));
+  }
 
   if (data->downstream_buffer) {
     TSIOBufferDestroy(data->downstream_buffer);
@@ -149,6 +148,12 @@ data_destroy(Data *data)
   BrotliEncoderDestroyInstance(data->bstrm.br);
 #endif
 
+#if HAVE_ZSTD_H
+  if (data->zctx) {
+    zstd_context_release(data->zctx);
+  }
+#endif
+
   TSfree(data);
 }
 
@@ -163,6 +168,9 @@ content_encoding_header(TSMBuffer bufp, TSMLoc hdr_loc, const int compression_ty
   if (compression_type & COMPRESSION_TYPE_BROTLI && (algorithm & ALGORITHM_BROTLI)) {
     value     = TS_HTTP_VALUE_BROTLI;
     value_len = TS_HTTP_LEN_BROTLI;
+  } else if (compression_type & COMPRESSION_TYPE_ZSTD && (algorithm & ALGORITHM_ZSTD)) {
+    value     = TS_HTTP_VALUE_ZSTD;
+    value_len = TS_HTTP_LEN_ZSTD;
   } else if (compression_type & COMPRESSION_TYPE_GZIP && (algorithm & ALGORITHM_GZIP)) {
     value     = TS_HTTP_VALUE_GZIP;
     value_len = TS_HTTP_LEN_GZIP;
@@ -304,34 +312,34 @@ gzip_transform_one(Data *data, const char *upstream_buffer, int64_t upstream_len
   char *downstream_buffer;
   int64_t downstream_length;
   int err;
-  data->zstrm.next_in  = (unsigned char *)upstream_buffer;
-  data->zstrm.avail_in = upstream_length;
+  data->zstrm->next_in  = (unsigned char *)upstream_buffer;
+  data->zstrm->avail_in = upstream_length;
 
-  while (data->zstrm.avail_in > 0) {
+  while (data->zstrm->avail_in > 0) {
     downstream_blkp   = TSIOBufferStart(data->downstream_buffer);
     downstream_buffer = TSIOBufferBlockWriteStart(downstream_blkp, &downstream_length);
 
-    data->zstrm.next_out  = (unsigned char *)downstream_buffer;
-    data->zstrm.avail_out = downstream_length;
+    data->zstrm->next_out  = (unsigned char *)downstream_buffer;
+    data->zstrm->avail_out = downstream_length;
 
     if (!data->hc->flush()) {
-      err = deflate(&data->zstrm, Z_NO_FLUSH);
+      err = deflate(data->zstrm, Z_NO_FLUSH);
     } else {
-      err = deflate(&data->zstrm, Z_SYNC_FLUSH);
+      err = deflate(data->zstrm, Z_SYNC_FLUSH);
     }
 
     if (err != Z_OK) {
       warning("deflate() call failed: %d", err);
     }
 
-    if (downstream_length > data->zstrm.avail_out) {
-      TSIOBufferProduce(data->downstream_buffer, downstream_length - data->zstrm.avail_out);
-      data->downstream_length += (downstream_length - data->zstrm.avail_out);
+    if (downstream_length > data->zstrm->avail_out) {
+      TSIOBufferProduce(data->downstream_buffer, downstream_length - data->zstrm->avail_out);
+      data->downstream_length += (downstream_length - data->zstrm->avail_out);
     }
 
-    if (data->zstrm.avail_out > 0) {
-      if (data->zstrm.avail_in != 0) {
-        error("gzip-transform: avail_in is (%d): should be 0", data->zstrm.avail_in);
+    if (data->zstrm->avail_out > 0) {
+      if (data->zstrm->avail_in != 0) {
+        error("gzip-transform: avail_in is (%d): should be 0", data->zstrm->avail_in);
       }
     }
   }
@@ -401,6 +409,59 @@ brotli_transform_one(Data *data, const char *upstream_buffer, int64_t upstream_l
 }
 #endif
 
+#if HAVE_ZSTD_H
+static bool
+zstd_compress_operation(Data *data, const char *upstream_buffer, int64_t upstream_length, ZSTD_EndDirective mode)
+{
+  TSIOBufferBlock downstream_blkp;
+  char *downstream_buffer;
+  int64_t downstream_length;
+
+  ZSTD_inBuffer input = {upstream_buffer, static_cast<size_t>(upstream_length), 0};
+
+  for (;;) {
+    downstream_blkp   = TSIOBufferStart(data->downstream_buffer);
+    downstream_buffer = TSIOBufferBlockWriteStart(downstream_blkp, &downstream_length);
+
+    ZSTD_outBuffer output = {downstream_buffer, static_cast<size_t>(downstream_length), 0};
+    size_t remaining      = ZSTD_compressStream2(data->zctx, &output, &input, mode);
+
+    if (ZSTD_isError(remaining)) {
+      error("ZSTD_compressStream2(%d) call failed: %s", mode, ZSTD_getErrorName(remaining));
+      return false;
+    }
+
+    if (output.pos > 0) {
+      TSIOBufferProduce(data->downstream_buffer, output.pos);
+      data->downstream_length += output.pos;
+    }
+
+    // With ZSTD_e_continue all the input is consumed, flush and end are done once nothing remains
+    if (mode == ZSTD_e_continue ? input.pos == input.size : remaining == 0) {
+      break;
+    }
+  }
+
+  return true;
+}
+
+static void
+zstd_transform_one(Data *data, const char *upstream_buffer, int64_t upstream_length)
+{
+  if (!zstd_compress_operation(data, upstream_buffer, upstream_length, ZSTD_e_continue)) {
+    return;
+  }
+
+  data->zstd_total_in += upstream_length;
+
+  if (!data->hc->flush()) {
+    return;
+  }
+
+  zstd_compress_operation(data, nullptr, 0, ZSTD_e_flush);
+}
+#endif
+
 static void
 compress_transform_one(Data *data, TSIOBufferReader upstream_reader, int amount)
 {
@@ -428,6 +489,11 @@ compress_transform_one(Data *data, TSIOBufferReader upstream_reader, int amount)
     if (data->compression_type & COMPRESSION_TYPE_BROTLI && (data->compression_algorithms & ALGORITHM_BROTLI)) {
       brotli_transform_one(data, upstream_buffer, upstream_length);
     } else
+#endif
+#if HAVE_ZSTD_H
+      if (data->zctx) {
+      zstd_transform_one(data, upstream_buffer, upstream_length);
+    } else
 #endif
       if ((data->compression_type & (COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_DEFLATE)) &&
           (data->compression_algorithms & (ALGORITHM_GZIP | ALGORITHM_DEFLATE))) {
@@ -456,14 +522,14 @@ gzip_transform_finish(Data *data)
       downstream_blkp = TSIOBufferStart(data->downstream_buffer);
 
       downstream_buffer     = TSIOBufferBlockWriteStart(downstream_blkp, &downstream_length);
-      data->zstrm.next_out  = (unsigned char *)downstream_buffer;
-      data->zstrm.avail_out = downstream_length;
+      data->zstrm->next_out  = (unsigned char *)downstream_buffer;
+      data->zstrm->avail_out = downstream_length;
 
-      err = deflate(&data->zstrm, Z_FINISH);
+      err = deflate(data->zstrm, Z_FINISH);
 
-      if (downstream_length > (int64_t)data->zstrm.avail_out) {
-        TSIOBufferProduce(data->downstream_buffer, downstream_length - data->zstrm.avail_out);
-        data->downstream_length += (downstream_length - data->zstrm.avail_out);
+      if (downstream_length > (int64_t)data->zstrm->avail_out) {
+        TSIOBufferProduce(data->downstream_buffer, downstream_length - data->zstrm->avail_out);
+        data->downstream_length += (downstream_length - data->zstrm->avail_out);
       }
 
       if (err == Z_OK) { /* some more data to encode */
@@ -476,12 +542,12 @@ gzip_transform_finish(Data *data)
       break;
     }
 
-    if (data->downstream_length != (int64_t)(data->zstrm.total_out)) {
-      error("gzip-transform: output lengths don't match (%d, %ld)", data->downstream_length, data->zstrm.total_out);
+    if (data->downstream_length != (int64_t)(data->zstrm->total_out)) {
+      error("gzip-transform: output lengths don't match (%d, %ld)", data->downstream_length, data->zstrm->total_out);
     }
 
     debug("gzip-transform: Finished gzip");
-    log_compression_ratio(data->zstrm.total_in, data->downstream_length);
+    log_compression_ratio(data->zstrm->total_in, data->downstream_length);
   }
 }
 
@@ -510,6 +576,25 @@ brotli_transform_finish(Data *data)
 }
 #endif
 
+#if HAVE_ZSTD_H
+static void
+zstd_transform_finish(Data *data)
+{
+  if (data->state != transform_state_output) {
+    return;
+  }
+
+  data->state = transform_state_finished;
+
+  if (!zstd_compress_operation(data, nullptr, 0, ZSTD_e_end)) {
+    return;
+  }
+
+  debug("zstd-transform: Finished zstd");
+  log_compression_ratio(data->zstd_total_in, data->downstream_length);
+}
+#endif
+
 static void
 compress_transform_finish(Data *data)
 {
@@ -518,6 +603,12 @@ compress_transform_finish(Data *data)
     brotli_transform_finish(data);
     debug("compress_transform_finish: brotli compression finish");
   } else
+#endif
+#if HAVE_ZSTD_H
+    if (data->zctx) {
+    zstd_transform_finish(data);
+    debug("compress_transform_finish: zstd compression finish");
+  } else
 #endif
     if ((data->compression_type & (COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_DEFLATE)) &&
         (data->compression_algorithms & (ALGORITHM_GZIP | ALGORITHM_DEFLATE))) {
@@ -693,6 +784,11 @@ transformable(TSHttpTxn txnp, bool server, HostConfiguration *host_configuration
           compression_acceptable = 1;
         }
         *compress_type |= COMPRESSION_TYPE_BROTLI;
+      } else if (strncasecmp(value, "zstd", sizeof("zstd") - 1) == 0) {
+        if (*algorithms & ALGORITHM_ZSTD) {
+          compression_acceptable = 1;
+        }
+        *compress_type |= COMPRESSION_TYPE_ZSTD;
       } else if (strncasecmp(value, "deflate", sizeof("deflate") - 1) == 0) {
         if (*algorithms & ALGORITHM_DEFLATE) {
           compression_acceptable = 1;
@@ -971,6 +1067,8 @@ load_global_configuration(TSCont contp)
   Configuration *newconfig = Configuration::Parse(path);
   Configuration *oldconfig = __sync_lock_test_and_set(&cur_config, newconfig);
 
+  set_context_pool_size(newconfig->context_pool_size());
+
   debug("config swapped, old config %p", oldconfig);
 
   // First, if there was a previous configuration, clean that one out. This avoids the
@@ -1070,6 +1168,8 @@ TSRemapNewInstance(int argc, char *argv[], void **instance, char *errbuf, int er
   Configuration *config = Configuration::Parse(config_path);
   *instance             = config;
 
+  set_context_pool_size(config->context_pool_size());
+
   free((void *)config_path);
   info("Configuration loaded");
   return TS_SUCCESS;
@@ -104,7 +104,8 @@ enum ParserState {
   kParseCache,
   kParseFlush,
   kParseAllow,
-  kParseMinimumContentLength
+  kParseMinimumContentLength,
+  kParseContextPoolSize
 };
 
 void
@@ -237,13 +238,19 @@ HostConfiguration::add_compression_algorithms(string &line)
       compression_algorithms_ |= ALGORITHM_BROTLI;
 #else
       error("supported-algorithms: brotli support not compiled in.");
+#endif
+    } else if (token == "zstd") {
+#if HAVE_ZSTD_H
+      compression_algorithms_ |= ALGORITHM_ZSTD;
+#else
+      error("supported-algorithms: zstd support not compiled in.");
 #endif
     } else if (token == "gzip") {
       compression_algorithms_ |= ALGORITHM_GZIP;
     } else if (token == "deflate") {
       compression_algorithms_ |= ALGORITHM_DEFLATE;
     } else {
-      error("Unknown compression type. Supported compression-algorithms <br,gzip,deflate>.");
+      error("Unknown compression type. Supported compression-algorithms <br,zstd,gzip,deflate>.");
     }
   }
 }
@@ -363,6 +370,8 @@ Configuration::Parse(const char *path)
           state = kParseStart;
         } else if (token == "minimum-content-length") {
           state = kParseMinimumContentLength;
+        } else if (token == "context-pool-size") {
+          state = kParseContextPoolSize;
         } else {
           warning("failed to interpret \"%s\" at line %zu", token.c_str(), lineno);
         }
@@ -395,6 +404,15 @@ Configuration::Parse(const char *path)
         current_host_configuration->set_minimum_content_length(strtoul(token.c_str(), nullptr, 10));
         state = kParseStart;
         break;
+      case kParseContextPoolSize:
+        // The pools are shared by all the sites, only the global section may size them.
+        if (current_host_configuration->host().empty()) {
+          c->context_pool_size_ = strtoul(token.c_str(), nullptr, 10);
+        } else {
+          warning("context-pool-size is only allowed in the global section, ignored at line %zu", lineno);
+        }
+        state = kParseStart;
+        break;
       }
     }
   }
@@ -34,11 +34,15 @@ namespace Gzip
 {
 typedef std::vector<std::string> StringContainer;
 
+// Idle compression contexts kept per thread and per algorithm, unless set with context-pool-size
+const size_t DEFAULT_CONTEXT_POOL_SIZE = 4;
+
 enum CompressionAlgorithm {
   ALGORITHM_DEFAULT = 0,
   ALGORITHM_DEFLATE = 1,
   ALGORITHM_GZIP    = 2,
-  ALGORITHM_BROTLI  = 4 // For bit manipulations
+  ALGORITHM_BROTLI  = 4, // For bit manipulations
+  ALGORITHM_ZSTD    = 8
 };
 
 class HostConfiguration : private atscppapi::noncopyable
@@ -171,11 +175,18 @@ public:
   HostConfiguration *find(const char *host, int host_length);
   void release_all();
 
+  size_t
+  context_pool_size() const
+  {
+    return context_pool_size_;
+  }
+
 private:
   explicit Configuration() {}
   void add_host_configuration(HostConfiguration *hc);
 
   HostContainer host_configurations_;
+  size_t context_pool_size_ = DEFAULT_CONTEXT_POOL_SIZE;
 
 }; // class Configuration
 
@@ -27,8 +27,56 @@
 #include "misc.h"
 #include <cstring>
 #include <cinttypes>
+#include <atomic>
+#include <vector>
 #include "debug_macros.h"
 
+namespace
+{
+// Idle compression contexts of the current thread. Setting up a deflate or
+// zstd stream allocates and clears several hundred KB, resetting one which
+// has been used before is much cheaper.
+struct ContextPool {
+  std::vector<z_stream *> gzip;
+  std::vector<z_stream *> deflate;
+#if HAVE_ZSTD_H
+  std::vector<ZSTD_CCtx *> zstd;
+#endif
+
+  ~ContextPool()
+  {
+    for (auto zstrm : gzip) {
+      deflateEnd(zstrm);
+      TSfree(zstrm);
+    }
+    for (auto zstrm : deflate) {
+      deflateEnd(zstrm);
+      TSfree(zstrm);
+    }
+#if HAVE_ZSTD_H
+    for (auto zctx : zstd) {
+      ZSTD_freeCCtx(zctx);
+    }
+#endif
+  }
+
+  std::vector<z_stream *> &
+  zlib(int window_bits)
+  {
+    return window_bits == WINDOW_BITS_DEFLATE ? deflate : gzip;
+  }
+};
+
+thread_local ContextPool context_pool;
+std::atomic<size_t> context_pool_size{DEFAULT_CONTEXT_POOL_SIZE};
+} // namespace
+
+void
+set_context_pool_size(size_t size)
+{
+  context_pool_size = size;
+}
+
 voidpf
 gzip_alloc(voidpf /* opaque ATS_UNUSED */, uInt items, uInt size)
 {
@@ -41,37 +89,110 @@ gzip_free(voidpf /* opaque ATS_UNUSED */, voidpf address)
   TSfree(address);
 }
 
+z_stream *
+gzip_stream_acquire(int window_bits, int level, const char *dictionary)
+{
+  std::vector<z_stream *> &pool = context_pool.zlib(window_bits);
+  z_stream *zstrm               = nullptr;
+  int err;
+
+  if (!pool.empty()) {
+    zstrm = pool.back();
+    pool.pop_back();
+    err = deflateReset(zstrm);
+  } else {
+    zstrm            = static_cast<z_stream *>(TSmalloc(sizeof(z_stream)));
+    zstrm->next_in   = Z_NULL;
+    zstrm->avail_in  = 0;
+    zstrm->next_out  = Z_NULL;
+    zstrm->avail_out = 0;
+    zstrm->zalloc    = gzip_alloc;
+    zstrm->zfree     = gzip_free;
+    zstrm->opaque    = (voidpf) nullptr;
+    err              = deflateInit2(zstrm, level, Z_DEFLATED, window_bits, ZLIB_MEMLEVEL, Z_DEFAULT_STRATEGY);
+  }
+
+  if (err != Z_OK) {
+    fatal("gzip-transform: ERROR: deflateInit (%d)!", err);
+  }
+
+  // deflateReset() drops the dictionary, it has to be set for every stream
+  if (dictionary) {
+    err = deflateSetDictionary(zstrm, (const Bytef *)dictionary, strlen(dictionary));
+    if (err != Z_OK) {
+      fatal("gzip-transform: ERROR: deflateSetDictionary (%d)!", err);
+    }
+  }
+
+  zstrm->data_type = Z_ASCII;
+  return zstrm;
+}
+
+void
+gzip_stream_release(z_stream *zstrm, int window_bits)
+{
+  std::vector<z_stream *> &pool = context_pool.zlib(window_bits);
+
+  if (pool.size() < context_pool_size.load(std::memory_order_relaxed)) {
+    pool.push_back(zstrm);
+  } else {
+    // deflateEnd returnvalue ignore is intentional
+    // it would spew log on every client abort
+    deflateEnd(zstrm);
+    TSfree(zstrm);
+  }
+}
+
+#if HAVE_ZSTD_H
+ZSTD_CCtx *
+zstd_context_acquire(int level)
+{
+  ZSTD_CCtx *zctx = nullptr;
+
+  if (!context_pool.zstd.empty()) {
+    zctx = context_pool.zstd.back();
+    context_pool.zstd.pop_back();
+    ZSTD_CCtx_reset(zctx, ZSTD_reset_session_only);
+  } else {
+    zctx = ZSTD_createCCtx();
+    if (!zctx) {
+      fatal("zstd-transform: ERROR: ZSTD_createCCtx failed!");
+    }
+  }
+
+  ZSTD_CCtx_setParameter(zctx, ZSTD_c_compressionLevel, level);
+  return zctx;
+}
+
+void
+zstd_context_release(ZSTD_CCtx *zctx)
+{
+  if (context_pool.zstd.size() < context_pool_size.load(std::memory_order_relaxed)) {
+    context_pool.zstd.push_back(zctx);
+  } else {
+    ZSTD_freeCCtx(zctx);
+  }
+}
+#endif
+
 void
 normalize_accept_encoding(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer reqp, TSMLoc hdr_loc)
 {
   TSMLoc field = TSMimeHdrFieldFind(reqp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
-  int deflate  = 0;
-  int gzip     = 0;
-  int br       = 0;
+  int accepted = 0;
   // remove the accept encoding field(s),
-  // while finding out if gzip or deflate is supported.
+  // while finding out which of the codings are supported.
   while (field) {
     TSMLoc tmp;
 
-    if (!deflate && !gzip) {
-      int value_count = TSMimeHdrFieldValuesCount(reqp, hdr_loc, field);
-
-      while (value_count > 0) {
-        int val_len = 0;
-        const char *val;
-
-        --value_count;
-        val = TSMimeHdrFieldValueStringGet(reqp, hdr_loc, field, value_count, &val_len);
-
-        if (val_len == (int)strlen("br")) {
-          br = !strncmp(val, "br", val_len);
-        }
-        if (val_len == (int)strlen("gzip")) {
-          gzip = !strncmp(val, "gzip", val_len);
-        } else if (val_len == (int)strlen("deflate")) {
-          deflate = !strncmp(val, "deflate", val_len);
-        }
-      }
+    int value_count = TSMimeHdrFieldValuesCount(reqp, hdr_loc, field);
+    while (value_count > 0) {
+      int val_len = 0;
+      const char *val;
+
+      --value_count;
+      val = TSMimeHdrFieldValueStringGet(reqp, hdr_loc, field, value_count, &val_len);
+      accepted |= accept_encoding_type(val, val_len);
     }
 
     tmp = TSMimeHdrFieldNextDup(reqp, hdr_loc, field);
@@ -81,17 +202,21 @@ normalize_accept_encoding(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer reqp, TSMLo
   }
 
   // append a new accept-encoding field in the header
-  if (deflate || gzip || br) {
+  if (accepted) {
     TSMimeHdrFieldCreate(reqp, hdr_loc, &field);
     TSMimeHdrFieldNameSet(reqp, hdr_loc, field, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
-    if (br) {
+    if (accepted & COMPRESSION_TYPE_BROTLI) {
       TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, "br", strlen("br"));
       info("normalized accept encoding to br");
     }
-    if (gzip) {
+    if (accepted & COMPRESSION_TYPE_ZSTD) {
+      TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, "zstd", strlen("zstd"));
+      info("normalized accept encoding to zstd");
+    }
+    if (accepted & COMPRESSION_TYPE_GZIP) {
       TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, "gzip", strlen("gzip"));
       info("normalized accept encoding to gzip");
-    } else if (deflate) {
+    } else if (accepted & COMPRESSION_TYPE_DEFLATE) {
       TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, "deflate", strlen("deflate"));
       info("normalized accept encoding to deflate");
     }
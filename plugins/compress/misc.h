@@ -27,11 +27,18 @@
 #include <ts/ts.h>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+
+#include "tscore/ink_config.h"
 
 #if HAVE_BROTLI_ENCODE_H
 #include <brotli/encode.h>
 #endif
 
+#if HAVE_ZSTD_H
+#include <zstd.h>
+#endif
+
 #include "configuration.h"
 
 using namespace Gzip;
@@ -46,7 +53,8 @@ enum CompressionType {
   COMPRESSION_TYPE_DEFAULT = 0,
   COMPRESSION_TYPE_DEFLATE = 1,
   COMPRESSION_TYPE_GZIP    = 2,
-  COMPRESSION_TYPE_BROTLI  = 4
+  COMPRESSION_TYPE_BROTLI  = 4,
+  COMPRESSION_TYPE_ZSTD    = 8
 };
 
 // this one is used to rename the accept encoding header
@@ -79,17 +87,28 @@ typedef struct {
   TSIOBuffer downstream_buffer;
   TSIOBufferReader downstream_reader;
   int downstream_length;
-  z_stream zstrm;
+  z_stream *zstrm;
   enum transform_state state;
   int compression_type;
   int compression_algorithms;
 #if HAVE_BROTLI_ENCODE_H
   b_stream bstrm;
 #endif
+#if HAVE_ZSTD_H
+  ZSTD_CCtx *zctx;
+  int64_t zstd_total_in;
+#endif
 } Data;
 
 voidpf gzip_alloc(voidpf opaque, uInt items, uInt size);
 void gzip_free(voidpf opaque, voidpf address);
+z_stream *gzip_stream_acquire(int window_bits, int level, const char *dictionary);
+void gzip_stream_release(z_stream *zstrm, int window_bits);
+#if HAVE_ZSTD_H
+ZSTD_CCtx *zstd_context_acquire(int level);
+void zstd_context_release(ZSTD_CCtx *zctx);
+#endif
+void set_context_pool_size(size_t size);
 void normalize_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc);
 void hide_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc, const char *hidden_header_name);
 void restore_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc, const char *hidden_header_name);
@@ -97,3 +116,19 @@ const char *init_hidden_header_name();
 int check_ts_version();
 int register_plugin();
 void log_compression_ratio(int64_t in, int64_t out);
+
+// The CompressionType of a coding listed in Accept-Encoding, 0 for any other coding
+inline int
+accept_encoding_type(const char *val, int val_len)
+{
+  if (val_len == (int)strlen("br") && !strncmp(val, "br", val_len)) {
+    return COMPRESSION_TYPE_BROTLI;
+  } else if (val_len == (int)strlen("zstd") && !strncmp(val, "zstd", val_len)) {
+    return COMPRESSION_TYPE_ZSTD;
+  } else if (val_len == (int)strlen("gzip") && !strncmp(val, "gzip", val_len)) {
+    return COMPRESSION_TYPE_GZIP;
+  } else if (val_len == (int)strlen("deflate") && !strncmp(val, "deflate", val_len)) {
+    return COMPRESSION_TYPE_DEFLATE;
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * @file test_compress.cc
+ * @brief Unit tests for the Accept-Encoding handling of the compress plugin.
+ */
+
+#define CATCH_CONFIG_MAIN /* include main function */
+#include <catch.hpp>      /* catch unit-test framework */
+#include <cstring>
+#include <initializer_list>
+#include "../misc.h"
+
+namespace
+{
+int
+type(char const *val)
+{
+  return accept_encoding_type(val, strlen(val));
+}
+
+// The codings accepted by the values of an Accept-Encoding field, the way normalize_accept_encoding() collects them.
+int
+accepted(std::initializer_list<char const *> vals)
+{
+  int mask = 0;
+  for (char const *val : vals) {
+    mask |= type(val);
+  }
+  return mask;
+}
+} // namespace
+
+TEST_CASE("Accept-Encoding: codings", "[compress][AcceptEncoding]")
+{
+  CHECK(type("br") == COMPRESSION_TYPE_BROTLI);
+  CHECK(type("zstd") == COMPRESSION_TYPE_ZSTD);
+  CHECK(type("gzip") == COMPRESSION_TYPE_GZIP);
+  CHECK(type("deflate") == COMPRESSION_TYPE_DEFLATE);
+
+  CHECK(type("sdch") == 0);
+  CHECK(type("identity") == 0);
+  CHECK(type("b") == 0);
+  CHECK(type("gzi") == 0);
+  CHECK(type("") == 0);
+}
+
+TEST_CASE("Accept-Encoding: codings of the same length are all kept", "[compress][AcceptEncoding]")
+{
+  CHECK(accepted({"gzip", "zstd"}) == (COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_ZSTD));
+  CHECK(accepted({"zstd", "gzip"}) == (COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_ZSTD));
+  CHECK(accepted({"gzip", "sdch"}) == COMPRESSION_TYPE_GZIP);
+  CHECK(accepted({"br", "gzip", "deflate", "zstd"}) ==
+        (COMPRESSION_TYPE_BROTLI | COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_DEFLATE | COMPRESSION_TYPE_ZSTD));
+  CHECK(accepted({"deflate", "sdch", "identity"}) == COMPRESSION_TYPE_DEFLATE);
+}
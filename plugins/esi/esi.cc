@@ -23,12 +23,15 @@
 
 #include "tscore/ink_defs.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <climits>
 #include <cstring>
+#include <ctime>
 #include <string>
 #include <list>
+#include <memory>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <getopt.h>
@@ -48,6 +51,7 @@
 #include "Stats.h"
 #include "HttpDataFetcherImpl.h"
 #include "FailureInfo.h"
+#include "ParsedDocCache.h"
 using std::string;
 using std::list;
 using namespace EsiLib;
@@ -58,9 +62,12 @@ struct OptionInfo {
   bool private_response;
   bool disable_gzip_output;
   bool first_byte_flush;
+  int64_t parsed_doc_cache_size;
+  int max_include_fetches;
 };
 
 static HandlerManager *gHandlerManager = nullptr;
+static ParsedDocCache *gParsedDocCache = nullptr;
 static Utils::HeaderValueList gWhitelistCookies;
 
 #define DEBUG_TAG "plugin_esi"
@@ -113,6 +120,9 @@ struct ContData {
   sockaddr const *client_addr;
   DataType input_type;
   string packed_node_list;
+  string doc_key;                      // identity of the template in the parsed document cache
+  ParsedDocCache::PackedDoc parsed_doc; // the template, parsed earlier
+  time_t doc_expires;                   // when the template response goes stale
   string gzipped_data;
   char debug_tag[32];
   bool gzip_output;
@@ -141,6 +151,7 @@ struct ContData {
       request_url(nullptr),
       input_type(DATA_TYPE_RAW_ESI),
       packed_node_list(""),
+      doc_expires(0),
       gzipped_data(""),
       gzip_output(false),
       initialized(false),
@@ -160,6 +171,10 @@ struct ContData {
 
   void getServerState();
 
+  void getParsedDoc(TSMBuffer bufp, TSMLoc hdr_loc);
+
+  bool appendVaryValues(TSMBuffer bufp, TSMLoc hdr_loc);
+
   void checkXformStatus();
 
   bool init();
@@ -254,6 +269,7 @@ ContData::init()
     string fetcher_tag, vars_tag, expr_tag, proc_tag, gzip_tag, gunzip_tag;
     if (!data_fetcher) {
       data_fetcher = new HttpDataFetcherImpl(contp, client_addr, createDebugTag(FETCHER_DEBUG_TAG, contp, fetcher_tag));
+      data_fetcher->setMaxRunningRequests(option_info->max_include_fetches);
     }
     if (!esi_vars) {
       esi_vars = new Variables(createDebugTag(VARS_DEBUG_TAG, contp, vars_tag), &TSDebug, &TSError, gWhitelistCookies);
@@ -295,6 +311,7 @@ ContData::getClientState()
   if (!data_fetcher) {
     string fetcher_tag;
     data_fetcher = new HttpDataFetcherImpl(contp, client_addr, createDebugTag(FETCHER_DEBUG_TAG, contp, fetcher_tag));
+    data_fetcher->setMaxRunningRequests(option_info->max_include_fetches);
   }
   if (req_bufp && req_hdr_loc) {
     TSMBuffer bufp;
@@ -477,9 +494,185 @@ ContData::getServerState()
     fillPostHeader(bufp, hdr_loc);
   }
 
+  if (option_info->parsed_doc_cache_size && !head_only) {
+    getParsedDoc(bufp, hdr_loc);
+  }
+
   TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
 }
 
+// The whole value of the first header field @a name, empty if there is none
+static string
+getHeaderValue(TSMBuffer bufp, TSMLoc hdr_loc, const char *name, int name_len)
+{
+  string result;
+  TSMLoc field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, name, name_len);
+
+  if (field_loc) {
+    int value_len;
+    const char *value = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, -1, &value_len);
+    if (value) {
+      result.assign(value, value_len);
+    }
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+  return result;
+}
+
+// How many more seconds the response is fresh for: its s-maxage or max-age, else Expires less Date,
+// less its age. Zero if it has no explicit lifetime or must not be reused.
+static time_t
+getFreshness(TSMBuffer bufp, TSMLoc hdr_loc, time_t now)
+{
+  static const char S_MAXAGE[] = "s-maxage=";
+  static const char MAX_AGE[]  = "max-age=";
+  time_t lifetime              = -1;
+  time_t s_maxage              = -1;
+  TSMLoc field_loc             = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_CACHE_CONTROL, TS_MIME_LEN_CACHE_CONTROL);
+
+  while (field_loc) {
+    int n_values = TSMimeHdrFieldValuesCount(bufp, hdr_loc, field_loc);
+    for (int i = 0; i < n_values; ++i) {
+      int value_len;
+      const char *value = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, i, &value_len);
+      if (!value) {
+        continue;
+      }
+      if (Utils::areEqual(value, std::min(value_len, TS_HTTP_LEN_NO_STORE), TS_HTTP_VALUE_NO_STORE, TS_HTTP_LEN_NO_STORE) ||
+          Utils::areEqual(value, std::min(value_len, TS_HTTP_LEN_NO_CACHE), TS_HTTP_VALUE_NO_CACHE, TS_HTTP_LEN_NO_CACHE) ||
+          Utils::areEqual(value, std::min(value_len, TS_HTTP_LEN_PRIVATE), TS_HTTP_VALUE_PRIVATE, TS_HTTP_LEN_PRIVATE)) {
+        TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+        return 0;
+      } else if (value_len > static_cast<int>(sizeof(S_MAXAGE) - 1) && !strncasecmp(value, S_MAXAGE, sizeof(S_MAXAGE) - 1)) {
+        s_maxage = atol(value + sizeof(S_MAXAGE) - 1);
+      } else if (value_len > static_cast<int>(sizeof(MAX_AGE) - 1) && !strncasecmp(value, MAX_AGE, sizeof(MAX_AGE) - 1)) {
+        lifetime = atol(value + sizeof(MAX_AGE) - 1);
+      }
+    }
+    TSMLoc next_loc = TSMimeHdrFieldNextDup(bufp, hdr_loc, field_loc);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    field_loc = next_loc;
+  }
+
+  time_t date = now;
+  if ((field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_DATE, TS_MIME_LEN_DATE))) {
+    time_t value = TSMimeHdrFieldValueDateGet(bufp, hdr_loc, field_loc);
+    date         = value > 0 ? value : now;
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+  if (s_maxage >= 0) {
+    lifetime = s_maxage;
+  } else if (lifetime < 0 && (field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_EXPIRES, TS_MIME_LEN_EXPIRES))) {
+    lifetime = TSMimeHdrFieldValueDateGet(bufp, hdr_loc, field_loc) - date;
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+
+  // The response may have been cached for a while, here or upstream
+  time_t age = std::max<time_t>(now - date, 0);
+  if ((field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_AGE, TS_MIME_LEN_AGE))) {
+    age = std::max<time_t>(age, TSMimeHdrFieldValueUintGet(bufp, hdr_loc, field_loc, 0));
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+  return lifetime > age ? lifetime - age : 0;
+}
+
+// Appends the client request header fields the response varies on to doc_key. False if the response
+// varies on everything.
+bool
+ContData::appendVaryValues(TSMBuffer bufp, TSMLoc hdr_loc)
+{
+  TSMBuffer req_bufp;
+  TSMLoc req_hdr_loc;
+  TSMLoc field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_VARY, TS_MIME_LEN_VARY);
+  bool retval      = true;
+
+  if (!field_loc) {
+    return true;
+  }
+  if (TSHttpTxnClientReqGet(txnp, &req_bufp, &req_hdr_loc) != TS_SUCCESS) {
+    TSError("[esi][%s] Error while retrieving client request", __FUNCTION__);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    return false;
+  }
+  while (field_loc && retval) {
+    int n_values = TSMimeHdrFieldValuesCount(bufp, hdr_loc, field_loc);
+    for (int i = 0; i < n_values; ++i) {
+      int name_len;
+      const char *name = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, i, &name_len);
+      if (!name || !name_len) {
+        continue;
+      }
+      if (Utils::areEqual(name, name_len, "*", 1)) {
+        retval = false;
+        break;
+      }
+      doc_key.append("\n").append(name, name_len).append(": ");
+      for (TSMLoc req_field_loc = TSMimeHdrFieldFind(req_bufp, req_hdr_loc, name, name_len); req_field_loc;) {
+        int value_len;
+        const char *value = TSMimeHdrFieldValueStringGet(req_bufp, req_hdr_loc, req_field_loc, -1, &value_len);
+        if (value) {
+          doc_key.append(value, value_len).append(", ");
+        }
+        TSMLoc next_loc = TSMimeHdrFieldNextDup(req_bufp, req_hdr_loc, req_field_loc);
+        TSHandleMLocRelease(req_bufp, req_hdr_loc, req_field_loc);
+        req_field_loc = next_loc;
+      }
+    }
+    TSMLoc next_loc = TSMimeHdrFieldNextDup(bufp, hdr_loc, field_loc);
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    field_loc = next_loc;
+  }
+  if (field_loc) {
+    TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+  }
+  TSHandleMLocRelease(req_bufp, TS_NULL_MLOC, req_hdr_loc);
+  return retval;
+}
+
+// A template is the same document as long as its URL and strong ETag are the same, so that is the key
+// of its parsed document. Without a strong ETag, Last-Modified and the request headers the response
+// varies on make up the key; Last-Modified alone would give one variant to every client. A parsed
+// document is not used after its template response goes stale, and templates without a validator or
+// an explicit freshness lifetime are not cached.
+void
+ContData::getParsedDoc(TSMBuffer bufp, TSMLoc hdr_loc)
+{
+  if (!request_url) {
+    return;
+  }
+
+  time_t now       = time(nullptr);
+  time_t freshness = getFreshness(bufp, hdr_loc, now);
+  if (freshness <= 0) {
+    TSDebug(DEBUG_TAG, "[%s] Template [%s] is not fresh, not caching its parsed document", __FUNCTION__, request_url);
+    return;
+  }
+
+  string etag = getHeaderValue(bufp, hdr_loc, TS_MIME_FIELD_ETAG, TS_MIME_LEN_ETAG);
+  doc_key.assign(request_url).append("\n");
+  if (!etag.empty() && etag.compare(0, 2, "W/") != 0) {
+    doc_key.append(etag);
+  } else {
+    string last_modified = getHeaderValue(bufp, hdr_loc, TS_MIME_FIELD_LAST_MODIFIED, TS_MIME_LEN_LAST_MODIFIED);
+    doc_key.append("\n").append(last_modified);
+    if (last_modified.empty() || !appendVaryValues(bufp, hdr_loc)) {
+      TSDebug(DEBUG_TAG, "[%s] Template [%s] has no usable validator, not caching its parsed document", __FUNCTION__,
+              request_url);
+      doc_key.clear();
+      return;
+    }
+  }
+
+  doc_expires = now + freshness;
+  parsed_doc  = gParsedDocCache->lookup(doc_key, now);
+  if (parsed_doc) {
+    Stats::increment(Stats::N_PARSED_DOC_HITS);
+  } else {
+    Stats::increment(Stats::N_PARSED_DOC_MISSES);
+  }
+  TSDebug(DEBUG_TAG, "[%s] Parsed document %s for [%s]", __FUNCTION__, parsed_doc ? "found" : "not found", request_url);
+}
+
 ContData::~ContData()
 {
   TSDebug(debug_tag, "[%s] Destroying continuation data", __FUNCTION__);
@@ -676,7 +869,9 @@ transformData(TSCont contp)
         // Now start extraction
         while (block != nullptr) {
           data = TSIOBufferBlockReadStart(block, cont_data->input_reader, &data_len);
-          if (cont_data->input_type == DATA_TYPE_RAW_ESI) {
+          if (cont_data->parsed_doc) {
+            // Already parsed, the template only needs to be consumed
+          } else if (cont_data->input_type == DATA_TYPE_RAW_ESI) {
             cont_data->esi_proc->addParseData(data, data_len);
           } else if (cont_data->input_type == DATA_TYPE_GZIPPED_ESI) {
             string udata = "";
@@ -723,7 +918,14 @@ transformData(TSCont contp)
       }
     }
 
-    if (cont_data->input_type != DATA_TYPE_PACKED_ESI) {
+    if (cont_data->parsed_doc) {
+      TSDebug(cont_data->debug_tag, "[%s] Going to use parsed document of size %d", __FUNCTION__,
+              (int)cont_data->parsed_doc->size());
+      if (cont_data->esi_proc->usePackedNodeList(*cont_data->parsed_doc) == EsiProcessor::UNPACK_FAILURE) {
+        TSError("[esi][%s] Could not use the parsed document for [%s]", __FUNCTION__, cont_data->request_url);
+        gParsedDocCache->remove(cont_data->doc_key);
+      }
+    } else if (cont_data->input_type != DATA_TYPE_PACKED_ESI) {
       bool gunzip_complete = true;
       if (cont_data->input_type == DATA_TYPE_GZIPPED_ESI) {
         gunzip_complete = cont_data->esi_gunzip->stream_finish();
@@ -733,6 +935,11 @@ transformData(TSCont contp)
             !cont_data->head_only) {
           cacheNodeList(cont_data);
         }
+        if (!cont_data->doc_key.empty()) {
+          std::shared_ptr<string> packed(new string());
+          cont_data->esi_proc->packNodeList(*packed, false);
+          gParsedDocCache->insert(cont_data->doc_key, packed, cont_data->doc_expires);
+        }
       }
     }
 
@@ -1598,11 +1805,13 @@ esiPluginInit(int argc, const char *argv[], struct OptionInfo *pOptionInfo)
       {const_cast<char *>("disable-gzip-output"), no_argument, nullptr, 'z'},
       {const_cast<char *>("first-byte-flush"), no_argument, nullptr, 'b'},
       {const_cast<char *>("handler-filename"), required_argument, nullptr, 'f'},
+      {const_cast<char *>("parsed-doc-cache"), required_argument, nullptr, 'c'},
+      {const_cast<char *>("max-include-fetches"), required_argument, nullptr, 'm'},
       {nullptr, 0, nullptr, 0},
     };
 
     int longindex = 0;
-    while ((c = getopt_long(argc, (char *const *)argv, "npzbf:", longopts, &longindex)) != -1) {
+    while ((c = getopt_long(argc, (char *const *)argv, "npzbf:c:m:", longopts, &longindex)) != -1) {
       switch (c) {
       case 'n':
         pOptionInfo->packed_node_support = true;
@@ -1622,6 +1831,12 @@ esiPluginInit(int argc, const char *argv[], struct OptionInfo *pOptionInfo)
         gHandlerManager->loadObjects(handler_conf);
         break;
       }
+      case 'c':
+        pOptionInfo->parsed_doc_cache_size = std::max(0LL, atoll(optarg));
+        break;
+      case 'm':
+        pOptionInfo->max_include_fetches = std::max(0, atoi(optarg));
+        break;
       default:
         break;
       }
@@ -1640,13 +1855,24 @@ esiPluginInit(int argc, const char *argv[], struct OptionInfo *pOptionInfo)
     bKeySet = false;
   }
 
+  // There is one parsed document cache, as large as the largest size asked for.
+  if (pOptionInfo->parsed_doc_cache_size) {
+    if (gParsedDocCache == nullptr) {
+      gParsedDocCache = new ParsedDocCache(pOptionInfo->parsed_doc_cache_size);
+    } else if (pOptionInfo->parsed_doc_cache_size > gParsedDocCache->maxBytes()) {
+      gParsedDocCache->setMaxBytes(pOptionInfo->parsed_doc_cache_size);
+    }
+  }
+
   if (result == 0) {
     TSDebug(DEBUG_TAG,
             "[%s] Plugin started%s, "
             "packed-node-support: %d, private-response: %d, "
-            "disable-gzip-output: %d, first-byte-flush: %d ",
+            "disable-gzip-output: %d, first-byte-flush: %d, "
+            "parsed-doc-cache: %" PRId64 ", max-include-fetches: %d",
             __FUNCTION__, bKeySet ? " and key is set" : "", pOptionInfo->packed_node_support, pOptionInfo->private_response,
-            pOptionInfo->disable_gzip_output, pOptionInfo->first_byte_flush);
+            pOptionInfo->disable_gzip_output, pOptionInfo->first_byte_flush, pOptionInfo->parsed_doc_cache_size,
+            pOptionInfo->max_include_fetches);
   }
 
   return result;
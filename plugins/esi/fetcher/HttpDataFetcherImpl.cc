@@ -47,7 +47,12 @@ HttpDataFetcherImpl::_release(RequestData &req_data)
 }
 
 HttpDataFetcherImpl::HttpDataFetcherImpl(TSCont contp, sockaddr const *client_addr, const char *debug_tag)
-  : _contp(contp), _n_pending_requests(0), _curr_event_id_base(FETCH_EVENT_ID_BASE), _headers_str(""), _client_addr(client_addr)
+  : _contp(contp),
+    _n_pending_requests(0),
+    _n_running_requests(0),
+    _max_running_requests(0),
+    _headers_str(""),
+    _client_addr(client_addr)
 {
   _http_parser = TSHttpParserCreate();
   snprintf(_debug_tag, sizeof(_debug_tag), "%s", debug_tag);
@@ -72,6 +77,23 @@ HttpDataFetcherImpl::addFetchRequest(const string &url, FetchedDataProcessor *ca
     return true;
   }
 
+  int base_event_id = _page_entry_lookup.size();
+  _page_entry_lookup.push_back(insert_result.first);
+  ++_n_pending_requests;
+
+  if (_max_running_requests && (_n_running_requests >= _max_running_requests)) {
+    TSDebug(_debug_tag, "[%s] Fetch request for URL [%s] waits for one of %d running requests", __FUNCTION__, url.data(),
+            _n_running_requests);
+    _waiting_requests.push_back(base_event_id);
+    return true;
+  }
+  return _startRequest(base_event_id);
+}
+
+bool
+HttpDataFetcherImpl::_startRequest(int base_event_id)
+{
+  const string &url = _page_entry_lookup[base_event_id]->first;
   char buff[1024];
   char *http_req;
   int length;
@@ -83,6 +105,8 @@ HttpDataFetcherImpl::addFetchRequest(const string &url, FetchedDataProcessor *ca
     http_req = (char *)malloc(length + 1);
     if (http_req == nullptr) {
       TSError("[HttpDataFetcherImpl][%s] malloc %d bytes fail", __FUNCTION__, length + 1);
+      _page_entry_lookup[base_event_id]->second.complete = true;
+      --_n_pending_requests;
       return false;
     }
   }
@@ -90,10 +114,9 @@ HttpDataFetcherImpl::addFetchRequest(const string &url, FetchedDataProcessor *ca
   sprintf(http_req, "GET %s HTTP/1.0\r\n%s\r\n", url.c_str(), _headers_str.c_str());
 
   TSFetchEvent event_ids;
-  event_ids.success_event_id = _curr_event_id_base;
-  event_ids.failure_event_id = _curr_event_id_base + 1;
-  event_ids.timeout_event_id = _curr_event_id_base + 2;
-  _curr_event_id_base += 3;
+  event_ids.success_event_id = FETCH_EVENT_ID_BASE + base_event_id * 3;
+  event_ids.failure_event_id = event_ids.success_event_id + 1;
+  event_ids.timeout_event_id = event_ids.success_event_id + 2;
 
   TSFetchUrl(http_req, length, _client_addr, _contp, AFTER_BODY, event_ids);
   if (http_req != buff) {
@@ -101,8 +124,7 @@ HttpDataFetcherImpl::addFetchRequest(const string &url, FetchedDataProcessor *ca
   }
 
   TSDebug(_debug_tag, "[%s] Successfully added fetch request for URL [%s]", __FUNCTION__, url.data());
-  _page_entry_lookup.push_back(insert_result.first);
-  ++_n_pending_requests;
+  ++_n_running_requests;
   return true;
 }
 
@@ -138,8 +160,18 @@ HttpDataFetcherImpl::handleFetchEvent(TSEvent event, void *edata)
   }
 
   --_n_pending_requests;
+  --_n_running_requests;
   req_data.complete = true;
 
+  // Start the next waiting request before the callbacks, which may add more.
+  while (!_waiting_requests.empty()) {
+    int next_event_id = _waiting_requests.front();
+    _waiting_requests.pop_front();
+    if (_startRequest(next_event_id)) {
+      break;
+    }
+  }
+
   int event_id = (static_cast<int>(event) - FETCH_EVENT_ID_BASE) % 3;
   if (event_id != 0) { // failure or timeout
     TSError("[HttpDataFetcherImpl][%s] Received failure/timeout event id %d for request [%s]", __FUNCTION__, event_id,
@@ -283,10 +315,11 @@ HttpDataFetcherImpl::clear()
     _release(iter->second);
   }
   _n_pending_requests = 0;
+  _n_running_requests = 0;
+  _waiting_requests.clear();
   _pages.clear();
   _page_entry_lookup.clear();
   _headers_str.clear();
-  _curr_event_id_base = FETCH_EVENT_ID_BASE;
 }
 
 DataStatus
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <string>
+#include <deque>
 #include <list>
 #include <vector>
 
@@ -43,6 +44,14 @@ public:
 
   bool addFetchRequest(const std::string &url, FetchedDataProcessor *callback_obj = nullptr) override;
 
+  /** Limits the requests in flight at once to @a n, 0 for no limit. The others wait for a running
+      request to complete, in the order they were added. */
+  void
+  setMaxRunningRequests(int n)
+  {
+    _max_running_requests = n;
+  }
+
   bool handleFetchEvent(TSEvent event, void *edata);
 
   bool
@@ -129,8 +138,10 @@ private:
   typedef std::vector<UrlToContentMap::iterator> IteratorArray;
   IteratorArray _page_entry_lookup; // used to map event ids to requests
 
-  int _n_pending_requests;
-  int _curr_event_id_base;
+  int _n_pending_requests; // running or waiting
+  int _n_running_requests;
+  int _max_running_requests;
+  std::deque<int> _waiting_requests; // base event ids
   TSHttpParser _http_parser;
 
   static const int FETCH_EVENT_ID_BASE;
@@ -149,6 +160,8 @@ private:
 
   inline void _release(RequestData &req_data);
 
+  bool _startRequest(int base_event_id);
+
   sockaddr const *_client_addr;
 };
 
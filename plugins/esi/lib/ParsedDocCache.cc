@@ -0,0 +1,86 @@
+/** @file
+
+  A brief file description
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "ParsedDocCache.h"
+
+#include <iterator>
+
+using std::string;
+using namespace EsiLib;
+
+ParsedDocCache::PackedDoc
+ParsedDocCache::lookup(const string &key, time_t now)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto found = _index.find(key);
+
+  if (found == _index.end()) {
+    return PackedDoc();
+  }
+  if (found->second->expires <= now) {
+    _remove(found->second);
+    return PackedDoc();
+  }
+  _lru.splice(_lru.begin(), _lru, found->second);
+  return found->second->doc;
+}
+
+void
+ParsedDocCache::insert(const string &key, const PackedDoc &doc, time_t expires)
+{
+  if (static_cast<int64_t>(doc->size()) > _max_bytes) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto found = _index.find(key);
+
+  if (found != _index.end()) {
+    _remove(found->second);
+  }
+  _lru.push_front(Entry{key, doc, expires});
+  _index[key] = _lru.begin();
+  _bytes += doc->size();
+  while (_bytes > _max_bytes) {
+    _remove(std::prev(_lru.end()));
+  }
+}
+
+void
+ParsedDocCache::remove(const string &key)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto found = _index.find(key);
+
+  if (found != _index.end()) {
+    _remove(found->second);
+  }
+}
+
+void
+ParsedDocCache::_remove(LruList::iterator iter)
+{
+  _bytes -= iter->doc->size();
+  _index.erase(iter->key);
+  _lru.erase(iter);
+}
@@ -0,0 +1,98 @@
+/** @file
+
+  Cache of parsed ESI documents, as packed node lists.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace EsiLib
+{
+/** Parsed documents, packed with DocNodeList::pack(), by the identity of the template they came from.
+
+    A packed node list only refers to its own buffer, so a document found here can be used with
+    EsiProcessor::usePackedNodeList() while it is evicted. A document is found only until it expires,
+    like the response of its template, and the least recently used documents go first once the
+    packed documents exceed the size limit. Safe to use from any thread.
+ */
+class ParsedDocCache
+{
+public:
+  typedef std::shared_ptr<const std::string> PackedDoc;
+
+  explicit ParsedDocCache(int64_t max_bytes) : _max_bytes(max_bytes), _bytes(0) {}
+
+  /** @return the document cached for @a key that is not expired at @a now, or an empty pointer */
+  PackedDoc lookup(const std::string &key, time_t now);
+
+  /** Caches @a doc for @a key until @a expires, replacing any document cached for it */
+  void insert(const std::string &key, const PackedDoc &doc, time_t expires);
+
+  void remove(const std::string &key);
+
+  int64_t
+  bytes() const
+  {
+    return _bytes;
+  }
+
+  size_t
+  size() const
+  {
+    return _index.size();
+  }
+
+  int64_t
+  maxBytes() const
+  {
+    return _max_bytes;
+  }
+
+  void
+  setMaxBytes(int64_t max_bytes)
+  {
+    _max_bytes = max_bytes;
+  }
+
+private:
+  struct Entry {
+    std::string key;
+    PackedDoc doc;
+    time_t expires;
+  };
+  typedef std::list<Entry> LruList;
+
+  void _remove(LruList::iterator iter);
+
+  int64_t _max_bytes;
+  int64_t _bytes;
+  LruList _lru; // most recently used first
+  std::unordered_map<std::string, LruList::iterator> _index;
+  std::mutex _mutex;
+};
+}; // namespace EsiLib
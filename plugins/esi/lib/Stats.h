@@ -47,7 +47,9 @@ namespace Stats
     N_INCLUDE_ERRS      = 4,
     N_SPCL_INCLUDES     = 5,
     N_SPCL_INCLUDE_ERRS = 6,
-    MAX_STAT_ENUM       = 7
+    N_PARSED_DOC_HITS   = 7,
+    N_PARSED_DOC_MISSES = 8,
+    MAX_STAT_ENUM       = 9
   };
 
   extern const char *STAT_NAMES[MAX_STAT_ENUM];
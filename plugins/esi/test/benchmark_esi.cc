@@ -0,0 +1,194 @@
+/** @file
+
+  Micro benchmark of ESI template parsing and of the parsed document cache.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "EsiProcessor.h"
+#include "TestHttpDataFetcher.h"
+#include "print_funcs.h"
+#include "Utils.h"
+
+/*
+  Times the ESI work for each template, sample ones or the files named on the command line:
+
+    - parse: parsing and processing the raw template, as for every request without the cache
+    - hit: processing the template from its packed node list, as for a parsed document cache hit
+    - pack: packing the parsed template for the cache, once per miss
+
+    benchmark_esi [-n iterations] [template file ...]
+ */
+
+using std::cout;
+using std::endl;
+using std::string;
+using namespace EsiLib;
+
+pthread_key_t threadKey;
+
+namespace
+{
+int iterations = 10000;
+
+void
+quiet(const char * /* tag ATS_UNUSED */, const char * /* fmt ATS_UNUSED */, ...)
+{
+}
+
+string
+html(int n_lines)
+{
+  string s;
+  for (int i = 0; i < n_lines; ++i) {
+    s += "<div class=\"row\"><span>Lorem ipsum dolor sit amet, consectetur adipiscing elit</span></div>\n";
+  }
+  return s;
+}
+
+// A page of markup around @a n_includes fragments, with the other ESI constructs seen in real templates.
+string
+sample_page(int n_lines, int n_includes)
+{
+  string s = "<html><head><title>Sample</title></head><body>\n";
+  s += "<esi:vars>Hello $(HTTP_COOKIE{name}), you are on $(HTTP_HOST)</esi:vars>\n";
+  s += "<esi:comment text=\"header\"/>\n";
+  for (int i = 0; i < n_includes; ++i) {
+    s += html(n_lines / n_includes);
+    if (i % 4 == 3) {
+      s += "<esi:try><esi:attempt><esi:include src=\"http://frag.example.com/try/" + std::to_string(i) +
+           "\"/></esi:attempt><esi:except>unavailable</esi:except></esi:try>\n";
+    } else {
+      s += "<esi:include src=\"http://frag.example.com/part/" + std::to_string(i) + "\"/>\n";
+    }
+  }
+  s += "<esi:choose><esi:when test=\"$(HTTP_COOKIE{type})=='a'\">A</esi:when><esi:otherwise>B</esi:otherwise></esi:choose>\n";
+  s += "<esi:remove><a href=\"http://www.example.com\">fallback</a></esi:remove>\n";
+  s += "<!--esi <p>only with ESI</p> -->\n";
+  s += "</body></html>\n";
+  return s;
+}
+
+double
+per_iteration(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+// As in the plugin, a processor is used for one request only.
+void
+run(const string &name, const string &doc, Variables &esi_vars, HandlerManager &handler_mgr)
+{
+  TestHttpDataFetcher fetcher;
+  const char *out;
+  int out_len;
+  string parsed_out, packed;
+
+  {
+    EsiProcessor esi_proc("processor", "parser", "expression", &quiet, &Error, fetcher, esi_vars, handler_mgr);
+    esi_proc.addParseData(doc);
+    if (!esi_proc.completeParse() || esi_proc.process(out, out_len) != EsiProcessor::SUCCESS) {
+      cout << name << ": could not process the template" << endl;
+      return;
+    }
+    parsed_out.assign(out, out_len);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    EsiProcessor esi_proc("processor", "parser", "expression", &quiet, &Error, fetcher, esi_vars, handler_mgr);
+    esi_proc.addParseData(doc);
+    esi_proc.completeParse();
+    esi_proc.process(out, out_len);
+  }
+  double parse_time = per_iteration(start);
+
+  double pack_time;
+  {
+    EsiProcessor esi_proc("processor", "parser", "expression", &quiet, &Error, fetcher, esi_vars, handler_mgr);
+    esi_proc.addParseData(doc);
+    esi_proc.completeParse();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      esi_proc.packNodeList(packed, false);
+    }
+    pack_time = per_iteration(start);
+  }
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    EsiProcessor esi_proc("processor", "parser", "expression", &quiet, &Error, fetcher, esi_vars, handler_mgr);
+    esi_proc.usePackedNodeList(packed);
+    esi_proc.process(out, out_len);
+  }
+  double hit_time = per_iteration(start);
+
+  EsiProcessor esi_proc("processor", "parser", "expression", &quiet, &Error, fetcher, esi_vars, handler_mgr);
+  esi_proc.usePackedNodeList(packed);
+  esi_proc.process(out, out_len);
+  bool same = (parsed_out == string(out, out_len));
+
+  printf("%-24s %8zu %8zu %9.2f %9.2f %9.2f %s\n", name.c_str(), doc.size(), packed.size(), parse_time, hit_time, pack_time,
+         same ? "" : "OUTPUT DIFFERS");
+}
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  Utils::HeaderValueList whitelistCookies;
+  Variables esi_vars("vars", &quiet, &Error, whitelistCookies);
+  HandlerManager handler_mgr("handler_mgr", &quiet, &Error);
+  std::vector<std::pair<string, string>> docs;
+
+  pthread_key_create(&threadKey, nullptr);
+  Utils::init(&quiet, &Error);
+
+  int arg = 1;
+  if (argc > 2 && string(argv[1]) == "-n") {
+    iterations = atoi(argv[2]);
+    arg        = 3;
+  }
+  for (; arg < argc; ++arg) {
+    std::ifstream file(argv[arg]);
+    std::stringstream content;
+    content << file.rdbuf();
+    docs.emplace_back(argv[arg], content.str());
+  }
+  if (docs.empty()) {
+    docs.emplace_back("small (4 includes)", sample_page(20, 4));
+    docs.emplace_back("medium (20 includes)", sample_page(200, 20));
+    docs.emplace_back("large (100 includes)", sample_page(2000, 100));
+  }
+
+  printf("%d iterations, times in us\n", iterations);
+  printf("%-24s %8s %8s %9s %9s %9s\n", "template", "bytes", "packed", "parse", "hit", "pack");
+  for (auto const &doc : docs) {
+    run(doc.first, doc.second, esi_vars, handler_mgr);
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+/** @file
+
+  A brief file description
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <string>
+
+#include "EsiProcessor.h"
+#include "ParsedDocCache.h"
+#include "TestHttpDataFetcher.h"
+#include "print_funcs.h"
+#include "Utils.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using namespace EsiLib;
+
+pthread_key_t threadKey;
+
+static const time_t now = 1000000000;
+
+static ParsedDocCache::PackedDoc
+doc(const string &data)
+{
+  return ParsedDocCache::PackedDoc(new string(data));
+}
+
+int
+main()
+{
+  pthread_key_create(&threadKey, nullptr);
+  Utils::init(&Debug, &Error);
+
+  {
+    cout << endl << "===================== Test 1) lookup and LRU eviction" << endl;
+    ParsedDocCache cache(10);
+
+    assert(!cache.lookup("a", now));
+    cache.insert("a", doc("1234"), now + 60);
+    cache.insert("b", doc("5678"), now + 60);
+    assert(cache.size() == 2);
+    assert(cache.bytes() == 8);
+    assert(*cache.lookup("a", now) == "1234");
+
+    // b is the least recently used now
+    cache.insert("c", doc("90"), now + 60);
+    assert(cache.bytes() == 10);
+    cache.insert("d", doc("x"), now + 60);
+    assert(!cache.lookup("b", now));
+    assert(cache.lookup("a", now));
+    assert(cache.lookup("c", now));
+    assert(cache.lookup("d", now));
+    assert(cache.bytes() == 7);
+
+    cache.insert("a", doc("12"), now + 60);
+    assert(*cache.lookup("a", now) == "12");
+    assert(cache.bytes() == 5);
+    cache.remove("a");
+    assert(!cache.lookup("a", now));
+    assert(cache.bytes() == 3);
+
+    // Too large to cache at all
+    cache.insert("e", doc("12345678901"), now + 60);
+    assert(!cache.lookup("e", now));
+    assert(cache.size() == 2);
+
+    // Evicted documents stay valid for their users
+    ParsedDocCache::PackedDoc held = cache.lookup("c", now);
+    cache.insert("f", doc("1234567890"), now + 60);
+    assert(!cache.lookup("c", now));
+    assert(*held == "90");
+
+    // Expired documents are not found, and are dropped
+    cache.insert("g", doc("12"), now + 1);
+    assert(cache.lookup("g", now));
+    assert(!cache.lookup("g", now + 1));
+    assert(cache.size() == 0);
+    assert(cache.bytes() == 0);
+  }
+
+  {
+    cout << endl << "===================== Test 2) cached document gives the same output" << endl;
+    Utils::HeaderValueList whitelistCookies;
+    Variables esi_vars("vars", &Debug, &Error, whitelistCookies);
+    HandlerManager handler_mgr("handler_mgr", &Debug, &Error);
+    TestHttpDataFetcher data_fetcher;
+    string input_data("foo <esi:include src=\"http://example.com/frag\"/> bar <esi:comment text=\"x\"/> baz");
+    ParsedDocCache cache(1024);
+    const char *output_data;
+    int output_data_len = 0;
+    string parsed_output;
+
+    {
+      EsiProcessor esi_proc("processor", "parser", "expression", &Debug, &Error, data_fetcher, esi_vars, handler_mgr);
+      assert(esi_proc.addParseData(input_data) == true);
+      assert(esi_proc.completeParse() == true);
+      std::shared_ptr<string> packed(new string());
+      esi_proc.packNodeList(*packed, false);
+      cache.insert("http://example.com/\nETag\n", packed, now + 60);
+      assert(esi_proc.process(output_data, output_data_len) == EsiProcessor::SUCCESS);
+      parsed_output.assign(output_data, output_data_len);
+    }
+
+    EsiProcessor esi_proc("processor", "parser", "expression", &Debug, &Error, data_fetcher, esi_vars, handler_mgr);
+    ParsedDocCache::PackedDoc cached = cache.lookup("http://example.com/\nETag\n", now);
+    assert(cached);
+    assert(esi_proc.usePackedNodeList(*cached) == EsiProcessor::PROCESS_SUCCESS);
+    assert(esi_proc.process(output_data, output_data_len) == EsiProcessor::SUCCESS);
+    assert(string(output_data, output_data_len) == parsed_output);
+    assert(parsed_output == "foo >>>>> Content for URL [http://example.com/frag] <<<<< bar  baz");
+  }
+
+  cout << endl << "All tests passed!" << endl;
+  return 0;
+}
@@ -0,0 +1,171 @@
+/** @file
+
+  Byte ranges for the slice plugin.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "Range.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+void
+skip_space(char const *&p, char const *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    ++p;
+  }
+}
+
+// Parse a non-negative decimal number, @return false if there are no digits or it overflows.
+bool
+parse_number(char const *&p, char const *end, int64_t &value)
+{
+  char const *start = p;
+  value             = 0;
+  while (p < end && '0' <= *p && *p <= '9') {
+    if (value > (Range::maxval - (*p - '0')) / 10) {
+      return false;
+    }
+    value = value * 10 + (*p - '0');
+    ++p;
+  }
+  return p > start;
+}
+
+bool
+match_prefix(char const *&p, char const *end, char const *prefix)
+{
+  size_t n = strlen(prefix);
+  if (static_cast<size_t>(end - p) < n || strncasecmp(p, prefix, n) != 0) {
+    return false;
+  }
+  p += n;
+  return true;
+}
+} // namespace
+
+bool
+Range::fromRangeHeader(char const *str, int len)
+{
+  char const *p     = str;
+  char const *limit = str + len;
+  int64_t first = 0, last = 0;
+
+  skip_space(p, limit);
+  if (!match_prefix(p, limit, "bytes")) {
+    return false;
+  }
+  skip_space(p, limit);
+  if (p >= limit || *p++ != '=') {
+    return false;
+  }
+  skip_space(p, limit);
+
+  if (p < limit && *p == '-') {
+    ++p;
+    if (!parse_number(p, limit, last) || last == 0) {
+      return false;
+    }
+    begin = -last;
+    end   = maxval;
+  } else {
+    if (!parse_number(p, limit, first)) {
+      return false;
+    }
+    skip_space(p, limit);
+    if (p >= limit || *p++ != '-') {
+      return false;
+    }
+    skip_space(p, limit);
+    if (p < limit && '0' <= *p && *p <= '9') {
+      if (!parse_number(p, limit, last) || last < first || last == maxval) {
+        return false;
+      }
+      end = last + 1;
+    } else {
+      end = maxval;
+    }
+    begin = first;
+  }
+
+  // Anything but trailing space, such as a second range, is not handled.
+  skip_space(p, limit);
+  return p == limit;
+}
+
+bool
+Range::resolve(int64_t length)
+{
+  if (isSuffix()) {
+    begin = length + begin < 0 ? 0 : length + begin;
+    end   = length;
+  } else if (end > length) {
+    end = length;
+  }
+  return begin < end;
+}
+
+int
+Range::toRangeHeader(char *buf, int len) const
+{
+  return snprintf(buf, len, "bytes=%" PRId64 "-%" PRId64, begin, end - 1);
+}
+
+int
+Range::toContentRange(char *buf, int len, int64_t length) const
+{
+  return snprintf(buf, len, "bytes %" PRId64 "-%" PRId64 "/%" PRId64, begin, end - 1, length);
+}
+
+bool
+Range::fromContentRange(char const *str, int len, int64_t &length)
+{
+  char const *p     = str;
+  char const *limit = str + len;
+  int64_t first = 0, last = 0;
+
+  skip_space(p, limit);
+  if (!match_prefix(p, limit, "bytes")) {
+    return false;
+  }
+  skip_space(p, limit);
+  if (!parse_number(p, limit, first) || p >= limit || *p++ != '-' || !parse_number(p, limit, last) || last < first ||
+      last == maxval || p >= limit || *p++ != '/') {
+    return false;
+  }
+  if (p < limit && *p == '*') {
+    ++p;
+    length = -1;
+  } else if (!parse_number(p, limit, length) || length <= last) {
+    return false;
+  }
+  skip_space(p, limit);
+  if (p != limit) {
+    return false;
+  }
+
+  begin = first;
+  end   = last + 1;
+  return true;
+}
@@ -0,0 +1,97 @@
+/** @file
+
+  Byte ranges for the slice plugin.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/** A byte range of an object, from @a begin inclusive to @a end exclusive.
+
+    The open ended form "bytes=N-" has @a end of @c maxval, and the suffix form "bytes=-N" a
+    negative @a begin of -N, until resolved against the length of the object.
+ */
+struct Range {
+  static int64_t constexpr maxval = INT64_MAX;
+
+  int64_t begin = 0;
+  int64_t end   = maxval;
+
+  Range() = default;
+  Range(int64_t b, int64_t e) : begin(b), end(e) {}
+
+  /// The range of block @a block of @a blockbytes bytes.
+  static Range
+  forBlock(int64_t block, int64_t blockbytes)
+  {
+    return {block * blockbytes, (block + 1) * blockbytes};
+  }
+
+  bool
+  isSuffix() const
+  {
+    return begin < 0;
+  }
+
+  int64_t
+  size() const
+  {
+    return end - begin;
+  }
+
+  /** Parse the value of a Range request header.
+      Only a single range of bytes is accepted.
+      @return @c false for multiple ranges or bad syntax.
+   */
+  bool fromRangeHeader(char const *str, int len);
+
+  /** Resolve the open ended and suffix forms and clamp the range to an object of @a length bytes.
+      @return @c false if the range is not satisfiable.
+   */
+  bool resolve(int64_t length);
+
+  /// Index of the block holding the first byte. A suffix range starts in the first block until resolved.
+  int64_t
+  firstBlock(int64_t blockbytes) const
+  {
+    return isSuffix() ? 0 : begin / blockbytes;
+  }
+
+  /// Index of the block holding the last byte.
+  int64_t
+  lastBlock(int64_t blockbytes) const
+  {
+    return (end - 1) / blockbytes;
+  }
+
+  /// Print as a Range request header value, "bytes=begin-(end-1)". @return the length printed.
+  int toRangeHeader(char *buf, int len) const;
+
+  /// Print as a Content-Range header value of an object of @a length bytes. @return the length printed.
+  int toContentRange(char *buf, int len, int64_t length) const;
+
+  /** Parse the value of a Content-Range response header, "bytes begin-last/length".
+      @a length is set to -1 if the length is "*".
+      @return @c false on bad syntax.
+   */
+  bool fromContentRange(char const *str, int len, int64_t &length);
+};
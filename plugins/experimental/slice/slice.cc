@@ -0,0 +1,678 @@
+/** @file
+
+  Serve GET requests for large objects from fixed size blocks of the object.
+
+  The plugin intercepts a client request and fetches the blocks the request needs, one at a time,
+  as internal requests for the same URL with a Range header for one block. With the
+  cache_range_requests plugin later in the remap rule each block is cached as an object of its own,
+  so overlapping client ranges share the cached blocks and no block is fetched from the origin
+  twice. The blocks are trimmed to the client range and sent as one 206 (or 200) response.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <netinet/in.h>
+
+#include "ts/ts.h"
+#include "ts/remap.h"
+#include "Range.h"
+
+#define PLUGIN_NAME "slice"
+#define DEBUG_LOG(fmt, ...) TSDebug(PLUGIN_NAME, "[%s:%d] %s(): " fmt, __FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#define ERROR_LOG(fmt, ...) TSError("[%s:%d] %s(): " fmt, __FILE__, __LINE__, __func__, ##__VA_ARGS__)
+
+namespace
+{
+int64_t const DEFAULT_BLOCK    = 1024 * 1024;
+int64_t const MIN_BLOCK        = 64 * 1024;
+int64_t const MAX_BLOCK        = 128 * 1024 * 1024;
+char const *const CONSISTENT[] = {TS_MIME_FIELD_ETAG, TS_MIME_FIELD_LAST_MODIFIED};
+
+struct Config {
+  int64_t blockbytes = DEFAULT_BLOCK;
+};
+
+/// One direction of I/O on a VConn.
+struct Channel {
+  TSVIO vio               = nullptr;
+  TSIOBuffer buffer       = nullptr;
+  TSIOBufferReader reader = nullptr;
+
+  void
+  init()
+  {
+    buffer = TSIOBufferCreate();
+    reader = TSIOBufferReaderAlloc(buffer);
+  }
+
+  void
+  clear()
+  {
+    if (reader) {
+      TSIOBufferReaderFree(reader);
+    }
+    if (buffer) {
+      TSIOBufferDestroy(buffer);
+    }
+    vio    = nullptr;
+    buffer = nullptr;
+    reader = nullptr;
+  }
+};
+
+/// An HTTP header with a parser to fill it.
+struct Header {
+  TSMBuffer buffer    = nullptr;
+  TSMLoc hdr          = TS_NULL_MLOC;
+  TSHttpParser parser = nullptr;
+
+  void
+  init()
+  {
+    buffer = TSMBufferCreate();
+    hdr    = TSHttpHdrCreate(buffer);
+    parser = TSHttpParserCreate();
+  }
+
+  void
+  clear()
+  {
+    if (buffer) {
+      TSHttpParserDestroy(parser);
+      TSHttpHdrDestroy(buffer, hdr);
+      TSHandleMLocRelease(buffer, TS_NULL_MLOC, hdr);
+      TSMBufferDestroy(buffer);
+    }
+    buffer = nullptr;
+    hdr    = TS_NULL_MLOC;
+    parser = nullptr;
+  }
+
+  std::string
+  value(char const *name) const
+  {
+    std::string s;
+    TSMLoc field = TSMimeHdrFieldFind(buffer, hdr, name, -1);
+    if (field) {
+      int len         = 0;
+      char const *str = TSMimeHdrFieldValueStringGet(buffer, hdr, field, -1, &len);
+      if (str) {
+        s.assign(str, len);
+      }
+      TSHandleMLocRelease(buffer, hdr, field);
+    }
+    return s;
+  }
+
+  void
+  set(char const *name, char const *val, int len)
+  {
+    TSMLoc field = TSMimeHdrFieldFind(buffer, hdr, name, -1);
+    if (!field) {
+      TSMimeHdrFieldCreateNamed(buffer, hdr, name, strlen(name), &field);
+      TSMimeHdrFieldAppend(buffer, hdr, field);
+    }
+    TSMimeHdrFieldValuesClear(buffer, hdr, field);
+    TSMimeHdrFieldValueStringSet(buffer, hdr, field, -1, val, len);
+    TSHandleMLocRelease(buffer, hdr, field);
+  }
+
+  void
+  remove(char const *name)
+  {
+    TSMLoc field = TSMimeHdrFieldFind(buffer, hdr, name, -1);
+    while (field) {
+      TSMLoc next = TSMimeHdrFieldNextDup(buffer, hdr, field);
+      TSMimeHdrFieldDestroy(buffer, hdr, field);
+      TSHandleMLocRelease(buffer, hdr, field);
+      field = next;
+    }
+  }
+};
+
+/** State of one sliced client request.
+
+    The client side is the intercept VConn: its request is read and dropped, as everything needed
+    was taken from the transaction at remap time, and the response is written to it. The upstream
+    side is the internal request for the current block.
+ */
+struct Slicer {
+  TSCont cont = nullptr;
+  int64_t blockbytes;
+  sockaddr_storage client_addr;
+
+  Header request;    ///< Template of the block requests.
+  Range range;       ///< Client range, the whole object if it did not ask for one.
+  bool has_range;    ///< The client sent a Range header.
+  int64_t length;    ///< Object length, -1 until the first block arrives.
+  int64_t last_block = -1; ///< Last block of the client range, -1 until the first block arrives.
+  std::string consistent[sizeof(CONSISTENT) / sizeof(*CONSISTENT)]; ///< Validators of the first block.
+
+  TSVConn client_vc = nullptr;
+  Channel client_in, client_out;
+  Header client_request;
+  bool client_request_done = false;
+  int64_t client_bytes     = 0; ///< Bytes written to the client output.
+
+  TSVConn upstream_vc = nullptr;
+  Channel upstream_in, upstream_out;
+  Header response;
+  bool response_done = false;
+  bool upstream_done = false; ///< The upstream sent all of the block, what is left of it is buffered.
+  bool relay         = false; ///< Pass the response through, the origin did not answer with a block.
+  bool next_pending  = false; ///< The next block waits for the client to take the data buffered.
+  int64_t block      = 0;     ///< Current block.
+  int64_t body_todo  = 0;     ///< Body bytes of the current block still to read.
+  int64_t skip       = 0;     ///< Leading bytes of the current block body outside the client range.
+  int64_t keep       = 0;     ///< Bytes of the current block body to send after the skipped ones.
+
+  Slicer(int64_t blockbytes_, sockaddr const *addr) : blockbytes(blockbytes_), has_range(false), length(-1)
+  {
+    memset(&client_addr, 0, sizeof(client_addr));
+    if (addr) {
+      memcpy(&client_addr, addr, addr->sa_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in));
+    }
+    request.init();
+  }
+
+  ~Slicer()
+  {
+    close_upstream();
+    if (client_vc) {
+      TSVConnClose(client_vc);
+    }
+    client_in.clear();
+    client_out.clear();
+    client_request.clear();
+    request.clear();
+  }
+
+  void
+  close_upstream()
+  {
+    if (upstream_vc) {
+      TSVConnClose(upstream_vc);
+      upstream_vc = nullptr;
+    }
+    upstream_in.clear();
+    upstream_out.clear();
+    response.clear();
+  }
+
+  /// The client output holds enough not yet sent to stop pulling more from upstream.
+  bool
+  client_backlogged() const
+  {
+    return TSIOBufferReaderAvail(client_out.reader) >= blockbytes;
+  }
+
+  bool start_block();
+  bool read_request();
+  bool read_upstream();
+  bool handle_response_header();
+  void start_client_write(int64_t nbytes);
+  void send_unsatisfiable();
+  void finish_relay();
+};
+
+bool
+Slicer::start_block()
+{
+  char value[64];
+  Range block_range = Range::forBlock(block, blockbytes);
+
+  next_pending = false;
+  close_upstream();
+  request.set(TS_MIME_FIELD_RANGE, value, block_range.toRangeHeader(value, sizeof(value)));
+
+  upstream_vc = TSHttpConnectWithPluginId(reinterpret_cast<sockaddr *>(&client_addr), PLUGIN_NAME, block);
+  if (!upstream_vc) {
+    ERROR_LOG("Could not connect for block %" PRId64, block);
+    return false;
+  }
+  upstream_in.init();
+  upstream_out.init();
+  response.init();
+  response_done = false;
+  upstream_done = false;
+
+  TSHttpHdrPrint(request.buffer, request.hdr, upstream_out.buffer);
+  upstream_in.vio  = TSVConnRead(upstream_vc, cont, upstream_in.buffer, INT64_MAX);
+  upstream_out.vio = TSVConnWrite(upstream_vc, cont, upstream_out.reader, TSIOBufferReaderAvail(upstream_out.reader));
+  DEBUG_LOG("Requested block %" PRId64 " %" PRId64 "-%" PRId64, block, block_range.begin, block_range.end - 1);
+  return true;
+}
+
+// Drop the client request, and start on the first block once it is all there.
+bool
+Slicer::read_request()
+{
+  TSIOBufferBlock blk = TSIOBufferReaderStart(client_in.reader);
+  int64_t consumed    = 0;
+
+  for (; blk && !client_request_done; blk = TSIOBufferBlockNext(blk)) {
+    int64_t avail       = 0;
+    char const *start   = TSIOBufferBlockReadStart(blk, client_in.reader, &avail);
+    char const *ptr     = start;
+    TSParseResult result = TSHttpHdrParseReq(client_request.parser, client_request.buffer, client_request.hdr, &ptr, start + avail);
+    consumed += ptr - start;
+    if (result == TS_PARSE_ERROR) {
+      return false;
+    }
+    client_request_done = (result == TS_PARSE_DONE);
+  }
+  TSIOBufferReaderConsume(client_in.reader, client_request_done ? TSIOBufferReaderAvail(client_in.reader) : consumed);
+
+  if (client_request_done && !upstream_vc && client_bytes == 0) {
+    block = range.firstBlock(blockbytes);
+    return start_block();
+  }
+  TSVIOReenable(client_in.vio);
+  return true;
+}
+
+void
+Slicer::start_client_write(int64_t nbytes)
+{
+  client_out.vio = TSVConnWrite(client_vc, cont, client_out.reader, nbytes);
+}
+
+void
+Slicer::send_unsatisfiable()
+{
+  char value[64];
+  int len = snprintf(value, sizeof(value), "bytes */%" PRId64, length);
+
+  TSHttpHdrStatusSet(response.buffer, response.hdr, TS_HTTP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE);
+  TSHttpHdrReasonSet(response.buffer, response.hdr, TSHttpHdrReasonLookup(TS_HTTP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE), -1);
+  response.set(TS_MIME_FIELD_CONTENT_RANGE, value, len);
+  response.set(TS_MIME_FIELD_CONTENT_LENGTH, "0", 1);
+  TSHttpHdrPrint(response.buffer, response.hdr, client_out.buffer);
+  client_bytes = TSIOBufferReaderAvail(client_out.reader);
+  start_client_write(client_bytes);
+}
+
+bool
+Slicer::handle_response_header()
+{
+  TSHttpStatus status = TSHttpHdrStatusGet(response.buffer, response.hdr);
+  std::string content_range = response.value(TS_MIME_FIELD_CONTENT_RANGE);
+  Range block_range;
+  int64_t block_length = -1;
+  bool is_block        = status == TS_HTTP_STATUS_PARTIAL_CONTENT &&
+                  block_range.fromContentRange(content_range.data(), content_range.size(), block_length) && block_length >= 0 &&
+                  block_range.begin == block * blockbytes;
+
+  if (length < 0) {
+    if (!is_block) {
+      // Not a block of a range capable origin, or an error: the client gets the response as is.
+      DEBUG_LOG("Relaying status %d, Content-Range '%s'", status, content_range.c_str());
+      relay = true;
+      TSHttpHdrPrint(response.buffer, response.hdr, client_out.buffer);
+      client_bytes = TSIOBufferReaderAvail(client_out.reader);
+      start_client_write(INT64_MAX);
+      return true;
+    }
+
+    length = block_length;
+    for (size_t i = 0; i < sizeof(CONSISTENT) / sizeof(*CONSISTENT); ++i) {
+      consistent[i] = response.value(CONSISTENT[i]);
+    }
+    if (!range.resolve(length)) {
+      send_unsatisfiable();
+      body_todo = 0;
+      return true;
+    }
+    last_block = range.lastBlock(blockbytes);
+
+    char value[64];
+    if (has_range) {
+      response.set(TS_MIME_FIELD_CONTENT_RANGE, value, range.toContentRange(value, sizeof(value), length));
+    } else {
+      TSHttpHdrStatusSet(response.buffer, response.hdr, TS_HTTP_STATUS_OK);
+      TSHttpHdrReasonSet(response.buffer, response.hdr, TSHttpHdrReasonLookup(TS_HTTP_STATUS_OK), -1);
+      response.remove(TS_MIME_FIELD_CONTENT_RANGE);
+    }
+    response.set(TS_MIME_FIELD_CONTENT_LENGTH, value, snprintf(value, sizeof(value), "%" PRId64, range.size()));
+    TSHttpHdrPrint(response.buffer, response.hdr, client_out.buffer);
+    client_bytes = TSIOBufferReaderAvail(client_out.reader);
+    start_client_write(client_bytes + range.size());
+  } else {
+    if (!is_block || block_length != length) {
+      ERROR_LOG("Block %" PRId64 " has status %d, Content-Range '%s', expected a block of %" PRId64 " bytes", block, status,
+                content_range.c_str(), length);
+      return false;
+    }
+    for (size_t i = 0; i < sizeof(CONSISTENT) / sizeof(*CONSISTENT); ++i) {
+      if (response.value(CONSISTENT[i]) != consistent[i]) {
+        ERROR_LOG("Block %" PRId64 " has a different %s, the object changed", block, CONSISTENT[i]);
+        return false;
+      }
+    }
+  }
+
+  // The part of this block the client asked for, none of it for the first block of a suffix range
+  // that starts further on.
+  int64_t begin = std::max(block_range.begin, range.begin);
+  int64_t end   = std::min(block_range.end, range.end);
+  body_todo     = block_range.size();
+  skip          = std::min(begin - block_range.begin, body_todo);
+  keep          = end > begin ? end - begin : 0;
+  return true;
+}
+
+// Move what arrived from upstream to the client, @return false to abort the request.
+bool
+Slicer::read_upstream()
+{
+  while (!response_done) {
+    TSIOBufferBlock blk = TSIOBufferReaderStart(upstream_in.reader);
+    if (!blk) {
+      return true;
+    }
+    int64_t avail        = 0;
+    char const *start    = TSIOBufferBlockReadStart(blk, upstream_in.reader, &avail);
+    char const *ptr      = start;
+    TSParseResult result = TSHttpHdrParseResp(response.parser, response.buffer, response.hdr, &ptr, start + avail);
+    TSIOBufferReaderConsume(upstream_in.reader, ptr - start);
+    if (result == TS_PARSE_ERROR) {
+      ERROR_LOG("Bad response header for block %" PRId64, block);
+      return false;
+    } else if (result == TS_PARSE_DONE) {
+      response_done = true;
+      if (!handle_response_header()) {
+        return false;
+      }
+    } else if (ptr == start + avail && TSIOBufferBlockNext(blk) == nullptr) {
+      return true;
+    }
+  }
+
+  int64_t avail = TSIOBufferReaderAvail(upstream_in.reader);
+  if (relay) {
+    if (avail > 0) {
+      TSIOBufferCopy(client_out.buffer, upstream_in.reader, avail, 0);
+      TSIOBufferReaderConsume(upstream_in.reader, avail);
+      client_bytes += avail;
+      TSVIOReenable(client_out.vio);
+    }
+    if (!client_backlogged()) {
+      TSVIOReenable(upstream_in.vio);
+    }
+    return true;
+  }
+
+  while (avail > 0 && body_todo > 0 && !client_backlogged()) {
+    int64_t n = std::min(avail, body_todo);
+    if (skip > 0) {
+      n = std::min(n, skip);
+      skip -= n;
+    } else if (keep > 0) {
+      n    = std::min(n, keep);
+      n    = TSIOBufferCopy(client_out.buffer, upstream_in.reader, n, 0);
+      keep -= n;
+      client_bytes += n;
+      TSVIOReenable(client_out.vio);
+    }
+    TSIOBufferReaderConsume(upstream_in.reader, n);
+    body_todo -= n;
+    avail -= n;
+  }
+
+  if (body_todo == 0) {
+    close_upstream();
+    if (block < last_block) {
+      // Past the blocks a suffix range skips.
+      block = std::max(block + 1, range.firstBlock(blockbytes));
+      if (client_backlogged()) {
+        next_pending = true;
+      } else {
+        return start_block();
+      }
+    }
+  } else if (upstream_in.vio && !upstream_done && !client_backlogged()) {
+    TSVIOReenable(upstream_in.vio);
+  }
+  return true;
+}
+
+void
+Slicer::finish_relay()
+{
+  close_upstream();
+  TSVIONBytesSet(client_out.vio, client_bytes);
+  TSVIOReenable(client_out.vio);
+}
+
+int
+slice_handler(TSCont contp, TSEvent event, void *edata)
+{
+  Slicer *slicer = static_cast<Slicer *>(TSContDataGet(contp));
+  bool ok        = true;
+
+  switch (event) {
+  case TS_EVENT_NET_ACCEPT:
+    slicer->client_vc = static_cast<TSVConn>(edata);
+    slicer->client_in.init();
+    slicer->client_out.init();
+    slicer->client_request.init();
+    slicer->client_in.vio = TSVConnRead(slicer->client_vc, contp, slicer->client_in.buffer, INT64_MAX);
+    return TS_EVENT_NONE;
+
+  case TS_EVENT_NET_ACCEPT_FAILED:
+    break;
+
+  case TS_EVENT_VCONN_READ_READY:
+  case TS_EVENT_VCONN_READ_COMPLETE:
+  case TS_EVENT_VCONN_EOS: {
+    TSVConn vc = TSVIOVConnGet(static_cast<TSVIO>(edata));
+    if (vc == slicer->client_vc) {
+      if (event != TS_EVENT_VCONN_READ_READY) {
+        DEBUG_LOG("Client closed its side");
+        break;
+      }
+      ok = slicer->read_request();
+    } else if (vc == slicer->upstream_vc) {
+      ok = slicer->read_upstream();
+      // A block that completed has closed its VConn, and maybe started the next one.
+      if (ok && event != TS_EVENT_VCONN_READ_READY && slicer->upstream_vc == vc) {
+        // The upstream ended before the block did, that is the end only of a relayed response.
+        if (slicer->relay) {
+          slicer->finish_relay();
+        } else if (slicer->response_done && TSIOBufferReaderAvail(slicer->upstream_in.reader) >= slicer->body_todo) {
+          // The rest of the block waits for a slow client, it goes out as the client takes the data.
+          slicer->upstream_done = true;
+        } else {
+          ERROR_LOG("Block %" PRId64 " ended %" PRId64 " bytes short", slicer->block, slicer->body_todo);
+          ok = false;
+        }
+      }
+    }
+    if (ok) {
+      return TS_EVENT_NONE;
+    }
+  } break;
+
+  case TS_EVENT_VCONN_WRITE_READY: {
+    TSVConn vc = TSVIOVConnGet(static_cast<TSVIO>(edata));
+    if (vc == slicer->client_vc) {
+      if (slicer->upstream_vc) {
+        ok = slicer->read_upstream();
+      } else if (slicer->next_pending && !slicer->client_backlogged()) {
+        ok = slicer->start_block();
+      }
+    }
+    if (ok) {
+      return TS_EVENT_NONE;
+    }
+  } break;
+
+  case TS_EVENT_VCONN_WRITE_COMPLETE: {
+    TSVConn vc = TSVIOVConnGet(static_cast<TSVIO>(edata));
+    if (vc == slicer->upstream_vc) {
+      // The block request is sent.
+      TSVConnShutdown(vc, 0, 1);
+      return TS_EVENT_NONE;
+    }
+    DEBUG_LOG("Sent %" PRId64 " bytes", slicer->client_bytes);
+  } break;
+
+  default:
+    DEBUG_LOG("Event %s (%d), closing", TSHttpEventNameLookup(event), event);
+    break;
+  }
+
+  if (!ok && slicer->client_vc) {
+    TSVConnAbort(slicer->client_vc, -1);
+    slicer->client_vc = nullptr;
+  }
+  delete slicer;
+  TSContDestroy(contp);
+  return TS_EVENT_NONE;
+}
+
+/// Set up @a slicer from the client request, @return false if the request is not for slicing.
+bool
+init_request(Slicer *slicer, TSMBuffer bufp, TSMLoc hdr)
+{
+  int len            = 0;
+  char const *method = TSHttpHdrMethodGet(bufp, hdr, &len);
+  if (method != TS_HTTP_METHOD_GET) {
+    return false;
+  }
+
+  TSMLoc field = TSMimeHdrFieldFind(bufp, hdr, TS_MIME_FIELD_RANGE, TS_MIME_LEN_RANGE);
+  if (field) {
+    char const *value = TSMimeHdrFieldValueStringGet(bufp, hdr, field, -1, &len);
+    slicer->has_range = value && slicer->range.fromRangeHeader(value, len);
+    TSHandleMLocRelease(bufp, hdr, field);
+    if (!slicer->has_range) {
+      // Several ranges, or something else this does not understand: leave it to the core.
+      return false;
+    }
+  }
+
+  TSHttpHdrCopy(slicer->request.buffer, slicer->request.hdr, bufp, hdr);
+  TSHttpHdrVersionSet(slicer->request.buffer, slicer->request.hdr, TS_HTTP_VERSION(1, 0));
+  // Blocks must be complete, whatever the client has.
+  slicer->request.remove(TS_MIME_FIELD_IF_MATCH);
+  slicer->request.remove(TS_MIME_FIELD_IF_MODIFIED_SINCE);
+  slicer->request.remove(TS_MIME_FIELD_IF_NONE_MATCH);
+  slicer->request.remove(TS_MIME_FIELD_IF_RANGE);
+  slicer->request.remove(TS_MIME_FIELD_IF_UNMODIFIED_SINCE);
+  slicer->request.remove(TS_MIME_FIELD_CONNECTION);
+  return true;
+}
+} // namespace
+
+TSReturnCode
+TSRemapInit(TSRemapInterface *api_info, char *errbuf, int errbuf_size)
+{
+  if (!api_info) {
+    strncpy(errbuf, "[tsremap_init] - Invalid TSRemapInterface argument", errbuf_size - 1);
+    return TS_ERROR;
+  }
+
+  if (api_info->tsremap_version < TSREMAP_VERSION) {
+    snprintf(errbuf, errbuf_size, "[TSRemapInit] - Incorrect API version %ld.%ld", api_info->tsremap_version >> 16,
+             (api_info->tsremap_version & 0xffff));
+    return TS_ERROR;
+  }
+
+  DEBUG_LOG("slice remap is successfully initialized.");
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSRemapNewInstance(int argc, char *argv[], void **ih, char *errbuf, int errbuf_size)
+{
+  Config *config = new Config;
+
+  // Skip over the remap parameters.
+  for (int i = 2; i < argc; ++i) {
+    char const *arg = argv[i];
+    if (strncmp(arg, "--blockbytes=", 13) == 0) {
+      char *end          = nullptr;
+      config->blockbytes = strtoll(arg + 13, &end, 10);
+      switch (end && *end ? *end : 0) {
+      case 'k':
+      case 'K':
+        config->blockbytes *= 1024;
+        break;
+      case 'm':
+      case 'M':
+        config->blockbytes *= 1024 * 1024;
+        break;
+      }
+      if (config->blockbytes < MIN_BLOCK || config->blockbytes > MAX_BLOCK) {
+        snprintf(errbuf, errbuf_size, "[%s] --blockbytes must be between %" PRId64 " and %" PRId64, PLUGIN_NAME, MIN_BLOCK,
+                 MAX_BLOCK);
+        delete config;
+        return TS_ERROR;
+      }
+    } else {
+      snprintf(errbuf, errbuf_size, "[%s] Unknown parameter '%s'", PLUGIN_NAME, arg);
+      delete config;
+      return TS_ERROR;
+    }
+  }
+
+  DEBUG_LOG("Block size %" PRId64, config->blockbytes);
+  *ih = config;
+  return TS_SUCCESS;
+}
+
+void
+TSRemapDeleteInstance(void *ih)
+{
+  delete static_cast<Config *>(ih);
+}
+
+TSRemapStatus
+TSRemapDoRemap(void *ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
+{
+  Config *config = static_cast<Config *>(ih);
+  TSMBuffer bufp = rri->requestBufp;
+  TSMLoc hdr     = rri->requestHdrp;
+
+  // Block requests go on to the rest of the remap rule, cache_range_requests in particular.
+  char const *tag = TSHttpTxnPluginTagGet(txnp);
+  if (tag && strcmp(tag, PLUGIN_NAME) == 0) {
+    return TSREMAP_NO_REMAP;
+  }
+
+  Slicer *slicer = new Slicer(config->blockbytes, TSHttpTxnClientAddrGet(txnp));
+  if (!init_request(slicer, bufp, hdr)) {
+    delete slicer;
+    return TSREMAP_NO_REMAP;
+  }
+
+  slicer->cont = TSContCreate(slice_handler, TSMutexCreate());
+  TSContDataSet(slicer->cont, slicer);
+  TSHttpTxnIntercept(slicer->cont, txnp);
+  DEBUG_LOG("Slicing %s request", slicer->has_range ? "range" : "full");
+  return TSREMAP_NO_REMAP_STOP;
+}
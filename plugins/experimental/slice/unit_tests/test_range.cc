@@ -0,0 +1,145 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * @file test_range.cc
+ * @brief Unit tests for the byte ranges of the slice plugin.
+ */
+
+#define CATCH_CONFIG_MAIN /* include main function */
+#include <catch.hpp>      /* catch unit-test framework */
+#include <cstring>
+#include "../Range.h"
+
+namespace
+{
+bool
+parse(Range &range, char const *str)
+{
+  return range.fromRangeHeader(str, strlen(str));
+}
+} // namespace
+
+TEST_CASE("Range: request header", "[slice][Range]")
+{
+  Range range;
+
+  CHECK(parse(range, "bytes=0-99"));
+  CHECK(range.begin == 0);
+  CHECK(range.end == 100);
+
+  CHECK(parse(range, " bytes = 100 - 199 "));
+  CHECK(range.begin == 100);
+  CHECK(range.end == 200);
+
+  CHECK(parse(range, "bytes=1000-"));
+  CHECK(range.begin == 1000);
+  CHECK(range.end == Range::maxval);
+
+  CHECK(parse(range, "bytes=-500"));
+  CHECK(range.isSuffix());
+  CHECK(range.begin == -500);
+
+  CHECK_FALSE(parse(range, "bytes=0-99,200-299"));
+  CHECK_FALSE(parse(range, "bytes=99-0"));
+  CHECK_FALSE(parse(range, "bytes=-0"));
+  CHECK_FALSE(parse(range, "bytes=-"));
+  CHECK_FALSE(parse(range, "bytes=a-b"));
+  CHECK_FALSE(parse(range, "items=0-99"));
+  CHECK_FALSE(parse(range, "bytes=0-99999999999999999999"));
+}
+
+TEST_CASE("Range: resolve", "[slice][Range]")
+{
+  Range range;
+
+  REQUIRE(parse(range, "bytes=1000-"));
+  CHECK(range.resolve(5000));
+  CHECK(range.begin == 1000);
+  CHECK(range.end == 5000);
+
+  REQUIRE(parse(range, "bytes=-500"));
+  CHECK(range.resolve(5000));
+  CHECK(range.begin == 4500);
+  CHECK(range.end == 5000);
+
+  REQUIRE(parse(range, "bytes=-500"));
+  CHECK(range.resolve(100));
+  CHECK(range.begin == 0);
+  CHECK(range.end == 100);
+
+  REQUIRE(parse(range, "bytes=0-99999"));
+  CHECK(range.resolve(5000));
+  CHECK(range.end == 5000);
+
+  REQUIRE(parse(range, "bytes=5000-5999"));
+  CHECK_FALSE(range.resolve(5000));
+}
+
+TEST_CASE("Range: blocks", "[slice][Range]")
+{
+  int64_t const blockbytes = 1024;
+  Range range;
+
+  REQUIRE(parse(range, "bytes=1000-3071"));
+  CHECK(range.firstBlock(blockbytes) == 0);
+  CHECK(range.lastBlock(blockbytes) == 2);
+
+  REQUIRE(parse(range, "bytes=1024-2047"));
+  CHECK(range.firstBlock(blockbytes) == 1);
+  CHECK(range.lastBlock(blockbytes) == 1);
+
+  REQUIRE(parse(range, "bytes=-10"));
+  CHECK(range.firstBlock(blockbytes) == 0);
+  REQUIRE(range.resolve(10 * blockbytes));
+  CHECK(range.firstBlock(blockbytes) == 9);
+
+  Range block = Range::forBlock(3, blockbytes);
+  CHECK(block.begin == 3072);
+  CHECK(block.end == 4096);
+
+  char buf[64];
+  block.toRangeHeader(buf, sizeof(buf));
+  CHECK(strcmp(buf, "bytes=3072-4095") == 0);
+  block.toContentRange(buf, sizeof(buf), 10000);
+  CHECK(strcmp(buf, "bytes 3072-4095/10000") == 0);
+}
+
+TEST_CASE("Range: content range", "[slice][Range]")
+{
+  Range range;
+  int64_t length = 0;
+  char const *str;
+
+  str = "bytes 1024-2047/10000";
+  CHECK(range.fromContentRange(str, strlen(str), length));
+  CHECK(range.begin == 1024);
+  CHECK(range.end == 2048);
+  CHECK(length == 10000);
+
+  str = "bytes 0-9/*";
+  CHECK(range.fromContentRange(str, strlen(str), length));
+  CHECK(length == -1);
+
+  str = "bytes */10000";
+  CHECK_FALSE(range.fromContentRange(str, strlen(str), length));
+  str = "bytes 0-99/50";
+  CHECK_FALSE(range.fromContentRange(str, strlen(str), length));
+  str = "bytes 0-99";
+  CHECK_FALSE(range.fromContentRange(str, strlen(str), length));
+}
@@ -0,0 +1,135 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+//////////////////////////////////////////////////////////////////////////////////////////////
+// benchmark_header_rewrite.cc: time the evaluation of a large configuration, one rule after the
+// other and through the RuleIndex, for a fake client request.
+//
+//   benchmark_header_rewrite [rules [iterations]]
+//
+// The request is a fake one, see fake_txn.h.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ts/ts.h"
+
+#include "ruleset.h"
+#include "ruleindex.h"
+#include "resources.h"
+#include "fake_txn.h"
+
+const char PLUGIN_NAME[]     = "benchmark_header_rewrite";
+const char PLUGIN_NAME_DBG[] = "benchmark_dbg_header_rewrite";
+
+#if HAVE_GEOIP_H
+GeoIP *gGeoIP[NUM_DB_TYPES];
+#endif
+
+namespace
+{
+const FakeRequest TEMPLATE = {"GET",
+                              "static-101-app.css",
+                              {{"Host", "host100.example.com", true},
+                               {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64) bot104", true},
+                               {"Accept", "text/css,*/*;q=0.1", true},
+                               {"Accept-Encoding", "gzip, deflate, br", true},
+                               {"Cookie", "session=abcdefghijklmnopqrstuvwxyz0123456789", true}}};
+
+// Five kinds of rules, most of them tests the host, path or method, like large configurations do.
+void
+add_rule(std::vector<std::string> &config, int i)
+{
+  std::string n = std::to_string(i);
+
+  switch (i % 5) {
+  case 0:
+    config.push_back("cond %{CLIENT-HEADER:Host} =host" + n + ".example.com");
+    break;
+  case 1:
+    config.push_back("cond %{CLIENT-URL:PATH} /^static-" + n + "-/ [AND]");
+    config.push_back("cond %{METHOD} =GET");
+    break;
+  case 2:
+    config.push_back("cond %{METHOD} =POST [AND]");
+    config.push_back("cond %{CLIENT-HEADER:X-Api-Version} =" + n);
+    break;
+  case 3:
+    config.push_back("cond %{PATH} =img/" + n + ".png");
+    break;
+  case 4:
+    config.push_back("cond %{CLIENT-HEADER:User-Agent} /bot" + n + "/");
+    break;
+  }
+  config.push_back("set-header X-Rule-" + n + " matched");
+}
+
+template <typename Run>
+double
+per_request(int iterations, ResourceIDs ids, Run run)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; ++i) {
+    fake_request = TEMPLATE;
+
+    Resources res(reinterpret_cast<TSHttpTxn>(&fake_request), static_cast<TSCont>(nullptr));
+
+    res.gather(ids, TS_HTTP_READ_REQUEST_HDR_HOOK);
+    run(res);
+  }
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  int nrules     = argc > 1 ? atoi(argv[1]) : 500;
+  int iterations = argc > 2 ? atoi(argv[2]) : 10000;
+  std::vector<std::string> config;
+
+  for (int i = 0; i < nrules; ++i) {
+    add_rule(config, i);
+  }
+
+  RuleSet *rules  = fake_load(config);
+  ResourceIDs ids = rules->get_all_resource_ids();
+  RuleIndex index;
+
+  index.build(rules);
+
+  double linear_time        = per_request(iterations, ids, [rules](const Resources &res) { fake_run_linear(rules, res); });
+  std::string linear_result = fake_fields();
+
+  double index_time = per_request(iterations, ids, [&index](const Resources &res) { index.run(res); });
+
+  printf("%d rules\n", nrules);
+  printf("linear  %8.2f us\n", linear_time);
+  printf("indexed %8.2f us\n", index_time);
+
+  if (fake_fields() != linear_result) {
+    printf("the request differs:\n%s\nvs\n%s", linear_result.c_str(), fake_fields().c_str());
+    return 1;
+  }
+
+  delete rules;
+  return 0;
+}
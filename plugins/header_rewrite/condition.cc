@@ -20,6 +20,8 @@
 //
 //
 #include <string>
+#include <cctype>
+#include <cstring>
 
 #include "ts/ts.h"
 
@@ -77,3 +79,48 @@ Condition::initialize(Parser &p)
 
   _cond_op = parse_matcher_op(p.get_arg());
 }
+
+// Only regular expressions of a literal anchored at the start, "^/static/", are indexed as a prefix.
+static bool
+regex_literal_prefix(const std::string &regex, std::string &prefix)
+{
+  if (regex.size() < 2 || regex[0] != '^') {
+    return false;
+  }
+
+  prefix.clear();
+  for (size_t i = 1; i < regex.size(); ++i) {
+    char c = regex[i];
+
+    if (c == '\\') {
+      // An escaped punctuation character is a literal, but not the escapes like \d or \w
+      if (++i == regex.size() || std::isalnum(static_cast<unsigned char>(regex[i]))) {
+        return false;
+      }
+      c = regex[i];
+    } else if (strchr(".[]()*+?{}|^$", c)) {
+      return false;
+    }
+    prefix += c;
+  }
+
+  return true;
+}
+
+bool
+Condition::string_index_key(std::string &key, bool &prefix) const
+{
+  const Matchers<std::string> *match = static_cast<const Matchers<std::string> *>(_matcher);
+
+  switch (_cond_op) {
+  case MATCH_EQUAL:
+    key    = match->get();
+    prefix = false;
+    return true;
+  case MATCH_REGULAR_EXPRESSION:
+    prefix = true;
+    return regex_literal_prefix(match->get(), key);
+  default:
+    return false;
+  }
+}
@@ -86,6 +86,24 @@ public:
     return false; // Shouldn't happen.
   }
 
+  // Find the condition of this chain that a rule can be indexed on, see RuleIndex. This is the
+  // first condition that only matches a literal (or a literal prefix) of its value, as long as
+  // all the conditions before it are AND'ed, such that the rule can not match unless it does.
+  Condition *
+  find_index_condition(std::string &dimension, std::string &key, bool &prefix)
+  {
+    if (_mods & COND_OR) {
+      return nullptr;
+    }
+    if (!(_mods & COND_NOT) && index_key(dimension, key, prefix)) {
+      return this;
+    }
+    if (_next) {
+      return static_cast<Condition *>(_next)->find_index_condition(dimension, key, prefix);
+    }
+    return nullptr;
+  }
+
   bool
   last() const
   {
@@ -126,6 +144,17 @@ protected:
   // Evaluate the condition
   virtual bool eval(const Resources &res) = 0;
 
+  // Conditions that can be indexed name what they test in dimension, which must be the same for
+  // all conditions evaluating to the same value, and set the literal they match in key.
+  virtual bool
+  index_key(std::string & /* dimension ATS_UNUSED */, std::string & /* key ATS_UNUSED */, bool & /* prefix ATS_UNUSED */) const
+  {
+    return false;
+  }
+
+  // For the conditions using Matchers<std::string>, and evaluating to their append_value()
+  bool string_index_key(std::string &key, bool &prefix) const;
+
   std::string _qualifier;
   MatcherOps _cond_op;
   Matcher *_matcher;
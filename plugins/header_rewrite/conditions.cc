@@ -61,6 +61,19 @@ ConditionStatus::eval(const Resources &res)
   return static_cast<MatcherType *>(_matcher)->test(res.resp_status);
 }
 
+bool
+ConditionStatus::index_key(std::string &dimension, std::string &key, bool &prefix) const
+{
+  if (_cond_op != MATCH_EQUAL) {
+    return false;
+  }
+
+  dimension = "STATUS";
+  key       = std::to_string(static_cast<const MatcherType *>(_matcher)->get());
+  prefix    = false;
+  return true;
+}
+
 void
 ConditionStatus::append_value(std::string &s, const Resources &res)
 {
@@ -90,6 +103,13 @@ ConditionMethod::eval(const Resources &res)
   return static_cast<const MatcherType *>(_matcher)->test(s);
 }
 
+bool
+ConditionMethod::index_key(std::string &dimension, std::string &key, bool &prefix) const
+{
+  dimension = "METHOD";
+  return string_index_key(key, prefix);
+}
+
 void
 ConditionMethod::append_value(std::string &s, const Resources &res)
 {
@@ -209,6 +229,14 @@ ConditionHeader::append_value(std::string &s, const Resources &res)
   const char *value;
   int len;
 
+  std::string header;
+
+  if (res.cached_header(_client, _qualifier, header)) {
+    TSDebug(PLUGIN_NAME, "Appending cached HEADER(%s) to evaluation value -> %s", _qualifier.c_str(), header.c_str());
+    s += header;
+    return;
+  }
+
   if (_client) {
     bufp    = res.client_bufp;
     hdr_loc = res.client_hdr_loc;
@@ -227,15 +255,18 @@ ConditionHeader::append_value(std::string &s, const Resources &res)
       value          = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field_loc, -1, &len);
       next_field_loc = TSMimeHdrFieldNextDup(bufp, hdr_loc, field_loc);
       TSDebug(PLUGIN_NAME, "Appending HEADER(%s) to evaluation value -> %.*s", _qualifier.c_str(), len, value);
-      s.append(value, len);
+      header.append(value, len);
       // multiple headers with the same name must be semantically the same as one value which is comma separated
       if (next_field_loc) {
-        s += ',';
+        header += ',';
       }
       TSHandleMLocRelease(bufp, hdr_loc, field_loc);
       field_loc = next_field_loc;
     }
   }
+
+  res.cache_header(_client, _qualifier, header);
+  s += header;
 }
 
 bool
@@ -249,6 +280,17 @@ ConditionHeader::eval(const Resources &res)
   return static_cast<const MatcherType *>(_matcher)->test(s);
 }
 
+bool
+ConditionHeader::index_key(std::string &dimension, std::string &key, bool &prefix) const
+{
+  // Header names are case insensitive
+  dimension = _client ? "CLIENT-HEADER:" : "HEADER:";
+  for (char c : _qualifier) {
+    dimension += std::tolower(static_cast<unsigned char>(c));
+  }
+  return string_index_key(key, prefix);
+}
+
 // ConditionPath
 void
 ConditionPath::initialize(Parser &p)
@@ -289,6 +331,13 @@ ConditionPath::eval(const Resources &res)
   return static_cast<MatcherType *>(_matcher)->test(s);
 }
 
+bool
+ConditionPath::index_key(std::string &dimension, std::string &key, bool &prefix) const
+{
+  dimension = "PATH";
+  return string_index_key(key, prefix);
+}
+
 // ConditionQuery
 void
 ConditionQuery::initialize(Parser &p)
@@ -439,6 +488,20 @@ ConditionUrl::eval(const Resources &res)
   return static_cast<const Matchers<std::string> *>(_matcher)->test(s);
 }
 
+bool
+ConditionUrl::index_key(std::string &dimension, std::string &key, bool &prefix) const
+{
+  static const char *const names[] = {"CLIENT-URL:", "URL:", "FROM-URL:", "TO-URL:"};
+
+  if (_url_qual != URL_QUAL_HOST && _url_qual != URL_QUAL_PATH) {
+    return false;
+  }
+
+  dimension = names[_type];
+  dimension += (_url_qual == URL_QUAL_HOST) ? "HOST" : "PATH";
+  return string_index_key(key, prefix);
+}
+
 // ConditionDBM: do a lookup against a DBM
 void
 ConditionDBM::initialize(Parser &p)
@@ -95,6 +95,7 @@ public:
 
 protected:
   bool eval(const Resources &res) override;
+  bool index_key(std::string &dimension, std::string &key, bool &prefix) const override;
   void initialize_hooks() override; // Return status only valid in certain hooks
 
 private:
@@ -113,6 +114,7 @@ public:
 
 protected:
   bool eval(const Resources &res) override;
+  bool index_key(std::string &dimension, std::string &key, bool &prefix) const override;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(ConditionMethod);
@@ -240,6 +242,7 @@ public:
 
 protected:
   bool eval(const Resources &res) override;
+  bool index_key(std::string &dimension, std::string &key, bool &prefix) const override;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(ConditionHeader);
@@ -259,6 +262,7 @@ public:
 
 protected:
   bool eval(const Resources &res) override;
+  bool index_key(std::string &dimension, std::string &key, bool &prefix) const override;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(ConditionPath);
@@ -300,6 +304,7 @@ public:
 
 protected:
   bool eval(const Resources &res) override;
+  bool index_key(std::string &dimension, std::string &key, bool &prefix) const override;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(ConditionUrl);
@@ -0,0 +1,91 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+//////////////////////////////////////////////////////////////////////////////////////////////
+// fake_ts_stubs.c: the plugin API the fake transaction (fake_txn.cc) does not implement, so that
+// the test and the benchmark link without traffic_server. This deliberately doesn't include
+// ts/ts.h, the stubs are only there for the linker and abort if they are ever called.
+//
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STUB(name)                                                   \
+  void name(void)                                                    \
+  {                                                                  \
+    fprintf(stderr, "%s is not implemented by the fake\n", #name);   \
+    abort();                                                         \
+  }
+
+STUB(TSClientRequestUuidGet)
+STUB(TSContCreate)
+STUB(TSContDataGet)
+STUB(TSContDataSet)
+STUB(TSContDestroy)
+STUB(TSHttpHdrLengthGet)
+STUB(TSHttpHdrReasonLookup)
+STUB(TSHttpHdrReasonSet)
+STUB(TSHttpHdrStatusGet)
+STUB(TSHttpHdrStatusSet)
+STUB(TSHttpHdrUrlSet)
+STUB(TSHttpSsnTransactionCount)
+STUB(TSHttpTxnActiveTimeoutSet)
+STUB(TSHttpTxnClientAddrGet)
+STUB(TSHttpTxnClientPacketDscpSet)
+STUB(TSHttpTxnClientPacketMarkSet)
+STUB(TSHttpTxnClientProtocolStackContains)
+STUB(TSHttpTxnClientProtocolStackGet)
+STUB(TSHttpTxnClientRespGet)
+STUB(TSHttpTxnConfigFind)
+STUB(TSHttpTxnConfigFloatSet)
+STUB(TSHttpTxnConfigIntSet)
+STUB(TSHttpTxnConfigStringSet)
+STUB(TSHttpTxnConnectTimeoutSet)
+STUB(TSHttpTxnDNSTimeoutSet)
+STUB(TSHttpTxnDebugSet)
+STUB(TSHttpTxnEffectiveUrlStringGet)
+STUB(TSHttpTxnErrorBodySet)
+STUB(TSHttpTxnHookAdd)
+STUB(TSHttpTxnIdGet)
+STUB(TSHttpTxnIncomingAddrGet)
+STUB(TSHttpTxnIsInternal)
+STUB(TSHttpTxnNoActivityTimeoutSet)
+STUB(TSHttpTxnOutgoingAddrGet)
+STUB(TSHttpTxnReenable)
+STUB(TSHttpTxnServerAddrGet)
+STUB(TSHttpTxnServerReqGet)
+STUB(TSHttpTxnServerRespGet)
+STUB(TSHttpTxnSsnGet)
+STUB(TSHttpTxnStatusSet)
+STUB(TSMutexCreate)
+STUB(TSProcessUuidGet)
+STUB(TSSkipRemappingSet)
+STUB(TSStatCreate)
+STUB(TSStatFindName)
+STUB(TSStatIntIncrement)
+STUB(TSUrlCreate)
+STUB(TSUrlHostSet)
+STUB(TSUrlHttpParamsGet)
+STUB(TSUrlHttpQueryGet)
+STUB(TSUrlHttpQuerySet)
+STUB(TSUrlParse)
+STUB(TSUrlPathSet)
+STUB(TSUrlPortGet)
+STUB(TSUrlPortSet)
+STUB(TSUrlSchemeGet)
+STUB(TSUrlSchemeSet)
+STUB(TSUrlStringGet)
+STUB(TSUuidStringGet)
@@ -0,0 +1,290 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+//////////////////////////////////////////////////////////////////////////////////////////////
+// fake_txn.cc: the plugin API the rules use, on a fake client request, see fake_txn.h.
+//
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <strings.h>
+
+#include "ts/ts.h"
+
+#include "parser.h"
+#include "fake_txn.h"
+
+FakeRequest fake_request;
+
+namespace
+{
+TSMLoc
+field_loc(size_t i)
+{
+  return reinterpret_cast<TSMLoc>(i + 1);
+}
+
+FakeField &
+field(TSMLoc loc)
+{
+  return fake_request.fields[reinterpret_cast<size_t>(loc) - 1];
+}
+
+TSMLoc
+find_field(const char *name, int length, size_t from)
+{
+  if (length < 0) {
+    length = strlen(name);
+  }
+  for (size_t i = from; i < fake_request.fields.size(); ++i) {
+    const FakeField &f = fake_request.fields[i];
+
+    if (f.live && f.name.size() == static_cast<size_t>(length) && 0 == strncasecmp(f.name.data(), name, length)) {
+      return field_loc(i);
+    }
+  }
+  return TS_NULL_MLOC;
+}
+
+void
+append(RuleSet *&rules, RuleSet *rule)
+{
+  if (nullptr == rules) {
+    rules = rule;
+  } else {
+    rules->append(rule);
+  }
+}
+} // namespace
+
+RuleSet *
+fake_load(const std::vector<std::string> &config)
+{
+  RuleSet *rules = nullptr;
+  RuleSet *rule  = nullptr;
+  int lineno     = 0;
+
+  for (auto const &line : config) {
+    Parser p(line);
+
+    ++lineno;
+    if (p.is_cond() && rule && rule->has_operator()) {
+      append(rules, rule);
+      rule = nullptr;
+    }
+    if (nullptr == rule) {
+      rule = new RuleSet();
+      rule->set_hook(TS_HTTP_READ_REQUEST_HDR_HOOK);
+    }
+    if (!(p.is_cond() ? rule->add_condition(p, "fake", lineno) : rule->add_operator(p, "fake", lineno))) {
+      fprintf(stderr, "bad rule: %s\n", line.c_str());
+      exit(1);
+    }
+  }
+  append(rules, rule);
+
+  return rules;
+}
+
+void
+fake_run_linear(const RuleSet *rules, const Resources &res)
+{
+  for (const RuleSet *rule = rules; rule; rule = rule->next) {
+    if (rule->eval(res)) {
+      OperModifiers rt = rule->exec(res);
+
+      if (rule->last() || (rt & OPER_LAST)) {
+        break;
+      }
+    }
+  }
+}
+
+std::string
+fake_fields()
+{
+  std::string s;
+
+  for (auto const &f : fake_request.fields) {
+    if (f.live) {
+      s += f.name + ": " + f.value + "\n";
+    }
+  }
+  return s;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The plugin API, for the fake request
+//
+void
+TSDebug(const char * /* tag ATS_UNUSED */, const char * /* fmt ATS_UNUSED */, ...)
+{
+}
+
+void
+TSError(const char *fmt, ...)
+{
+  va_list args;
+
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+int
+TSIsDebugTagSet(const char * /* t ATS_UNUSED */)
+{
+  return 0;
+}
+
+void
+_TSReleaseAssert(const char *txt, const char *f, int l)
+{
+  fprintf(stderr, "%s:%d: failed assertion `%s`\n", f, l, txt);
+  abort();
+}
+
+char *
+_TSstrdup(const char *str, int64_t length, const char * /* path ATS_UNUSED */)
+{
+  return length < 0 ? strdup(str) : strndup(str, length);
+}
+
+void
+_TSfree(void *ptr)
+{
+  free(ptr);
+}
+
+const char *
+TSHttpHookNameLookup(TSHttpHookID /* hook ATS_UNUSED */)
+{
+  return "TS_HTTP_READ_REQUEST_HDR_HOOK";
+}
+
+TSReturnCode
+TSHandleMLocRelease(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* parent ATS_UNUSED */, TSMLoc /* mloc ATS_UNUSED */)
+{
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSHttpTxnClientReqGet(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer *bufp, TSMLoc *offset)
+{
+  *bufp   = reinterpret_cast<TSMBuffer>(&fake_request);
+  *offset = reinterpret_cast<TSMLoc>(&fake_request);
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSHttpTxnPristineUrlGet(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer *bufp, TSMLoc *url_loc)
+{
+  *bufp    = reinterpret_cast<TSMBuffer>(&fake_request);
+  *url_loc = reinterpret_cast<TSMLoc>(&fake_request.path);
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSHttpHdrUrlGet(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* offset ATS_UNUSED */, TSMLoc *locp)
+{
+  *locp = reinterpret_cast<TSMLoc>(&fake_request.path);
+  return TS_SUCCESS;
+}
+
+const char *
+TSHttpHdrMethodGet(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* offset ATS_UNUSED */, int *length)
+{
+  *length = fake_request.method.size();
+  return fake_request.method.data();
+}
+
+const char *
+TSUrlPathGet(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* offset ATS_UNUSED */, int *length)
+{
+  *length = fake_request.path.size();
+  return fake_request.path.data();
+}
+
+const char *
+TSUrlHostGet(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* offset ATS_UNUSED */, int *length)
+{
+  *length = 0;
+  return "";
+}
+
+TSMLoc
+TSMimeHdrFieldFind(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* hdr ATS_UNUSED */, const char *name, int length)
+{
+  return find_field(name, length, 0);
+}
+
+TSMLoc
+TSMimeHdrFieldNextDup(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* hdr ATS_UNUSED */, TSMLoc field_loc)
+{
+  const FakeField &f = field(field_loc);
+
+  return find_field(f.name.data(), f.name.size(), reinterpret_cast<size_t>(field_loc));
+}
+
+const char *
+TSMimeHdrFieldValueStringGet(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* hdr ATS_UNUSED */, TSMLoc field_loc,
+                             int /* idx ATS_UNUSED */, int *value_len_ptr)
+{
+  const FakeField &f = field(field_loc);
+
+  *value_len_ptr = f.value.size();
+  return f.value.data();
+}
+
+TSReturnCode
+TSMimeHdrFieldValueStringSet(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* hdr ATS_UNUSED */, TSMLoc field_loc,
+                             int /* idx ATS_UNUSED */, const char *value, int length)
+{
+  field(field_loc).value.assign(value, length < 0 ? strlen(value) : length);
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSMimeHdrFieldCreateNamed(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* mh_mloc ATS_UNUSED */, const char *name, int name_len,
+                          TSMLoc *locp)
+{
+  // Not live until appended
+  fake_request.fields.push_back({std::string(name, name_len < 0 ? strlen(name) : name_len), "", false});
+  *locp = field_loc(fake_request.fields.size() - 1);
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSMimeHdrFieldAppend(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* hdr ATS_UNUSED */, TSMLoc field_loc)
+{
+  field(field_loc).live = true;
+  return TS_SUCCESS;
+}
+
+TSReturnCode
+TSMimeHdrFieldDestroy(TSMBuffer /* bufp ATS_UNUSED */, TSMLoc /* hdr ATS_UNUSED */, TSMLoc field_loc)
+{
+  field(field_loc).live = false;
+  return TS_SUCCESS;
+}
+
+const TSMLoc TS_NULL_MLOC        = nullptr;
+const char *TS_MIME_FIELD_COOKIE = "Cookie";
+int TS_MIME_LEN_COOKIE           = 6;
@@ -0,0 +1,53 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A fake client request, which the plugin API in fake_txn.cc works on, such that rules can be
+// run without traffic_server. The rest of the plugin API aborts (see fake_ts_stubs.c).
+//
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ruleset.h"
+#include "resources.h"
+
+struct FakeField {
+  std::string name;
+  std::string value;
+  bool live;
+};
+
+struct FakeRequest {
+  std::string method;
+  std::string path;
+  std::vector<FakeField> fields;
+};
+
+// The request of every transaction
+extern FakeRequest fake_request;
+
+// The rulesets of a configuration, for the read request header hook
+RuleSet *fake_load(const std::vector<std::string> &config);
+
+// Evaluate the rules one by one, like without a RuleIndex
+void fake_run_linear(const RuleSet *rules, const Resources &res);
+
+// The live header fields of the request, one per line
+std::string fake_fields();
@@ -26,14 +26,15 @@
 #include <ostream>
 
 #include "parser.h"
+#include "ruleindex.h"
+#include "fake_txn.h"
 
 const char PLUGIN_NAME[]     = "TEST_header_rewrite";
 const char PLUGIN_NAME_DBG[] = "TEST_dbg_header_rewrite";
 
-extern "C" void
-TSError(const char *fmt, ...)
-{
-}
+#if HAVE_GEOIP_H
+GeoIP *gGeoIP[NUM_DB_TYPES];
+#endif
 
 class ParserTest : public Parser
 {
@@ -424,10 +425,91 @@ test_processing()
 
   return errors;
 }
+
+namespace
+{
+const std::vector<std::string> INDEX_CONFIG = {"cond %{CLIENT-HEADER:Host} =a.example.com",
+                                               "set-header X-Rule host-a",
+                                               "cond %{CLIENT-HEADER:Host} =b.example.com",
+                                               "set-header Host c.example.com",
+                                               "set-header X-Copy %{CLIENT-HEADER:Host}",
+                                               "cond %{CLIENT-HEADER:Host} =c.example.com",
+                                               "set-header X-Rule host-c",
+                                               "cond %{PATH} /^img/",
+                                               "set-header X-Img true",
+                                               "cond %{PATH} /^css/",
+                                               "set-header X-Css true [L]",
+                                               "cond %{PATH} =last",
+                                               "set-header X-Last true [L]",
+                                               "cond %{CLIENT-HEADER:Host} =a.example.com",
+                                               "set-header X-After-Last true",
+                                               "cond %{METHOD} =GET",
+                                               "set-header X-Get true"};
+
+std::string
+run_rules(const FakeRequest &request, const RuleSet *rules, const RuleIndex *index)
+{
+  fake_request = request;
+
+  Resources res(reinterpret_cast<TSHttpTxn>(&fake_request), static_cast<TSCont>(nullptr));
+
+  res.gather(rules->get_all_resource_ids(), TS_HTTP_READ_REQUEST_HDR_HOOK);
+  if (index) {
+    index->run(res);
+  } else {
+    fake_run_linear(rules, res);
+  }
+  return fake_fields();
+}
+} // namespace
+
+int
+test_index()
+{
+  int errors = 0;
+  /*
+   * The rules must have the same effects through the RuleIndex as evaluated one by one.
+   */
+  struct {
+    FakeRequest request;
+    std::string fields;
+  } const tests[] = {
+    {{"GET", "img/1.png", {{"Host", "a.example.com", true}}},
+     "Host: a.example.com\nX-Rule: host-a\nX-Img: true\nX-After-Last: true\nX-Get: true\n"},
+    // The second operator must see the Host header the first one set
+    {{"GET", "css/site.css", {{"Host", "b.example.com", true}}},
+     "Host: c.example.com\nX-Copy: c.example.com\nX-Rule: host-c\nX-Css: true\n"},
+    {{"GET", "last", {{"Host", "d.example.com", true}}}, "Host: d.example.com\nX-Last: true\n"},
+    {{"POST", "index.html", {{"Host", "a.example.com", true}}}, "Host: a.example.com\nX-Rule: host-a\nX-After-Last: true\n"},
+  };
+
+  RuleSet *rules = fake_load(INDEX_CONFIG);
+  RuleIndex index;
+
+  index.build(rules);
+
+  for (auto const &test : tests) {
+    std::string linear  = run_rules(test.request, rules, nullptr);
+    std::string indexed = run_rules(test.request, rules, &index);
+
+    std::cout << "Finished index test: " << test.request.method << " " << test.request.path << std::endl;
+    if (linear != test.fields || indexed != test.fields) {
+      std::cerr << "CHECK FAILED for " << test.request.path << ":\n"
+                << test.fields << "!=\n"
+                << linear << "(linear) or\n"
+                << indexed << "(indexed)" << std::endl;
+      ++errors;
+    }
+  }
+
+  delete rules;
+  return errors;
+}
+
 int
 main()
 {
-  if (test_parsing() || test_processing()) {
+  if (test_parsing() || test_processing() || test_index()) {
     return 1;
   }
 
@@ -20,6 +20,8 @@
 // operator.cc: Implementation of the operator base class
 //
 //
+#include <strings.h>
+
 #include "ts/ts.h"
 #include "operator.h"
 
@@ -47,6 +49,21 @@ Operator::initialize(Parser &p)
   }
 }
 
+// Whether an index dimension (see RuleIndex) is one of the header @a name.
+static bool
+is_header_dimension(const std::string &dimension, const char *name)
+{
+  std::string::size_type colon = dimension.find(':');
+
+  if (colon == std::string::npos) {
+    return false;
+  }
+  if (dimension.compare(0, colon, "HEADER") && dimension.compare(0, colon, "CLIENT-HEADER")) {
+    return false;
+  }
+  return 0 == strcasecmp(dimension.c_str() + colon + 1, name);
+}
+
 void
 OperatorHeaders::initialize(Parser &p)
 {
@@ -60,6 +77,17 @@ OperatorHeaders::initialize(Parser &p)
   require_resources(RSRC_CLIENT_RESPONSE_HEADERS);
 }
 
+bool
+OperatorHeaders::changes(const std::string &dimension) const
+{
+  if (is_header_dimension(dimension, _header.c_str())) {
+    return true;
+  }
+
+  // The host of the URLs can come from the Host header
+  return 0 == strcasecmp(_header.c_str(), "Host") && dimension.find("URL:") != std::string::npos;
+}
+
 void
 OperatorCookies::initialize(Parser &p)
 {
@@ -70,3 +98,9 @@ OperatorCookies::initialize(Parser &p)
   require_resources(RSRC_SERVER_REQUEST_HEADERS);
   require_resources(RSRC_CLIENT_REQUEST_HEADERS);
 }
+
+bool
+OperatorCookies::changes(const std::string &dimension) const
+{
+  return is_header_dimension(dimension, "Cookie");
+}
@@ -51,14 +51,34 @@ public:
   do_exec(const Resources &res) const
   {
     exec(res);
+    // The next operator may read a header this one changed
+    res.flush_header_cache();
     if (nullptr != _next) {
       static_cast<Operator *>(_next)->do_exec(res);
     }
   }
 
+  // Whether running this, or any of the following operators, can change the value of what the
+  // conditions of an index dimension test, see RuleIndex.
+  bool
+  do_changes(const std::string &dimension) const
+  {
+    if (changes(dimension)) {
+      return true;
+    }
+    return (nullptr != _next) && static_cast<Operator *>(_next)->do_changes(dimension);
+  }
+
 protected:
   virtual void exec(const Resources &res) const = 0;
 
+  // Most operators don't change anything the conditions test
+  virtual bool
+  changes(const std::string & /* dimension ATS_UNUSED */) const
+  {
+    return false;
+  }
+
 private:
   DISALLOW_COPY_AND_ASSIGN(Operator);
 
@@ -76,6 +96,8 @@ public:
   void initialize(Parser &p) override;
 
 protected:
+  bool changes(const std::string &dimension) const override;
+
   std::string _header;
 
 private:
@@ -93,6 +115,8 @@ public:
   void initialize(Parser &p) override;
 
 protected:
+  bool changes(const std::string &dimension) const override;
+
   std::string _cookie;
 
 private:
@@ -96,6 +96,11 @@ public:
 
 protected:
   void exec(const Resources &res) const override;
+  bool
+  changes(const std::string & /* dimension ATS_UNUSED */) const override
+  {
+    return true;
+  }
 
 private:
   DISALLOW_COPY_AND_ASSIGN(OperatorSetDestination);
@@ -123,6 +128,11 @@ public:
 
 protected:
   void exec(const Resources &res) const override;
+  bool
+  changes(const std::string & /* dimension ATS_UNUSED */) const override
+  {
+    return true;
+  }
 
 private:
   DISALLOW_COPY_AND_ASSIGN(OperatorSetRedirect);
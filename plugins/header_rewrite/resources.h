@@ -22,6 +22,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "ts/ts.h"
 #include "ts/remap.h"
@@ -86,6 +87,32 @@ public:
     return _ready;
   }
 
+  // The header values looked up by the conditions are kept until an operator runs, such that
+  // the many rules testing the same header only look it up once.
+  bool
+  cached_header(bool client, const std::string &name, std::string &value) const
+  {
+    for (auto const &h : _header_cache) {
+      if (h.client == client && h.name == name) {
+        value = h.value;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void
+  cache_header(bool client, const std::string &name, const std::string &value) const
+  {
+    _header_cache.push_back({client, name, value});
+  }
+
+  void
+  flush_header_cache() const
+  {
+    _header_cache.clear();
+  }
+
   TSHttpTxn txnp;
   TSCont contp;
   TSMBuffer bufp;
@@ -100,5 +127,12 @@ private:
   void destroy();
   DISALLOW_COPY_AND_ASSIGN(Resources);
 
+  struct CachedHeader {
+    bool client;
+    std::string name;
+    std::string value;
+  };
+
   bool _ready;
+  mutable std::vector<CachedHeader> _header_cache;
 };
@@ -0,0 +1,180 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+//////////////////////////////////////////////////////////////////////////////////////////////
+// ruleindex.cc: implementation of the rule index
+//
+//
+#include <algorithm>
+#include <string>
+
+#include "ruleindex.h"
+
+void
+RuleIndex::build(const RuleSet *rules)
+{
+  struct Entry {
+    int dim;
+    std::string key;
+    bool prefix;
+  };
+
+  std::vector<Entry> entries;
+  std::vector<Dimension> dims;
+  std::vector<int> counts;
+
+  _first = rules;
+  _rules.clear();
+  _changes.clear();
+  _unindexed.clear();
+  _dims.clear();
+
+  for (const RuleSet *rule = rules; rule; rule = rule->next) {
+    Entry e = {-1, "", false};
+    std::string dimension;
+    Condition *c = rule->index_condition(dimension, e.key, e.prefix);
+
+    if (c) {
+      for (e.dim = 0; e.dim < static_cast<int>(dims.size()) && dims[e.dim].name != dimension; ++e.dim) {
+      }
+      if (e.dim == static_cast<int>(dims.size())) {
+        dims.emplace_back();
+        dims.back().name = dimension;
+        dims.back().cond = c;
+        counts.push_back(0);
+      }
+      ++counts[e.dim];
+    }
+    _rules.push_back(rule);
+    entries.push_back(e);
+  }
+
+  // A dimension of a single rule saves nothing over evaluating that rule
+  std::vector<int> renumber(dims.size(), -1);
+
+  for (size_t d = 0; d < dims.size(); ++d) {
+    if (counts[d] > 1) {
+      renumber[d] = _dims.size();
+      _dims.push_back(std::move(dims[d]));
+    }
+  }
+
+  if (_dims.empty()) {
+    TSDebug(PLUGIN_NAME, "No rules to index, of %zu rules", _rules.size());
+    _rules.clear();
+    return;
+  }
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    Entry &e = entries[i];
+
+    if (e.dim < 0 || renumber[e.dim] < 0) {
+      _unindexed.push_back(i);
+    } else {
+      Dimension &dim = _dims[renumber[e.dim]];
+
+      if (e.prefix) {
+        dim.prefixes[e.key].push_back(i);
+        dim.prefix_lengths.push_back(e.key.size());
+      } else {
+        dim.exact[e.key].push_back(i);
+      }
+    }
+
+    bool changes = false;
+
+    for (auto const &dim : _dims) {
+      changes = changes || _rules[i]->changes(dim.name);
+    }
+    _changes.push_back(changes);
+  }
+
+  for (auto &dim : _dims) {
+    std::sort(dim.prefix_lengths.begin(), dim.prefix_lengths.end());
+    dim.prefix_lengths.erase(std::unique(dim.prefix_lengths.begin(), dim.prefix_lengths.end()), dim.prefix_lengths.end());
+    TSDebug(PLUGIN_NAME, "Indexed rules on %s, %zu values and %zu prefixes", dim.name.c_str(), dim.exact.size(),
+            dim.prefixes.size());
+  }
+  TSDebug(PLUGIN_NAME, "%zu of %zu rules are not indexed", _unindexed.size(), _rules.size());
+}
+
+void
+RuleIndex::run(const Resources &res) const
+{
+  if (_dims.empty()) {
+    run_from(_first, res);
+    return;
+  }
+
+  std::vector<int> candidates(_unindexed);
+  std::string value;
+
+  for (auto const &dim : _dims) {
+    KeyMap::const_iterator it;
+
+    value.clear();
+    dim.cond->append_value(value, res);
+
+    if ((it = dim.exact.find(value)) != dim.exact.end()) {
+      candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    }
+    for (auto len : dim.prefix_lengths) {
+      if (len > value.size()) {
+        break;
+      }
+      if ((it = dim.prefixes.find(value.substr(0, len))) != dim.prefixes.end()) {
+        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+
+  // Back to the order of the configuration
+  std::sort(candidates.begin(), candidates.end());
+
+  for (int i : candidates) {
+    const RuleSet *rule = _rules[i];
+
+    if (rule->eval(res)) {
+      OperModifiers rt = rule->exec(res);
+
+      if (rule->last() || (rt & OPER_LAST)) {
+        return; // Conditional break, force a break with [L]
+      }
+      if (_changes[i]) {
+        // The values looked up above may be stale now
+        TSDebug(PLUGIN_NAME, "Rule %d changed an indexed value, evaluating the rest of the rules", i);
+        run_from(rule->next, res);
+        return;
+      }
+    }
+  }
+}
+
+void
+RuleIndex::run_from(const RuleSet *rule, const Resources &res)
+{
+  while (rule) {
+    if (rule->eval(res)) {
+      OperModifiers rt = rule->exec(res);
+
+      if (rule->last() || (rt & OPER_LAST)) {
+        break; // Conditional break, force a break with [L]
+      }
+    }
+    rule = rule->next;
+  }
+}
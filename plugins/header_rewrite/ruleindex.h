@@ -0,0 +1,73 @@
+/*
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Index of the rulesets of a hook, such that large configurations don't have to evaluate
+// every rule for every transaction.
+//
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ruleset.h"
+#include "resources.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Rules that can't match unless a condition matches a literal value (or a
+// literal prefix) of what it tests are indexed on it, e.g. all the rules with
+// a %{CLIENT-HEADER:Host} =... condition share a dimension, and all that takes
+// to find the ones that can match for a transaction is to look up the Host
+// header once. The other rules are always evaluated. The rules are still run
+// in the order of the configuration, and once a rule runs an operator that
+// may change what a dimension tests, the rest of the rules are evaluated one
+// by one, like without an index.
+//
+class RuleIndex
+{
+public:
+  RuleIndex() { TSDebug(PLUGIN_NAME_DBG, "RuleIndex CTOR"); }
+
+  // (Re-)Index the rules of a hook, from the first ruleset of its list
+  void build(const RuleSet *rules);
+
+  // Evaluate the rules, and run the operators of those that match
+  void run(const Resources &res) const;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(RuleIndex);
+
+  typedef std::unordered_map<std::string, std::vector<int>> KeyMap;
+
+  struct Dimension {
+    std::string name;
+    Condition *cond = nullptr; // One of the indexed conditions, to get the value from
+    KeyMap exact;
+    KeyMap prefixes;
+    std::vector<std::string::size_type> prefix_lengths; // The distinct lengths of the prefixes, ascending
+  };
+
+  static void run_from(const RuleSet *rule, const Resources &res);
+
+  const RuleSet *_first = nullptr;
+  std::vector<const RuleSet *> _rules; // By position in the configuration
+  std::vector<bool> _changes;          // Running the operators of this rule may change what a dimension tests
+  std::vector<int> _unindexed;
+  std::vector<Dimension> _dims;
+};
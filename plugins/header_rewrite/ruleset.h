@@ -114,6 +114,23 @@ public:
     return _opermods;
   }
 
+  // Rule index support, see RuleIndex
+  Condition *
+  index_condition(std::string &dimension, std::string &key, bool &prefix) const
+  {
+    if (nullptr == _cond) {
+      return nullptr;
+    } else {
+      return _cond->find_index_condition(dimension, key, prefix);
+    }
+  }
+
+  bool
+  changes(const std::string &dimension) const
+  {
+    return _oper->do_changes(dimension);
+  }
+
   RuleSet *next; // Linked list
 
 private:
@@ -46,6 +46,7 @@
 #define OVECTOR_SIZE 30
 #define LOG_ROLL_INTERVAL 86400
 #define LOG_ROLL_OFFSET 0
+#define MATCHER_GROUP_SIZE 64
 
 static inline void *
 ts_malloc(size_t s)
@@ -65,11 +66,43 @@ typedef struct invalidate_t {
   pcre_extra *regex_extra;
   time_t epoch;
   time_t expiry;
+  int refcount;
   struct invalidate_t *next;
 } invalidate_t;
 
+// A rule as seen by the matcher. The epoch and expiry are copied, since the rule list
+// is updated in place by the config handler.
+typedef struct {
+  invalidate_t *rule;
+  time_t epoch;
+  time_t expiry;
+} matcher_rule_t;
+
+// A group of up to MATCHER_GROUP_SIZE rules with consecutive epochs, compiled into one
+// alternation. The combined regex is only used when every rule in the group applies.
+typedef struct {
+  pcre *regex;
+  pcre_extra *regex_extra;
+  int first;
+  int count;
+  time_t min_epoch;
+  time_t max_epoch;
+  time_t min_expiry;
+} matcher_group_t;
+
+// An immutable snapshot of the rules, used by the cache lookup hook. Rules are sorted
+// by epoch, newest first, so that a cached object only needs to be checked against the
+// rules which were loaded after it was fetched.
+typedef struct {
+  matcher_rule_t *rules;
+  int num_rules;
+  matcher_group_t *groups;
+  int num_groups;
+} matcher_t;
+
 typedef struct {
   invalidate_t *invalidate_list;
+  matcher_t *matcher;
   char *config_file;
   time_t last_load;
   TSTextLogObject log;
@@ -83,42 +116,78 @@ init_invalidate_t(invalidate_t *i)
   i->regex_extra = NULL;
   i->epoch       = 0;
   i->expiry      = 0;
+  i->refcount    = 1;
   i->next        = NULL;
   return i;
 }
 
 static void
-free_invalidate_t(invalidate_t *i)
+free_regex(pcre *regex, pcre_extra *regex_extra)
 {
-  if (i->regex_extra) {
+  if (regex_extra) {
 #ifndef PCRE_STUDY_JIT_COMPILE
-    pcre_free(i->regex_extra);
+    pcre_free(regex_extra);
 #else
-    pcre_free_study(i->regex_extra);
+    pcre_free_study(regex_extra);
 #endif
   }
-  if (i->regex) {
-    pcre_free(i->regex);
+  if (regex) {
+    pcre_free(regex);
   }
+}
+
+static void
+free_invalidate_t(invalidate_t *i)
+{
+  free_regex(i->regex, i->regex_extra);
   if (i->regex_text) {
     pcre_free_substring(i->regex_text);
   }
   TSfree(i);
 }
 
+// Rules are shared between the config list and the matchers, drop one reference.
+static void
+release_invalidate_t(invalidate_t *i)
+{
+  if (__sync_sub_and_fetch(&i->refcount, 1) == 0) {
+    free_invalidate_t(i);
+  }
+}
+
 static void
 free_invalidate_t_list(invalidate_t *i)
 {
-  if (i->next) {
-    free_invalidate_t_list(i->next);
+  invalidate_t *next;
+
+  while (i) {
+    next = i->next;
+    release_invalidate_t(i);
+    i = next;
+  }
+}
+
+static void
+free_matcher_t(matcher_t *m)
+{
+  int n;
+
+  for (n = 0; n < m->num_groups; ++n) {
+    free_regex(m->groups[n].regex, m->groups[n].regex_extra);
+  }
+  for (n = 0; n < m->num_rules; ++n) {
+    release_invalidate_t(m->rules[n].rule);
   }
-  free_invalidate_t(i);
+  TSfree(m->groups);
+  TSfree(m->rules);
+  TSfree(m);
 }
 
 static plugin_state_t *
 init_plugin_state_t(plugin_state_t *pstate)
 {
   pstate->invalidate_list = NULL;
+  pstate->matcher         = NULL;
   pstate->config_file     = NULL;
   pstate->last_load       = 0;
   pstate->log             = NULL;
@@ -128,6 +197,9 @@ init_plugin_state_t(plugin_state_t *pstate)
 static void
 free_plugin_state_t(plugin_state_t *pstate)
 {
+  if (pstate->matcher) {
+    free_matcher_t(pstate->matcher);
+  }
   if (pstate->invalidate_list) {
     free_invalidate_t_list(pstate->invalidate_list);
   }
@@ -140,41 +212,115 @@ free_plugin_state_t(plugin_state_t *pstate)
   TSfree(pstate);
 }
 
-static invalidate_t *
-copy_invalidate_t(invalidate_t *i)
+static int
+compare_matcher_rule(const void *a, const void *b)
+{
+  const matcher_rule_t *ra = (const matcher_rule_t *)a;
+  const matcher_rule_t *rb = (const matcher_rule_t *)b;
+
+  // Newest first
+  return (ra->epoch < rb->epoch) - (ra->epoch > rb->epoch);
+}
+
+// Back references and recursion refer to group numbers, which are not stable once the
+// regex is embedded in an alternation. Such rules are always evaluated on their own.
+static bool
+is_combinable(const char *regex_text)
+{
+  const char *p;
+
+  for (p = regex_text; *p; ++p) {
+    if (p[0] == '\\' && p[1] != '\0') {
+      if ((p[1] >= '0' && p[1] <= '9') || p[1] == 'g' || p[1] == 'k') {
+        return false;
+      }
+      ++p;
+    } else if (p[0] == '(' && (p[1] == '*' || (p[1] == '?' && p[2] != '\0' && strchr("P&R|+-0123456789", p[2])))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void
+compile_matcher_group(matcher_t *m, matcher_group_t *g)
 {
-  invalidate_t *iptr;
   const char *errptr;
-  int erroffset;
-
-  iptr              = (invalidate_t *)TSmalloc(sizeof(invalidate_t));
-  iptr->regex_text  = TSstrdup(i->regex_text);
-  iptr->regex       = pcre_compile(iptr->regex_text, 0, &errptr, &erroffset, NULL); // There is no pcre_copy :-(
-  iptr->regex_extra = pcre_study(iptr->regex, 0, &errptr); // Assuming no errors since this worked before :-/
-  iptr->epoch       = i->epoch;
-  iptr->expiry      = i->expiry;
-  iptr->next        = NULL;
-  return iptr;
+  int erroffset, n;
+  size_t len = 1;
+  char *text, *tp;
+
+  for (n = g->first; n < g->first + g->count; ++n) {
+    if (!is_combinable(m->rules[n].rule->regex_text)) {
+      return;
+    }
+    len += strlen(m->rules[n].rule->regex_text) + 5; // "(?:" ")" "|"
+  }
+
+  text = tp = TSmalloc(len);
+  for (n = g->first; n < g->first + g->count; ++n) {
+    tp += sprintf(tp, "%s(?:%s)", n == g->first ? "" : "|", m->rules[n].rule->regex_text);
+  }
+
+  g->regex = pcre_compile(text, 0, &errptr, &erroffset, NULL);
+  if (g->regex) {
+    g->regex_extra = pcre_study(g->regex, 0, &errptr);
+  } else {
+    TSDebug(LOG_PREFIX, "Combined regex did not compile, evaluating %d rules separately", g->count);
+  }
+  TSfree(text);
 }
 
-static invalidate_t *
-copy_config(invalidate_t *old_list)
+// Build a new matcher snapshot from the rule list. This runs on the config thread.
+static matcher_t *
+build_matcher(invalidate_t *ilist)
 {
-  invalidate_t *new_list = NULL;
-  invalidate_t *iptr_old, *iptr_new;
-
-  if (old_list) {
-    new_list = copy_invalidate_t(old_list);
-    iptr_old = old_list->next;
-    iptr_new = new_list;
-    while (iptr_old) {
-      iptr_new->next = copy_invalidate_t(iptr_old);
-      iptr_new       = iptr_new->next;
-      iptr_old       = iptr_old->next;
+  matcher_t *m;
+  invalidate_t *iptr;
+  int n, count = 0;
+
+  for (iptr = ilist; iptr; iptr = iptr->next) {
+    ++count;
+  }
+
+  m             = (matcher_t *)TSmalloc(sizeof(matcher_t));
+  m->num_rules  = count;
+  m->rules      = count ? (matcher_rule_t *)TSmalloc(count * sizeof(matcher_rule_t)) : NULL;
+  m->num_groups = (count + MATCHER_GROUP_SIZE - 1) / MATCHER_GROUP_SIZE;
+  m->groups     = m->num_groups ? (matcher_group_t *)TSmalloc(m->num_groups * sizeof(matcher_group_t)) : NULL;
+
+  for (n = 0, iptr = ilist; iptr; iptr = iptr->next, ++n) {
+    __sync_add_and_fetch(&iptr->refcount, 1);
+    m->rules[n].rule   = iptr;
+    m->rules[n].epoch  = iptr->epoch;
+    m->rules[n].expiry = iptr->expiry;
+  }
+  if (count > 1) {
+    qsort(m->rules, count, sizeof(matcher_rule_t), compare_matcher_rule);
+  }
+
+  for (n = 0; n < m->num_groups; ++n) {
+    matcher_group_t *g = &m->groups[n];
+    int r;
+
+    g->regex       = NULL;
+    g->regex_extra = NULL;
+    g->first       = n * MATCHER_GROUP_SIZE;
+    g->count       = (count - g->first) < MATCHER_GROUP_SIZE ? (count - g->first) : MATCHER_GROUP_SIZE;
+    g->max_epoch   = m->rules[g->first].epoch;
+    g->min_epoch   = m->rules[g->first + g->count - 1].epoch;
+    g->min_expiry  = m->rules[g->first].expiry;
+    for (r = g->first + 1; r < g->first + g->count; ++r) {
+      if (m->rules[r].expiry < g->min_expiry) {
+        g->min_expiry = m->rules[r].expiry;
+      }
+    }
+    if (g->count > 1) {
+      compile_matcher_group(m, g);
     }
   }
 
-  return new_list;
+  return m;
 }
 
 static bool
@@ -194,11 +340,11 @@ prune_config(invalidate_t **i)
         TSDebug(LOG_PREFIX, "Removing %s expiry: %d now: %d", iptr->regex_text, (int)iptr->expiry, (int)now);
         if (ilast) {
           ilast->next = iptr->next;
-          free_invalidate_t(iptr);
+          release_invalidate_t(iptr);
           iptr = ilast->next;
         } else {
           *i = iptr->next;
-          free_invalidate_t(iptr);
+          release_invalidate_t(iptr);
           iptr = *i;
         }
         pruned = true;
@@ -333,21 +479,35 @@ list_config(plugin_state_t *pstate, invalidate_t *i)
 static int
 free_handler(TSCont cont, TSEvent event ATS_UNUSED, void *edata ATS_UNUSED)
 {
-  invalidate_t *iptr;
+  matcher_t *m;
 
   TSDebug(LOG_PREFIX, "Freeing old config");
-  iptr = (invalidate_t *)TSContDataGet(cont);
-  free_invalidate_t_list(iptr);
+  m = (matcher_t *)TSContDataGet(cont);
+  free_matcher_t(m);
   TSContDestroy(cont);
   return 0;
 }
 
+static void
+update_matcher(plugin_state_t *pstate)
+{
+  matcher_t *m, *old;
+  TSCont free_cont;
+
+  m   = build_matcher(pstate->invalidate_list);
+  old = __sync_val_compare_and_swap(&(pstate->matcher), pstate->matcher, m);
+
+  if (old) {
+    free_cont = TSContCreate(free_handler, TSMutexCreate());
+    TSContDataSet(free_cont, (void *)old);
+    TSContSchedule(free_cont, FREE_TMOUT, TS_THREAD_POOL_TASK);
+  }
+}
+
 static int
 config_handler(TSCont cont, TSEvent event ATS_UNUSED, void *edata ATS_UNUSED)
 {
   plugin_state_t *pstate;
-  invalidate_t *i, *iptr;
-  TSCont free_cont;
   bool updated;
   TSMutex mutex;
 
@@ -356,25 +516,16 @@ config_handler(TSCont cont, TSEvent event ATS_UNUSED, void *edata ATS_UNUSED)
 
   TSDebug(LOG_PREFIX, "In config Handler");
   pstate = (plugin_state_t *)TSContDataGet(cont);
-  i      = copy_config(pstate->invalidate_list);
 
-  updated = prune_config(&i);
-  updated = load_config(pstate, &i) || updated;
+  // The rule list is only used by this handler, the lookup hook sees the matcher snapshot.
+  updated = prune_config(&pstate->invalidate_list);
+  updated = load_config(pstate, &pstate->invalidate_list) || updated;
 
   if (updated) {
-    list_config(pstate, i);
-    iptr = __sync_val_compare_and_swap(&(pstate->invalidate_list), pstate->invalidate_list, i);
-
-    if (iptr) {
-      free_cont = TSContCreate(free_handler, TSMutexCreate());
-      TSContDataSet(free_cont, (void *)iptr);
-      TSContSchedule(free_cont, FREE_TMOUT, TS_THREAD_POOL_TASK);
-    }
+    list_config(pstate, pstate->invalidate_list);
+    update_matcher(pstate);
   } else {
     TSDebug(LOG_PREFIX, "No Changes");
-    if (i) {
-      free_invalidate_t_list(i);
-    }
   }
 
   TSMutexUnlock(mutex);
@@ -402,46 +553,71 @@ get_date_from_cached_hdr(TSHttpTxn txn)
   return date;
 }
 
+// Check the URL against all rules which were loaded at or after the object's date and
+// have not yet expired.
+static bool
+matcher_match(const matcher_t *m, TSHttpTxn txn, time_t date, time_t now)
+{
+  const matcher_group_t *g;
+  const matcher_rule_t *r;
+  char *url   = NULL;
+  int url_len = 0;
+  bool match  = false;
+  int n, i;
+
+  for (n = 0; n < m->num_groups && !match; ++n) {
+    g = &m->groups[n];
+    if (difftime(g->max_epoch, date) < 0) {
+      break; // This and all following rules are older than the object
+    }
+    if (!url) {
+      url = TSHttpTxnEffectiveUrlStringGet(txn, &url_len);
+      if (!url) {
+        break;
+      }
+    }
+    if (g->regex && difftime(g->min_epoch, date) >= 0 && difftime(g->min_expiry, now) >= 0) {
+      match = pcre_exec(g->regex, g->regex_extra, url, url_len, 0, 0, NULL, 0) >= 0;
+    } else {
+      for (i = g->first; i < g->first + g->count && !match; ++i) {
+        r = &m->rules[i];
+        if ((difftime(r->epoch, date) >= 0) && (difftime(r->expiry, now) >= 0)) {
+          match = pcre_exec(r->rule->regex, r->rule->regex_extra, url, url_len, 0, 0, NULL, 0) >= 0;
+        }
+      }
+    }
+  }
+
+  if (match) {
+    TSDebug(LOG_PREFIX, "Forced revalidate - %.*s", url_len, url);
+  }
+  if (url) {
+    TSfree(url);
+  }
+  return match;
+}
+
 static int
 main_handler(TSCont cont, TSEvent event, void *edata)
 {
   TSHttpTxn txn = (TSHttpTxn)edata;
   int status;
-  invalidate_t *iptr;
   plugin_state_t *pstate;
-
-  time_t date = 0, now = 0;
-  char *url   = NULL;
-  int url_len = 0;
+  matcher_t *m;
+  time_t date;
 
   switch (event) {
   case TS_EVENT_HTTP_CACHE_LOOKUP_COMPLETE:
     if (TSHttpTxnCacheLookupStatusGet(txn, &status) == TS_SUCCESS) {
       if (status == TS_CACHE_LOOKUP_HIT_FRESH) {
         pstate = (plugin_state_t *)TSContDataGet(cont);
-        iptr   = pstate->invalidate_list;
-        while (iptr) {
-          if (!date) {
-            date = get_date_from_cached_hdr(txn);
-            now  = time(NULL);
-          }
-          if ((difftime(iptr->epoch, date) >= 0) && (difftime(iptr->expiry, now) >= 0)) {
-            if (!url) {
-              url = TSHttpTxnEffectiveUrlStringGet(txn, &url_len);
-            }
-            if (pcre_exec(iptr->regex, iptr->regex_extra, url, url_len, 0, 0, NULL, 0) >= 0) {
-              TSHttpTxnCacheLookupStatusSet(txn, TS_CACHE_LOOKUP_HIT_STALE);
-              iptr = NULL;
-              TSDebug(LOG_PREFIX, "Forced revalidate - %.*s", url_len, url);
-            }
-          }
-          if (iptr) {
-            iptr = iptr->next;
+        m      = pstate->matcher;
+        if (m && m->num_groups > 0) {
+          date = get_date_from_cached_hdr(txn);
+          if (difftime(m->groups[0].max_epoch, date) >= 0 && matcher_match(m, txn, date, time(NULL))) {
+            TSHttpTxnCacheLookupStatusSet(txn, TS_CACHE_LOOKUP_HIT_STALE);
           }
         }
-        if (url) {
-          TSfree(url);
-        }
       }
     }
     break;
@@ -527,6 +703,7 @@ TSPluginInit(int argc, const char *argv[])
   } else {
     pstate->invalidate_list = iptr;
     list_config(pstate, iptr);
+    pstate->matcher = build_matcher(iptr);
   }
 
   info.plugin_name   = LOG_PREFIX;
@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <ctype.h>
@@ -33,6 +34,8 @@
 #include <string.h>
 #include <inttypes.h>
 #include <getopt.h>
+#include <zlib.h>
+#include <ts/experimental.h>
 
 #include "tscore/ink_defs.h"
 
@@ -45,6 +48,48 @@ static int url_path_len;
 static bool integer_counters = false;
 static bool wrap_counters    = false;
 
+/* output formats, picked by the Accept header of the request */
+typedef enum { FORMAT_JSON, FORMAT_OPENMETRICS, FORMAT_COUNT } output_format;
+
+/* a growing buffer, reused across renders */
+typedef struct render_buf_t {
+  char *data;
+  size_t len;
+  size_t cap;
+} render_buf;
+
+/* The last rendered output of a format, shared by all requests. The output is rendered by a task
+   thread, which swaps it in, so that the net threads never wait for a render. */
+typedef struct render_cache_t {
+  TSMutex mutex; /* held only to look at or to swap the output */
+  render_buf plain;
+  render_buf gzip;
+  TSHRTime rendered_at; /* when the render of the output started */
+  bool gzip_valid;
+  bool gzip_tried;  /* the output was compressed, or failed to */
+  bool gzip_wanted; /* a client accepted gzip, compress the next renders */
+  bool rendering;   /* a render is scheduled or running */
+  struct stats_state_t *waiters; /* requests to wake up when the render is done */
+
+  /* only used by the render task */
+  TSCont task;
+  render_buf next_plain;
+  render_buf next_gzip;
+} render_cache;
+
+static render_cache caches[FORMAT_COUNT];
+
+/* how long a rendered output may be served again, 0 renders for every request */
+static TSHRTime render_cache_time = 0;
+
+/* how soon a request tries again if the render cache is busy */
+#define RENDER_WAIT_MSEC 5
+/* how long a request waits for a render before it gives up */
+#define RENDER_TIMEOUT_MSEC 10000
+
+/* what became of a request looking for its output */
+typedef enum { RESPONSE_WRITTEN, RESPONSE_WAITING, RESPONSE_BUSY } response_status;
+
 typedef struct stats_state_t {
   TSVConn net_vc;
   TSVIO read_vio;
@@ -55,7 +100,18 @@ typedef struct stats_state_t {
   TSIOBufferReader resp_reader;
 
   int output_bytes;
-  int body_written;
+  output_format format;
+  bool gzip;
+  bool responding;       /* the request was read */
+  TSHRTime requested_at; /* when the request was read, the output must be rendered no earlier than this */
+
+  TSCont contp;
+  TSAction timer; /* try again if the render cache was busy, or give up waiting for the render */
+  bool closed;    /* the client left, clean up once the render cache isn't busy */
+
+  /* guarded by the mutex of the render cache */
+  struct stats_state_t *next_waiter;
+  bool waiting; /* in the waiters of the render cache */
 } stats_state;
 
 static void
@@ -84,65 +140,56 @@ stats_process_accept(TSCont contp, stats_state *my_state)
   my_state->read_vio    = TSVConnRead(my_state->net_vc, contp, my_state->req_buffer, INT64_MAX);
 }
 
-static int
-stats_add_data_to_resp_buffer(const char *s, stats_state *my_state)
+static void
+render_append(render_buf *buf, const char *s, size_t len)
 {
-  int s_len = strlen(s);
-
-  TSIOBufferWrite(my_state->resp_buffer, s, s_len);
-
-  return s_len;
+  if (buf->len + len > buf->cap) {
+    buf->cap = buf->cap ? buf->cap : 65536;
+    while (buf->len + len > buf->cap) {
+      buf->cap *= 2;
+    }
+    buf->data = TSrealloc(buf->data, buf->cap);
+  }
+  memcpy(buf->data + buf->len, s, len);
+  buf->len += len;
 }
 
-static const char RESP_HEADER[] = "HTTP/1.0 200 Ok\r\nContent-Type: text/javascript\r\nCache-Control: no-cache\r\n\r\n";
-
-static int
-stats_add_resp_header(stats_state *my_state)
-{
-  return stats_add_data_to_resp_buffer(RESP_HEADER, my_state);
-}
+static void
+render_printf(render_buf *buf, const char *fmt, ...) TS_PRINTFLIKE(2, 3);
 
 static void
-stats_process_read(TSCont contp, TSEvent event, stats_state *my_state)
+render_printf(render_buf *buf, const char *fmt, ...)
 {
-  TSDebug(PLUGIN_NAME, "stats_process_read(%d)", event);
-  if (event == TS_EVENT_VCONN_READ_READY) {
-    my_state->output_bytes = stats_add_resp_header(my_state);
-    TSVConnShutdown(my_state->net_vc, 1, 0);
-    my_state->write_vio = TSVConnWrite(my_state->net_vc, contp, my_state->resp_reader, INT64_MAX);
-  } else if (event == TS_EVENT_ERROR) {
-    TSError("[%s] stats_process_read: Received TS_EVENT_ERROR", PLUGIN_NAME);
-  } else if (event == TS_EVENT_VCONN_EOS) {
-    /* client may end the connection, simply return */
-    return;
-  } else if (event == TS_EVENT_NET_ACCEPT_FAILED) {
-    TSError("[%s] stats_process_read: Received TS_EVENT_NET_ACCEPT_FAILED", PLUGIN_NAME);
-  } else {
-    printf("Unexpected Event %d\n", event);
-    TSReleaseAssert(!"Unexpected Event");
+  char b[256];
+  int len;
+  va_list args;
+
+  va_start(args, fmt);
+  len = vsnprintf(b, sizeof(b), fmt, args);
+  va_end(args);
+  if (len > 0 && len < (int)sizeof(b)) {
+    render_append(buf, b, len);
   }
 }
 
-#define APPEND(a) my_state->output_bytes += stats_add_data_to_resp_buffer(a, my_state)
-#define APPEND_STAT(a, fmt, v)                                                   \
-  do {                                                                           \
-    char b[256];                                                                 \
-    if (snprintf(b, sizeof(b), "\"%s\": \"" fmt "\",\n", a, v) < (int)sizeof(b)) \
-      APPEND(b);                                                                 \
-  } while (0)
-#define APPEND_STAT_NUMERIC(a, fmt, v)                                               \
-  do {                                                                               \
-    char b[256];                                                                     \
-    if (integer_counters) {                                                          \
-      if (snprintf(b, sizeof(b), "\"%s\": " fmt ",\n", a, v) < (int)sizeof(b)) {     \
-        APPEND(b);                                                                   \
-      }                                                                              \
-    } else {                                                                         \
-      if (snprintf(b, sizeof(b), "\"%s\": \"" fmt "\",\n", a, v) < (int)sizeof(b)) { \
-        APPEND(b);                                                                   \
-      }                                                                              \
-    }                                                                                \
-  } while (0)
+static const char *const CONTENT_TYPES[FORMAT_COUNT] = {
+  "text/javascript",
+  "application/openmetrics-text; version=1.0.0; charset=utf-8",
+};
+
+static int
+stats_add_resp_header(stats_state *my_state, int64_t body_len)
+{
+  char b[512];
+  int len;
+
+  len = snprintf(b, sizeof(b),
+                 "HTTP/1.0 200 Ok\r\nContent-Type: %s\r\nCache-Control: no-cache\r\n%sVary: Accept, Accept-Encoding\r\n"
+                 "Content-Length: %" PRId64 "\r\n\r\n",
+                 CONTENT_TYPES[my_state->format], my_state->gzip ? "Content-Encoding: gzip\r\n" : "", body_len);
+  TSIOBufferWrite(my_state->resp_buffer, b, len);
+  return len;
+}
 
 // This wraps uint64_t values to the int64_t range to fit into a Java long. Java 8 has an unsigned long which
 // can interoperate with a full uint64_t, but it's unlikely that much of the ecosystem supports that yet.
@@ -156,11 +203,22 @@ wrap_unsigned_counter(uint64_t value)
   }
 }
 
+#define APPEND(a) render_append(buf, a, strlen(a))
+#define APPEND_STAT(a, fmt, v) render_printf(buf, "\"%s\": \"" fmt "\",\n", a, v)
+#define APPEND_STAT_NUMERIC(a, fmt, v)                    \
+  do {                                                    \
+    if (integer_counters) {                               \
+      render_printf(buf, "\"%s\": " fmt ",\n", a, v);     \
+    } else {                                              \
+      render_printf(buf, "\"%s\": \"" fmt "\",\n", a, v); \
+    }                                                     \
+  } while (0)
+
 static void
 json_out_stat(TSRecordType rec_type ATS_UNUSED, void *edata, int registered ATS_UNUSED, const char *name,
               TSRecordDataType data_type, TSRecordData *datum)
 {
-  stats_state *my_state = edata;
+  render_buf *buf = edata;
 
   switch (data_type) {
   case TS_RECORDDATATYPE_COUNTER:
@@ -181,12 +239,12 @@ json_out_stat(TSRecordType rec_type ATS_UNUSED, void *edata, int registered ATS_
   }
 }
 static void
-json_out_stats(stats_state *my_state)
+json_out_stats(render_buf *buf)
 {
   const char *version;
   APPEND("{ \"global\": {\n");
 
-  TSRecordDump((TSRecordType)(TS_RECORDTYPE_PLUGIN | TS_RECORDTYPE_NODE | TS_RECORDTYPE_PROCESS), json_out_stat, my_state);
+  TSRecordDump((TSRecordType)(TS_RECORDTYPE_PLUGIN | TS_RECORDTYPE_NODE | TS_RECORDTYPE_PROCESS), json_out_stat, buf);
   version = TSTrafficServerVersionGet();
   APPEND("\"server\": \"");
   APPEND(version);
@@ -194,16 +252,492 @@ json_out_stats(stats_state *my_state)
   APPEND("  }\n}\n");
 }
 
+/* OpenMetrics output. Stats which only differ by a volume, host etc. in the middle of their name are
+   exported as one metric family with that part as a label, e.g. proxy.process.cache.volume_1.bytes_used
+   becomes proxy_process_cache_bytes_used{volume="1"}. */
+
+typedef enum { LABEL_TO_DOT, LABEL_TO_LAST_DOT, LABEL_TO_END } label_extent;
+
+typedef struct label_rule_t {
+  const char *prefix;  /* stats starting with this ... */
+  const char *base;    /* ... are named base + the rest of the name after the label value */
+  const char *label;   /* name of the label */
+  label_extent extent; /* where the label value ends */
+} label_rule;
+
+static const label_rule LABEL_RULES[] = {
+  {"proxy.process.cache.volume_", "proxy.process.cache", "volume", LABEL_TO_DOT},
+  {"plugin.remap_stats.", "plugin.remap_stats", "host", LABEL_TO_LAST_DOT},
+  {"proxy.process.ssl.cipher.user_agent.", "proxy.process.ssl.cipher.user_agent", "cipher", LABEL_TO_END},
+};
+
+typedef struct om_sample_t {
+  size_t family; /* offset of the family name in the pool */
+  size_t labels; /* offset of the labels in the pool, may be empty */
+  int index;     /* order of the stat in the dump */
+  TSRecordDataType data_type;
+  int64_t int_value;
+  float float_value;
+} om_sample;
+
+/* Scratch space of the OpenMetrics render, only used by its render task. */
+typedef struct om_state_t {
+  render_buf pool;
+  om_sample *samples;
+  size_t count;
+  size_t cap;
+} om_state;
+
+static om_state om;
+
+static const char *om_sort_pool;
+
+static size_t
+om_sanitize(char *dst, size_t dst_len, const char *src, size_t src_len)
+{
+  size_t n = 0;
+
+  if (src_len > 0 && isdigit((unsigned char)src[0]) && n + 1 < dst_len) {
+    dst[n++] = '_';
+  }
+  for (size_t i = 0; i < src_len && n + 1 < dst_len; ++i) {
+    char c   = src[i];
+    dst[n++] = (isalnum((unsigned char)c) || c == '_' || c == ':') ? c : '_';
+  }
+  dst[n] = '\0';
+  return n;
+}
+
+static void
+om_append_label(render_buf *pool, const char *label, const char *value, size_t value_len)
+{
+  render_append(pool, label, strlen(label));
+  render_append(pool, "=\"", 2);
+  for (size_t i = 0; i < value_len; ++i) {
+    switch (value[i]) {
+    case '\\':
+      render_append(pool, "\\\\", 2);
+      break;
+    case '"':
+      render_append(pool, "\\\"", 2);
+      break;
+    case '\n':
+      render_append(pool, "\\n", 2);
+      break;
+    default:
+      render_append(pool, value + i, 1);
+      break;
+    }
+  }
+  render_append(pool, "\"", 1);
+}
+
+static void
+om_out_stat(TSRecordType rec_type ATS_UNUSED, void *edata, int registered ATS_UNUSED, const char *name,
+            TSRecordDataType data_type, TSRecordData *datum)
+{
+  om_state *state        = edata;
+  const char *value      = NULL;
+  const char *rest       = NULL;
+  const label_rule *rule = NULL;
+  char raw[256], family[256];
+  om_sample *sample;
+
+  if (data_type != TS_RECORDDATATYPE_COUNTER && data_type != TS_RECORDDATATYPE_INT && data_type != TS_RECORDDATATYPE_FLOAT &&
+      data_type != TS_RECORDDATATYPE_STRING) {
+    return;
+  }
+
+  for (size_t i = 0; i < countof(LABEL_RULES) && rule == NULL; ++i) {
+    size_t prefix_len = strlen(LABEL_RULES[i].prefix);
+    if (strncmp(name, LABEL_RULES[i].prefix, prefix_len) != 0) {
+      continue;
+    }
+    value = name + prefix_len;
+    switch (LABEL_RULES[i].extent) {
+    case LABEL_TO_DOT:
+      rest = strchr(value, '.');
+      break;
+    case LABEL_TO_LAST_DOT:
+      rest = strrchr(value, '.');
+      break;
+    case LABEL_TO_END:
+      rest = value + strlen(value);
+      break;
+    }
+    if (rest != NULL && rest > value) {
+      rule = &LABEL_RULES[i];
+    }
+  }
+
+  if (rule) {
+    snprintf(raw, sizeof(raw), "%s%s", rule->base, rest);
+  } else {
+    snprintf(raw, sizeof(raw), "%s", name);
+  }
+  size_t family_len = om_sanitize(family, sizeof(family), raw, strlen(raw));
+  /* the _total suffix is added to the sample, it is not part of the family name */
+  if (data_type == TS_RECORDDATATYPE_COUNTER && family_len > 6 && strcmp(family + family_len - 6, "_total") == 0) {
+    family[family_len - 6] = '\0';
+  }
+
+  if (state->count == state->cap) {
+    state->cap     = state->cap ? state->cap * 2 : 4096;
+    state->samples = TSrealloc(state->samples, state->cap * sizeof(om_sample));
+  }
+  sample            = &state->samples[state->count];
+  sample->index     = state->count++;
+  sample->data_type = data_type;
+
+  sample->family = state->pool.len;
+  render_append(&state->pool, family, strlen(family) + 1);
+
+  sample->labels = state->pool.len;
+  if (rule) {
+    om_append_label(&state->pool, rule->label, value, rest - value);
+  }
+  switch (data_type) {
+  case TS_RECORDDATATYPE_COUNTER:
+    sample->int_value = datum->rec_counter;
+    break;
+  case TS_RECORDDATATYPE_INT:
+    sample->int_value = datum->rec_int;
+    break;
+  case TS_RECORDDATATYPE_FLOAT:
+    sample->float_value = datum->rec_float;
+    break;
+  default:
+    /* strings are exported as an info metric with the string as a label */
+    if (rule) {
+      render_append(&state->pool, ",", 1);
+    }
+    om_append_label(&state->pool, "value", datum->rec_string ? datum->rec_string : "",
+                    datum->rec_string ? strlen(datum->rec_string) : 0);
+    break;
+  }
+  render_append(&state->pool, "", 1);
+}
+
+static int
+om_sample_cmp(const void *a, const void *b)
+{
+  const om_sample *sa = a;
+  const om_sample *sb = b;
+  int c               = strcmp(om_sort_pool + sa->family, om_sort_pool + sb->family);
+
+  return c != 0 ? c : sa->index - sb->index;
+}
+
+static bool
+om_is_gauge(TSRecordDataType data_type)
+{
+  return data_type == TS_RECORDDATATYPE_INT || data_type == TS_RECORDDATATYPE_FLOAT;
+}
+
+/* The type of the family of the samples from @a first on, and the suffix of the names of all of its
+   samples. A family of stats of different types, which can only come from labels, is of unknown type. */
+static void
+om_type_family(size_t first, const char **type, const char **suffix)
+{
+  TSRecordDataType data_type = om.samples[first].data_type;
+  const char *family         = om.pool.data + om.samples[first].family;
+
+  for (size_t i = first + 1; i < om.count && strcmp(family, om.pool.data + om.samples[i].family) == 0; ++i) {
+    TSRecordDataType t = om.samples[i].data_type;
+
+    if (t != data_type && !(om_is_gauge(t) && om_is_gauge(data_type))) {
+      *type   = "unknown";
+      *suffix = "";
+      return;
+    }
+  }
+
+  switch (data_type) {
+  case TS_RECORDDATATYPE_COUNTER:
+    *type   = "counter";
+    *suffix = "_total";
+    break;
+  case TS_RECORDDATATYPE_STRING:
+    *type   = "info";
+    *suffix = "_info";
+    break;
+  default:
+    *type   = "gauge";
+    *suffix = "";
+    break;
+  }
+}
+
+static void
+openmetrics_out_stats(render_buf *buf)
+{
+  const char *prev   = NULL;
+  const char *type   = NULL;
+  const char *suffix = NULL;
+
+  om.pool.len = 0;
+  om.count    = 0;
+  TSRecordDump((TSRecordType)(TS_RECORDTYPE_PLUGIN | TS_RECORDTYPE_NODE | TS_RECORDTYPE_PROCESS), om_out_stat, &om);
+
+  /* all samples of a family have to be next to each other */
+  om_sort_pool = om.pool.data;
+  qsort(om.samples, om.count, sizeof(om_sample), om_sample_cmp);
+
+  for (size_t i = 0; i < om.count; ++i) {
+    const om_sample *sample = &om.samples[i];
+    const char *family      = om.pool.data + sample->family;
+    const char *labels      = om.pool.data + sample->labels;
+
+    if (prev == NULL || strcmp(prev, family) != 0) {
+      om_type_family(i, &type, &suffix);
+      render_printf(buf, "# TYPE %s %s\n", family, type);
+      prev = family;
+    }
+    render_append(buf, family, strlen(family));
+    render_append(buf, suffix, strlen(suffix));
+    if (*labels) {
+      render_append(buf, "{", 1);
+      render_append(buf, labels, strlen(labels));
+      render_append(buf, "}", 1);
+    }
+    switch (sample->data_type) {
+    case TS_RECORDDATATYPE_COUNTER:
+    case TS_RECORDDATATYPE_INT:
+      render_printf(buf, " %" PRId64 "\n", sample->int_value);
+      break;
+    case TS_RECORDDATATYPE_FLOAT:
+      render_printf(buf, " %f\n", sample->float_value);
+      break;
+    default:
+      render_append(buf, " 1\n", 3);
+      break;
+    }
+  }
+  APPEND("# EOF\n");
+}
+
+static bool
+gzip_render(const render_buf *in, render_buf *out)
+{
+  z_stream z;
+  uLong bound;
+  int rc;
+
+  memset(&z, 0, sizeof(z));
+  /* favour speed, the stats compress well anyway */
+  if (deflateInit2(&z, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  bound    = deflateBound(&z, in->len);
+  out->len = 0;
+  if (out->cap < bound) {
+    out->cap  = bound;
+    out->data = TSrealloc(out->data, out->cap);
+  }
+
+  z.next_in   = (Bytef *)in->data;
+  z.avail_in  = in->len;
+  z.next_out  = (Bytef *)out->data;
+  z.avail_out = out->cap;
+  rc          = deflate(&z, Z_FINISH);
+  out->len    = z.total_out;
+  deflateEnd(&z);
+
+  return rc == Z_STREAM_END;
+}
+
+/* Render the output of a format, on a task thread, and swap it in. Then wake up the requests waiting
+   for it. TSContSchedule() takes the mutex of a request, the requests must never wait for the cache
+   mutex while they hold theirs. */
+static int
+render_task(TSCont contp, TSEvent event ATS_UNUSED, void *edata ATS_UNUSED)
+{
+  render_cache *cache = TSContDataGet(contp);
+  TSHRTime started    = TShrtime();
+  bool gzip, gzip_valid = false;
+  render_buf tmp;
+  stats_state *waiter;
+
+  TSMutexLock(cache->mutex);
+  gzip = cache->gzip_wanted;
+  TSMutexUnlock(cache->mutex);
+
+  TSDebug(PLUGIN_NAME, "rendering the stats");
+  cache->next_plain.len = 0;
+  if (cache == &caches[FORMAT_OPENMETRICS]) {
+    openmetrics_out_stats(&cache->next_plain);
+  } else {
+    json_out_stats(&cache->next_plain);
+  }
+  if (gzip) {
+    gzip_valid = gzip_render(&cache->next_plain, &cache->next_gzip);
+  }
+
+  TSMutexLock(cache->mutex);
+  tmp                = cache->plain;
+  cache->plain       = cache->next_plain;
+  cache->next_plain  = tmp;
+  tmp                = cache->gzip;
+  cache->gzip        = cache->next_gzip;
+  cache->next_gzip   = tmp;
+  cache->rendered_at = started;
+  cache->gzip_valid  = gzip_valid;
+  cache->gzip_tried  = gzip;
+  cache->rendering   = false;
+  while ((waiter = cache->waiters) != NULL) {
+    cache->waiters      = waiter->next_waiter;
+    waiter->next_waiter = NULL;
+    waiter->waiting     = false;
+    TSContSchedule(waiter->contp, 0, TS_THREAD_POOL_NET);
+  }
+  TSMutexUnlock(cache->mutex);
+
+  return 0;
+}
+
+/* Write the response to the response buffer, if the output is there. Otherwise, unless another
+   request already did, start a render and wait for it, the render task wakes the request up when
+   it is done. This doesn't wait for the cache mutex either, the net threads must not block. */
+static response_status
+stats_write_response(stats_state *my_state)
+{
+  render_cache *cache = &caches[my_state->format];
+  render_buf *body    = NULL;
+
+  if (TSMutexLockTry(cache->mutex) != TS_SUCCESS) {
+    return RESPONSE_BUSY;
+  }
+
+  if (cache->rendered_at != 0 && cache->rendered_at + render_cache_time >= my_state->requested_at) {
+    if (!my_state->gzip) {
+      body = &cache->plain;
+    } else if (cache->gzip_valid) {
+      body = &cache->gzip;
+    } else if (cache->gzip_tried) {
+      /* compression failed, send it as is */
+      my_state->gzip = false;
+      body           = &cache->plain;
+    }
+  }
+
+  if (body == NULL) {
+    cache->gzip_wanted = cache->gzip_wanted || my_state->gzip;
+    if (!cache->rendering) {
+      cache->rendering = true;
+      TSContSchedule(cache->task, 0, TS_THREAD_POOL_TASK);
+    }
+    if (!my_state->waiting) {
+      my_state->next_waiter = cache->waiters;
+      my_state->waiting     = true;
+      cache->waiters        = my_state;
+    }
+    TSMutexUnlock(cache->mutex);
+    return RESPONSE_WAITING;
+  }
+
+  my_state->output_bytes = stats_add_resp_header(my_state, body->len);
+  TSIOBufferWrite(my_state->resp_buffer, body->data, body->len);
+  my_state->output_bytes += body->len;
+  TSMutexUnlock(cache->mutex);
+  return RESPONSE_WRITTEN;
+}
+
+/* The client left, or the render took too long: drop the request without a response. A render task
+   may still wake the request up, that event is dropped along with the continuation. */
+static void
+stats_abort(TSCont contp, stats_state *my_state)
+{
+  render_cache *cache = &caches[my_state->format];
+
+  if (my_state->timer) {
+    TSActionCancel(my_state->timer);
+    my_state->timer = NULL;
+  }
+
+  if (TSMutexLockTry(cache->mutex) != TS_SUCCESS) {
+    my_state->closed = true;
+    my_state->timer  = TSContSchedule(contp, RENDER_WAIT_MSEC, TS_THREAD_POOL_NET);
+    return;
+  }
+  if (my_state->waiting) {
+    stats_state **w = &cache->waiters;
+
+    while (*w != my_state) {
+      w = &(*w)->next_waiter;
+    }
+    *w                = my_state->next_waiter;
+    my_state->waiting = false;
+  }
+  TSMutexUnlock(cache->mutex);
+
+  stats_cleanup(contp, my_state);
+}
+
+static void
+stats_respond(TSCont contp, stats_state *my_state)
+{
+  TSHRTime deadline = my_state->requested_at + TS_HRTIME_MSECONDS(RENDER_TIMEOUT_MSEC);
+
+  if (my_state->timer) {
+    TSActionCancel(my_state->timer);
+    my_state->timer = NULL;
+  }
+
+  if (TShrtime() >= deadline) {
+    TSError("[%s] gave up waiting for the stats to render", PLUGIN_NAME);
+    stats_abort(contp, my_state);
+    return;
+  }
+
+  switch (stats_write_response(my_state)) {
+  case RESPONSE_WRITTEN:
+    TSVConnShutdown(my_state->net_vc, 1, 0);
+    my_state->write_vio = TSVConnWrite(my_state->net_vc, contp, my_state->resp_reader, my_state->output_bytes);
+    break;
+  case RESPONSE_BUSY:
+    my_state->timer = TSContSchedule(contp, RENDER_WAIT_MSEC, TS_THREAD_POOL_NET);
+    break;
+  case RESPONSE_WAITING:
+    /* the render task wakes us up, unless it takes too long */
+    my_state->timer = TSContSchedule(contp, (deadline - TShrtime()) / TS_HRTIME_MSECOND + 1, TS_THREAD_POOL_NET);
+    break;
+  }
+}
+
+static void
+stats_process_read(TSCont contp, TSEvent event, stats_state *my_state)
+{
+  TSDebug(PLUGIN_NAME, "stats_process_read(%d)", event);
+  if (event == TS_EVENT_VCONN_READ_READY) {
+    if (!my_state->responding) {
+      my_state->responding   = true;
+      my_state->requested_at = TShrtime();
+      stats_respond(contp, my_state);
+    }
+  } else if (event == TS_EVENT_ERROR) {
+    TSError("[%s] stats_process_read: Received TS_EVENT_ERROR", PLUGIN_NAME);
+    if (my_state->write_vio == NULL && !my_state->closed) {
+      stats_abort(contp, my_state);
+    }
+  } else if (event == TS_EVENT_VCONN_EOS) {
+    /* client may end the connection, stop waiting for the output unless it is being written */
+    if (my_state->write_vio == NULL && !my_state->closed) {
+      stats_abort(contp, my_state);
+    }
+    return;
+  } else if (event == TS_EVENT_NET_ACCEPT_FAILED) {
+    TSError("[%s] stats_process_read: Received TS_EVENT_NET_ACCEPT_FAILED", PLUGIN_NAME);
+  } else {
+    printf("Unexpected Event %d\n", event);
+    TSReleaseAssert(!"Unexpected Event");
+  }
+}
+
 static void
 stats_process_write(TSCont contp, TSEvent event, stats_state *my_state)
 {
   if (event == TS_EVENT_VCONN_WRITE_READY) {
-    if (my_state->body_written == 0) {
-      TSDebug(PLUGIN_NAME, "plugin adding response body");
-      my_state->body_written = 1;
-      json_out_stats(my_state);
-      TSVIONBytesSet(my_state->write_vio, my_state->output_bytes);
-    }
     TSVIOReenable(my_state->write_vio);
   } else if (TS_EVENT_VCONN_WRITE_COMPLETE) {
     stats_cleanup(contp, my_state);
@@ -225,12 +759,66 @@ stats_dostuff(TSCont contp, TSEvent event, void *edata)
     stats_process_read(contp, event, my_state);
   } else if (edata == my_state->write_vio) {
     stats_process_write(contp, event, my_state);
+  } else if (event == TS_EVENT_TIMEOUT) {
+    /* the render cache was busy, or the render took too long */
+    my_state->timer = NULL;
+    if (my_state->closed) {
+      stats_abort(contp, my_state);
+    } else {
+      stats_respond(contp, my_state);
+    }
+  } else if (event == TS_EVENT_IMMEDIATE) {
+    /* woken up by the render task */
+    if (!my_state->closed && my_state->write_vio == NULL) {
+      stats_respond(contp, my_state);
+    }
   } else {
     TSReleaseAssert(!"Unexpected Event");
   }
   return 0;
 }
 
+/* Whether a value of the field @a name lists @a token, with a quality above 0. */
+static bool
+header_accepts(TSMBuffer bufp, TSMLoc hdr_loc, const char *name, int name_len, const char *token)
+{
+  TSMLoc field  = TSMimeHdrFieldFind(bufp, hdr_loc, name, name_len);
+  int token_len = strlen(token);
+  bool accepted = false;
+
+  while (field != TS_NULL_MLOC) {
+    int count = TSMimeHdrFieldValuesCount(bufp, hdr_loc, field);
+
+    for (int i = 0; i < count && !accepted; ++i) {
+      int len        = 0;
+      const char *v  = TSMimeHdrFieldValueStringGet(bufp, hdr_loc, field, i, &len);
+      const char *q  = NULL;
+      char qvalue[8] = "";
+
+      if (len < token_len || strncasecmp(v, token, token_len) != 0 ||
+          (len > token_len && v[token_len] != ';' && v[token_len] != ' ')) {
+        continue;
+      }
+      for (int j = token_len; j + 2 <= len; ++j) {
+        if (v[j] == 'q' && v[j + 1] == '=') {
+          q = v + j + 2;
+          snprintf(qvalue, sizeof(qvalue), "%.*s", (int)(len - j - 2), q);
+          break;
+        }
+      }
+      accepted = q == NULL || strtod(qvalue, NULL) > 0;
+    }
+
+    TSMLoc next = TSMimeHdrFieldNextDup(bufp, hdr_loc, field);
+    TSHandleMLocRelease(bufp, hdr_loc, field);
+    field = accepted ? TS_NULL_MLOC : next;
+    if (accepted && next != TS_NULL_MLOC) {
+      TSHandleMLocRelease(bufp, hdr_loc, next);
+    }
+  }
+  return accepted;
+}
+
 static int
 stats_origin(TSCont contp ATS_UNUSED, TSEvent event ATS_UNUSED, void *edata)
 {
@@ -267,6 +855,11 @@ stats_origin(TSCont contp ATS_UNUSED, TSEvent event ATS_UNUSED, void *edata)
   icontp   = TSContCreate(stats_dostuff, TSMutexCreate());
   my_state = (stats_state *)TSmalloc(sizeof(*my_state));
   memset(my_state, 0, sizeof(*my_state));
+  my_state->contp = icontp;
+  if (header_accepts(reqp, hdr_loc, TS_MIME_FIELD_ACCEPT, TS_MIME_LEN_ACCEPT, "application/openmetrics-text")) {
+    my_state->format = FORMAT_OPENMETRICS;
+  }
+  my_state->gzip = header_accepts(reqp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING, "gzip");
   TSContDataSet(icontp, my_state);
   TSHttpTxnIntercept(icontp, txnp);
   goto cleanup;
@@ -290,9 +883,10 @@ TSPluginInit(int argc, const char *argv[])
 {
   TSPluginRegistrationInfo info;
 
-  static const char usage[]             = PLUGIN_NAME ".so [--integer-counters] [PATH]";
+  static const char usage[]             = PLUGIN_NAME ".so [--integer-counters] [--wrap-counters] [--render-cache-ms=MS] [PATH]";
   static const struct option longopts[] = {{(char *)("integer-counters"), no_argument, NULL, 'i'},
                                            {(char *)("wrap-counters"), no_argument, NULL, 'w'},
+                                           {(char *)("render-cache-ms"), required_argument, NULL, 'c'},
                                            {NULL, 0, NULL, 0}};
 
   info.plugin_name   = PLUGIN_NAME;
@@ -304,7 +898,10 @@ TSPluginInit(int argc, const char *argv[])
   }
 
   for (;;) {
-    switch (getopt_long(argc, (char *const *)argv, "iw", longopts, NULL)) {
+    switch (getopt_long(argc, (char *const *)argv, "iwc:", longopts, NULL)) {
+    case 'c':
+      render_cache_time = TS_HRTIME_MSECONDS(strtol(optarg, NULL, 10));
+      break;
     case 'i':
       integer_counters = true;
       break;
@@ -327,6 +924,12 @@ init:
   }
   url_path_len = strlen(url_path);
 
+  for (int i = 0; i < FORMAT_COUNT; ++i) {
+    caches[i].mutex = TSMutexCreate();
+    caches[i].task  = TSContCreate(render_task, TSMutexCreate());
+    TSContDataSet(caches[i].task, &caches[i]);
+  }
+
   /* Create a continuation with a mutex as there is a shared global structure
      containing the headers to add */
   TSHttpHookAdd(TS_HTTP_READ_REQUEST_HDR_HOOK, TSContCreate(stats_origin, NULL));
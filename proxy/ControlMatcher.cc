@@ -663,6 +663,18 @@ IpMatcher<Data, MatchResult>::Match(sockaddr const *addr, RequestData *rdata, Ma
   }
 }
 
+//
+// void IpMatcher<Data,MatchResult>::Freeze()
+//
+//   Compiles the map for lookups once all the entries are in.
+//
+template <class Data, class MatchResult>
+void
+IpMatcher<Data, MatchResult>::Freeze()
+{
+  ip_map.freeze();
+}
+
 template <class Data, class MatchResult>
 void
 IpMatcher<Data, MatchResult>::Print()
@@ -930,6 +942,10 @@ ControlMatcher<Data, MatchResult>::BuildTableFromString(char *file_buf)
 
   ink_assert(second_pass == numEntries);
 
+  if (ipMatch != nullptr) {
+    ipMatch->Freeze();
+  }
+
   if (is_debug_tag_set("matcher")) {
     Print();
   }
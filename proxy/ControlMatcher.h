@@ -284,6 +284,7 @@ public:
   void Match(sockaddr const *ip_addr, RequestData *rdata, MatchResult *result);
   void AllocateSpace(int num_entries);
   Result NewEntry(matcher_line *line_info);
+  void Freeze();
   void Print();
 
   using super::num_el;
@@ -307,6 +307,9 @@ IpAllow::BuildTable()
     for (auto &item : _dest_map) {
       item.setData(&_dest_acls[reinterpret_cast<size_t>(item.data())]);
     }
+    // Every accepted connection is checked, compile the maps for lookups.
+    _src_map.freeze();
+    _dest_map.freeze();
   }
 
   if (is_debug_tag_set("ip-allow")) {
@@ -34,20 +34,22 @@ ParentConsistentHash::ParentConsistentHash(ParentRecord *parent_record)
   secondary_mode     = parent_record->secondary_mode;
   ink_zero(foundParents);
 
-  chash[PRIMARY] = new ATSConsistentHash();
+  chash[PRIMARY] = new ATSConsistentHash(1024, nullptr, parent_record->hash_algorithm);
 
   for (i = 0; i < parent_record->num_parents; i++) {
     chash[PRIMARY]->insert(&(parent_record->parents[i]), parent_record->parents[i].weight, (ATSHash64 *)&hash[PRIMARY]);
   }
+  chash[PRIMARY]->build((ATSHash64 *)&hash[PRIMARY]);
 
   if (parent_record->num_secondary_parents > 0) {
     Debug("parent_select", "ParentConsistentHash(): initializing the secondary parents hash.");
-    chash[SECONDARY] = new ATSConsistentHash();
+    chash[SECONDARY] = new ATSConsistentHash(1024, nullptr, parent_record->hash_algorithm);
 
     for (i = 0; i < parent_record->num_secondary_parents; i++) {
       chash[SECONDARY]->insert(&(parent_record->secondary_parents[i]), parent_record->secondary_parents[i].weight,
                                (ATSHash64 *)&hash[SECONDARY]);
     }
+    chash[SECONDARY]->build((ATSHash64 *)&hash[SECONDARY]);
   } else {
     chash[SECONDARY] = nullptr;
   }
@@ -650,6 +650,18 @@ ParentRecord::Init(matcher_line *line_info)
         go_direct = true;
       }
       used = true;
+    } else if (strcasecmp(label, "hash_algorithm") == 0) {
+      // hash_algorithm=ring | maglev | jump
+      if (strcasecmp(val, "ring") == 0) {
+        hash_algorithm = ATS_CONSISTENT_HASH_RING;
+      } else if (strcasecmp(val, "maglev") == 0) {
+        hash_algorithm = ATS_CONSISTENT_HASH_MAGLEV;
+      } else if (strcasecmp(val, "jump") == 0) {
+        hash_algorithm = ATS_CONSISTENT_HASH_JUMP;
+      } else {
+        errPtr = "invalid argument to hash_algorithm directive";
+      }
+      used = true;
     } else if (strcasecmp(label, "qstring") == 0) {
       // qstring=ignore | consider
       if (strcasecmp(val, "ignore") == 0) {
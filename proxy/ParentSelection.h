@@ -146,6 +146,7 @@ public:
   int max_simple_retries                                             = 1;
   int max_unavailable_server_retries                                 = 1;
   int secondary_mode                                                 = 1;
+  ATSConsistentHashAlgorithm hash_algorithm                          = ATS_CONSISTENT_HASH_RING;
 };
 
 // If the parent was set by the external customer api,
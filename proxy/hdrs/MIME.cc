@@ -1061,7 +1061,8 @@ _mime_field_block_copy(MIMEFieldBlockImpl *s_fblock, HdrHeap * /* s_heap ATS_UNU
   MIMEFieldBlockImpl *d_fblock;
 
   d_fblock = (MIMEFieldBlockImpl *)d_heap->allocate_obj(sizeof(MIMEFieldBlockImpl), HDR_HEAP_OBJ_FIELD_BLOCK);
-  memcpy(d_fblock, s_fblock, sizeof(MIMEFieldBlockImpl));
+  // like the first block in mime_hdr_copy_onto, only the slots below the freetop are worth copying
+  memcpy(d_fblock, s_fblock, (char *)&(s_fblock->m_field_slots[s_fblock->m_freetop]) - (char *)s_fblock);
   return d_fblock;
 }
 
@@ -86,7 +86,21 @@ struct URLImpl : public HdrHeapObjImpl {
   void check_strings(HeapCheck *heaps, int num_heaps);
 };
 
-using URLHashContext = CryptoContext;
+/// The hash of the cache keys of URLs, which may differ from the global @c CryptoContext::Setting.
+class URLHashContext : public CryptoContext
+{
+public:
+  URLHashContext() : CryptoContext(type()) {}
+
+  /// @c UNSPECIFIED follows @c CryptoContext::Setting.
+  static HashType Setting;
+
+  static HashType
+  type()
+  {
+    return Setting == UNSPECIFIED ? CryptoContext::Setting : Setting;
+  }
+};
 
 extern const char *URL_SCHEME_FILE;
 extern const char *URL_SCHEME_FTP;
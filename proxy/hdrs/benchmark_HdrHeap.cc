@@ -0,0 +1,167 @@
+/** @file
+
+  Micro benchmark of the header work done for a cache hit.
+
+  Builds the alternate for a typical cached response, marshals it as for a cache write, and then
+  times the steps of a hit: unmarshaling a freshly read copy of the marshaled alternate, copying
+  the cached response to a writeable header as HttpTransact::build_response() does, and editing
+  and printing that copy.
+
+    benchmark_HdrHeap [iterations]
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "tscore/ink_hrtime.h"
+#include "I_EventSystem.h"
+#include "HTTP.h"
+
+#include <vector>
+
+namespace
+{
+int iterations = 1000000;
+
+const char REQUEST[] = "GET http://www.example.com/static/img/logo-123456.png?v=20181002 HTTP/1.1\r\n"
+                       "Host: www.example.com\r\n"
+                       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+                       "Accept: image/webp,image/apng,image/*,*/*;q=0.8\r\n"
+                       "Accept-Encoding: gzip, deflate, br\r\n"
+                       "Accept-Language: en-US,en;q=0.9\r\n"
+                       "Cookie: session=abcdefghijklmnopqrstuvwxyz0123456789\r\n"
+                       "\r\n";
+
+const char RESPONSE[] = "HTTP/1.1 200 OK\r\n"
+                        "Date: Mon, 01 Oct 2018 10:00:00 GMT\r\n"
+                        "Server: nginx/1.13.12\r\n"
+                        "Content-Type: image/png\r\n"
+                        "Content-Length: 12345\r\n"
+                        "Last-Modified: Mon, 01 Oct 2018 09:00:00 GMT\r\n"
+                        "ETag: \"5bb1f0a0-3039\"\r\n"
+                        "Cache-Control: public, max-age=31536000\r\n"
+                        "Expires: Tue, 01 Oct 2019 10:00:00 GMT\r\n"
+                        "X-Request-Id: 0123456789abcdef0123456789abcdef\r\n"
+                        "Access-Control-Allow-Origin: *\r\n"
+                        "Vary: Accept-Encoding\r\n"
+                        "Connection: keep-alive\r\n"
+                        "Accept-Ranges: bytes\r\n"
+                        "X-Content-Type-Options: nosniff\r\n"
+                        "Strict-Transport-Security: max-age=31536000\r\n"
+                        "Timing-Allow-Origin: *\r\n"
+                        "X-Frame-Options: SAMEORIGIN\r\n"
+                        "\r\n";
+
+void
+parse(HTTPHdr &hdr, const char *text, int len, HTTPType type)
+{
+  HTTPParser parser;
+  const char *start = text;
+
+  http_parser_init(&parser);
+  hdr.create(type);
+  if (type == HTTP_TYPE_REQUEST) {
+    hdr.parse_req(&parser, &start, text + len, true);
+  } else {
+    hdr.parse_resp(&parser, &start, text + len, true);
+  }
+  http_parser_clear(&parser);
+}
+
+double
+per_iteration(ink_hrtime start)
+{
+  return static_cast<double>(ink_get_hrtime_internal() - start) / iterations;
+}
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  if (argc > 1) {
+    iterations = atoi(argv[1]);
+  }
+
+  Thread *main_thread = new EThread();
+  main_thread->set_specific();
+  url_init();
+  mime_init();
+  http_init();
+
+  HTTPHdr request, response;
+  parse(request, REQUEST, sizeof(REQUEST) - 1, HTTP_TYPE_REQUEST);
+  parse(response, RESPONSE, sizeof(RESPONSE) - 1, HTTP_TYPE_RESPONSE);
+
+  HTTPInfo info;
+  info.create();
+  info.request_set(&request);
+  info.response_set(&response);
+
+  int len = info.marshal_length();
+  std::vector<char> marshaled(len), buffer(len);
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < iterations; ++i) {
+    info.marshal(marshaled.data(), len);
+  }
+  double marshal_time = per_iteration(start);
+
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < iterations; ++i) {
+    memcpy(buffer.data(), marshaled.data(), len);
+  }
+  double memcpy_time = per_iteration(start);
+
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < iterations; ++i) {
+    memcpy(buffer.data(), marshaled.data(), len);
+    HTTPInfo::unmarshal(buffer.data(), len, nullptr);
+  }
+  double unmarshal_time = per_iteration(start) - memcpy_time;
+
+  HTTPInfo cached;
+  cached.get_handle(buffer.data(), len);
+  HTTPHdr *cached_response = cached.response_get();
+
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < iterations; ++i) {
+    HTTPHdr copy;
+    copy.copy(cached_response);
+    copy.destroy();
+  }
+  double copy_time = per_iteration(start);
+
+  char out[4096];
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < iterations; ++i) {
+    HTTPHdr copy;
+    int index = 0, skip = 0;
+    copy.copy(cached_response);
+    copy.field_delete(MIME_FIELD_CONNECTION, MIME_LEN_CONNECTION);
+    copy.value_set(MIME_FIELD_AGE, MIME_LEN_AGE, "12", 2);
+    copy.print(out, sizeof(out), &index, &skip);
+    copy.destroy();
+  }
+  double edit_time = per_iteration(start);
+
+  printf("%d byte marshaled alternate\n", len);
+  printf("marshal          %6.1f ns\n", marshal_time);
+  printf("unmarshal        %6.1f ns\n", unmarshal_time);
+  printf("copy             %6.1f ns\n", copy_time);
+  printf("copy edit print  %6.1f ns\n", edit_time);
+  return 0;
+}
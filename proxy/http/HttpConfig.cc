@@ -26,6 +26,7 @@
 #include <cstring>
 #include "HttpConfig.h"
 #include "HTTP.h"
+#include "HttpLatencyStats.h"
 #include "ProcessManager.h"
 #include "ProxyConfig.h"
 #include "P_Net.h"
@@ -858,6 +859,12 @@ register_stat_callbacks()
                      (int)https_total_client_connections_stat, RecRawStatSyncCount);
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.origin_connections_throttled_out", RECD_COUNTER, RECP_PERSISTENT,
                      (int)http_origin_connections_throttled_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.origin_concurrency_limited", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_origin_concurrency_limited_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.tunnel_fanout", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_tunnel_fanout_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.tunnel_fanout_denied", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_tunnel_fanout_denied_stat, RecRawStatSyncCount);
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.post_body_too_large", RECD_COUNTER, RECP_PERSISTENT,
                      (int)http_post_body_too_large, RecRawStatSyncCount);
   // milestones
@@ -964,6 +971,7 @@ HttpConfig::startup()
   extern void SSLConfigInit(IpMap * map);
   http_rsb = RecAllocateRawStatBlock((int)http_stat_count);
   register_stat_callbacks();
+  HttpLatencyStats::startup();
 
   HttpConfigParams &c = m_master;
 
@@ -988,6 +996,11 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections, "proxy.config.http.origin_max_connections");
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections_queue, "proxy.config.http.origin_max_connections_queue");
   HttpEstablishStaticConfigLongLong(c.origin_min_keep_alive_connections, "proxy.config.http.origin_min_keep_alive_connections");
+  HttpEstablishStaticConfigByte(c.origin_concurrency_mode, "proxy.config.http.origin_concurrency.mode");
+  HttpEstablishStaticConfigLongLong(c.origin_concurrency_min_limit, "proxy.config.http.origin_concurrency.min_limit");
+  HttpEstablishStaticConfigLongLong(c.origin_concurrency_max_limit, "proxy.config.http.origin_concurrency.max_limit");
+  HttpEstablishStaticConfigFloat(c.origin_concurrency_tolerance, "proxy.config.http.origin_concurrency.latency_tolerance");
+  HttpEstablishStaticConfigFloat(c.origin_concurrency_backoff, "proxy.config.http.origin_concurrency.backoff");
   HttpEstablishStaticConfigByte(c.oride.attach_server_session_to_client, "proxy.config.http.attach_server_session_to_client");
 
   HttpEstablishStaticConfigByte(c.disable_ssl_parenting, "proxy.local.http.parent_proxy.disable_connect_tunneling");
@@ -1021,6 +1034,8 @@ HttpConfig::startup()
   HttpEstablishStaticConfigByte(c.oride.flow_control_enabled, "proxy.config.http.flow_control.enabled");
   HttpEstablishStaticConfigLongLong(c.oride.flow_high_water_mark, "proxy.config.http.flow_control.high_water");
   HttpEstablishStaticConfigLongLong(c.oride.flow_low_water_mark, "proxy.config.http.flow_control.low_water");
+  HttpEstablishStaticConfigLongLong(c.flow_fanout_lag, "proxy.config.http.flow_control.fanout_lag");
+  HttpEstablishStaticConfigLongLong(c.flow_fanout_memory_limit, "proxy.config.http.flow_control.fanout_memory_limit");
   HttpEstablishStaticConfigByte(c.oride.post_check_content_length_enabled, "proxy.config.http.post.check.content_length.enabled");
   HttpEstablishStaticConfigByte(c.oride.request_buffer_enabled, "proxy.config.http.request_buffer_enabled");
   HttpEstablishStaticConfigByte(c.strict_uri_parsing, "proxy.config.http.strict_uri_parsing");
@@ -1270,7 +1285,8 @@ HttpConfig::reconfigure()
   params->oride.origin_max_connections_queue = m_master.oride.origin_max_connections_queue;
   // if origin_max_connections_queue is set without max_connections, it is meaningless, so we'll warn
   if (params->oride.origin_max_connections_queue > 0 &&
-      !(params->oride.origin_max_connections || params->origin_min_keep_alive_connections)) {
+      !(params->oride.origin_max_connections || params->origin_min_keep_alive_connections ||
+        m_master.origin_concurrency_mode == 2)) {
     Warning("origin_max_connections_queue is set, but neither origin_max_connections nor origin_min_keep_alive_connections are "
             "set, please correct your records.config");
   }
@@ -1282,6 +1298,17 @@ HttpConfig::reconfigure()
     params->origin_min_keep_alive_connections = params->oride.origin_max_connections;
   }
 
+  params->origin_concurrency_mode      = m_master.origin_concurrency_mode;
+  params->origin_concurrency.min_limit = std::max<MgmtInt>(1, m_master.origin_concurrency_min_limit);
+  params->origin_concurrency.max_limit =
+    std::max<MgmtInt>(params->origin_concurrency.min_limit, m_master.origin_concurrency_max_limit);
+  params->origin_concurrency.tolerance = std::max<MgmtFloat>(1.0, m_master.origin_concurrency_tolerance);
+  params->origin_concurrency.backoff   = m_master.origin_concurrency_backoff;
+  if (params->origin_concurrency.backoff <= 0 || params->origin_concurrency.backoff >= 1) {
+    Warning("proxy.config.http.origin_concurrency.backoff must be between 0 and 1, using 0.9");
+    params->origin_concurrency.backoff = 0.9;
+  }
+
   params->oride.insert_request_via_string   = m_master.oride.insert_request_via_string;
   params->oride.insert_response_via_string  = m_master.oride.insert_response_via_string;
   params->proxy_request_via_string          = ats_strdup(m_master.proxy_request_via_string);
@@ -1318,6 +1345,8 @@ HttpConfig::reconfigure()
     // zero means "hardwired default" when actually used.
     params->oride.flow_high_water_mark = params->oride.flow_low_water_mark = 0;
   }
+  params->flow_fanout_lag          = std::max<MgmtInt>(0, m_master.flow_fanout_lag);
+  params->flow_fanout_memory_limit = std::max<MgmtInt>(0, m_master.flow_fanout_memory_limit);
 
   params->oride.server_session_sharing_match = m_master.oride.server_session_sharing_match;
   params->server_session_sharing_pool        = m_master.server_session_sharing_pool;
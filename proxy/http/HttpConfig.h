@@ -47,6 +47,7 @@
 #include "tscore/Regex.h"
 #include "string_view"
 #include "tscore/BufferWriter.h"
+#include "tscore/ConcurrencyLimit.h"
 #include "HttpProxyAPIEnums.h"
 #include "ProxyConfig.h"
 #include "records/P_RecProcess.h"
@@ -325,6 +326,9 @@ enum {
   http_sm_finish_time_stat,
 
   http_origin_connections_throttled_stat,
+  http_origin_concurrency_limited_stat,
+  http_tunnel_fanout_stat,
+  http_tunnel_fanout_denied_stat,
 
   http_stat_count
 };
@@ -802,6 +806,14 @@ public:
   MgmtInt origin_min_keep_alive_connections = 0; // TODO: This one really ought to be overridable, but difficult right now.
   MgmtInt max_websocket_connections         = -1;
 
+  // Per origin load tracking, 1 only tracks, 2 also enforces the adaptive concurrency limit.
+  MgmtByte origin_concurrency_mode       = 0;
+  MgmtInt origin_concurrency_min_limit   = 10;
+  MgmtInt origin_concurrency_max_limit   = 1000;
+  MgmtFloat origin_concurrency_tolerance = 2.0;
+  MgmtFloat origin_concurrency_backoff   = 0.9;
+  ts::ConcurrencyLimit::Params origin_concurrency;
+
   char *proxy_request_via_string    = nullptr;
   char *proxy_response_via_string   = nullptr;
   int proxy_request_via_string_len  = 0;
@@ -828,6 +840,10 @@ public:
   MgmtInt post_copy_size = 2048;
   MgmtInt max_post_size  = 0;
 
+  // Bytes a client may fall behind the cache write of the same response, and the total of that for all tunnels.
+  MgmtInt flow_fanout_lag          = 0;
+  MgmtInt flow_fanout_memory_limit = 0;
+
   ///////////////////////////////////////////////////////////////////
   // Put all MgmtByte members down here, avoids additional padding //
   ///////////////////////////////////////////////////////////////////
@@ -25,6 +25,7 @@
 
 ConnectionCount ConnectionCount::_connectionCount;
 ConnectionCountQueue ConnectionCountQueue::_connectionCount;
+OriginLoad OriginLoad::_originLoad;
 
 std::string
 ConnectionCount::dumpToJSON()
@@ -60,6 +61,98 @@ ConnectionCount::dumpToJSON()
   return oss.str();
 }
 
+void
+OriginLoad::sweep(Shard &shard, ink_hrtime now)
+{
+  for (auto spot = shard.origins.begin(); spot != shard.origins.end();) {
+    if (spot->second.limit.in_flight() == 0 && spot->second.last_used + IDLE_TIMEOUT < now) {
+      spot = shard.origins.erase(spot);
+    } else {
+      ++spot;
+    }
+  }
+  shard.next_sweep = now + SWEEP_INTERVAL;
+}
+
+bool
+OriginLoad::acquire(const char *hostname, const CryptoHash &hostname_hash, const ts::ConcurrencyLimit::Params &params,
+                    ink_hrtime now, bool enforce, bool retry)
+{
+  Shard &s = shard(hostname_hash);
+  ink_mutex_acquire(&s.mutex);
+  if (now >= s.next_sweep) {
+    sweep(s, now);
+  }
+  auto spot = s.origins.find(hostname_hash);
+  if (spot == s.origins.end()) {
+    spot = s.origins.emplace(hostname_hash, Origin(hostname, params)).first;
+  }
+  Origin &origin   = spot->second;
+  origin.last_used = now;
+  bool result      = origin.limit.acquire(params, enforce, retry);
+  ink_mutex_release(&s.mutex);
+  return result;
+}
+
+void
+OriginLoad::release(const CryptoHash &hostname_hash, const ts::ConcurrencyLimit::Params &params, ink_hrtime now,
+                    ink_hrtime latency, bool success)
+{
+  Shard &s = shard(hostname_hash);
+  ink_mutex_acquire(&s.mutex);
+  auto spot = s.origins.find(hostname_hash);
+  if (spot != s.origins.end()) {
+    spot->second.limit.release(params, now, latency, success);
+    spot->second.last_used = now;
+  }
+  ink_mutex_release(&s.mutex);
+}
+
+void
+OriginLoad::cancel(const CryptoHash &hostname_hash)
+{
+  Shard &s = shard(hostname_hash);
+  ink_mutex_acquire(&s.mutex);
+  auto spot = s.origins.find(hostname_hash);
+  if (spot != s.origins.end()) {
+    spot->second.limit.cancel();
+  }
+  ink_mutex_release(&s.mutex);
+}
+
+std::string
+OriginLoad::dumpToJSON()
+{
+  std::ostringstream list;
+  size_t count = 0;
+
+  for (auto &s : _shards) {
+    ink_mutex_acquire(&s.mutex);
+    for (auto const &spot : s.origins) {
+      const Origin &origin             = spot.second;
+      const ts::ConcurrencyLimit &load = origin.limit;
+
+      if (count++ > 0) {
+        list << ',';
+      }
+      list << "{\"host\": \"" << origin.name << '"';
+      list << ", \"in_flight\": " << load.in_flight();
+      list << ", \"limit\": " << load.limit();
+      list << ", \"latency_ms\": " << load.latency() / HRTIME_MSECOND;
+      list << ", \"min_latency_ms\": " << load.min_latency() / HRTIME_MSECOND;
+      list << ", \"error_rate\": " << load.error_rate();
+      list << ", \"requests\": " << load.requests();
+      list << ", \"errors\": " << load.errors();
+      list << ", \"rejected\": " << load.rejected() << '}';
+    }
+    ink_mutex_release(&s.mutex);
+  }
+
+  std::ostringstream oss;
+  oss << "{\"originCount\": " << count << ", \"originList\": [" << list.str() << "]}";
+  return oss.str();
+}
+
 struct ShowConnectionCount : public ShowCont {
   ShowConnectionCount(Continuation *c, HTTPHdr *h) : ShowCont(c, h) { SET_HANDLER(&ShowConnectionCount::showHandler); }
   int
@@ -77,3 +170,21 @@ register_ShowConnectionCount(Continuation *c, HTTPHdr *h)
   this_ethread()->schedule_imm(s);
   return &s->action;
 }
+
+struct ShowOriginLoad : public ShowCont {
+  ShowOriginLoad(Continuation *c, HTTPHdr *h) : ShowCont(c, h) { SET_HANDLER(&ShowOriginLoad::showHandler); }
+  int
+  showHandler(int event, Event *e)
+  {
+    CHECK_SHOW(show(OriginLoad::getInstance()->dumpToJSON().c_str()));
+    return completeJson(event, e);
+  }
+};
+
+Action *
+register_ShowOriginLoad(Continuation *c, HTTPHdr *h)
+{
+  ShowOriginLoad *s = new ShowOriginLoad(c, h);
+  this_ethread()->schedule_imm(s);
+  return &s->action;
+}
@@ -28,10 +28,12 @@
 #include "tscore/Map.h"
 #include "tscore/Diags.h"
 #include "tscore/CryptoHash.h"
+#include "tscore/ConcurrencyLimit.h"
 #include "tscore/ink_config.h"
 #include "HttpProxyAPIEnums.h"
 #include "Show.h"
 #include <sstream>
+#include <unordered_map>
 
 #pragma once
 
@@ -254,4 +256,97 @@ private:
   static ConnectionCountQueue _connectionCount;
 };
 
+/**
+ * Singleton class to keep track of the load of each origin, keyed by host name.
+ *
+ * A request is in flight to its origin from the time the transaction asks for a server session until
+ * it reads the response header or lets go of the server session. Each origin has an adaptive
+ * concurrency limit which goes down when the latency or the error rate of the origin goes up.
+ *
+ * The origins are spread over shards with a lock each, so that requests to different origins seldom
+ * wait on each other. An origin with no request in flight for IDLE_TIMEOUT is dropped.
+ */
+class OriginLoad
+{
+public:
+  static OriginLoad *
+  getInstance()
+  {
+    return &_originLoad;
+  }
+
+  /**
+   * Start a request to an origin
+   * @param enforce If false the request is accepted even above the limit, it is only counted
+   * @param retry True if the request was rejected before, it is not counted again
+   * @return false if the origin is at its concurrency limit
+   */
+  bool acquire(const char *hostname, const CryptoHash &hostname_hash, const ts::ConcurrencyLimit::Params &params, ink_hrtime now,
+               bool enforce, bool retry = false);
+
+  /**
+   * Finish a request started by acquire()
+   * @param latency Time to the response header
+   * @param success false if the origin did not respond or responded with a server error
+   */
+  void release(const CryptoHash &hostname_hash, const ts::ConcurrencyLimit::Params &params, ink_hrtime now, ink_hrtime latency,
+               bool success);
+
+  /**
+   * Drop a request started by acquire() which did not get to the origin
+   */
+  void cancel(const CryptoHash &hostname_hash);
+
+  /**
+   * dump to JSON for stat page.
+   * @return JSON string for the origins
+   */
+  std::string dumpToJSON();
+
+  static constexpr int N_SHARDS             = 64;
+  static constexpr ink_hrtime IDLE_TIMEOUT   = HRTIME_MINUTES(10);
+  static constexpr ink_hrtime SWEEP_INTERVAL = HRTIME_MINUTE;
+
+protected:
+  struct Origin {
+    Origin(const char *hostname, const ts::ConcurrencyLimit::Params &params) : name(hostname), limit(params) {}
+
+    std::string name;
+    ts::ConcurrencyLimit limit;
+    ink_hrtime last_used = 0;
+  };
+
+  struct HashFns {
+    size_t
+    operator()(const CryptoHash &hash) const
+    {
+      return hash.fold();
+    }
+  };
+
+  struct Shard {
+    Shard() { ink_mutex_init(&mutex); }
+
+    ink_mutex mutex;
+    std::unordered_map<CryptoHash, Origin, HashFns> origins;
+    ink_hrtime next_sweep = 0;
+  };
+
+  OriginLoad() {}
+  OriginLoad(const OriginLoad & /* x ATS_UNUSED */) {}
+
+  Shard &
+  shard(const CryptoHash &hostname_hash)
+  {
+    return _shards[hostname_hash.u64[1] % N_SHARDS];
+  }
+
+  /// Drop the origins of @a shard which have been idle for IDLE_TIMEOUT, called with its lock held.
+  void sweep(Shard &shard, ink_hrtime now);
+
+  static OriginLoad _originLoad;
+  Shard _shards[N_SHARDS];
+};
+
 Action *register_ShowConnectionCount(Continuation *, HTTPHdr *);
+Action *register_ShowOriginLoad(Continuation *, HTTPHdr *);
@@ -0,0 +1,172 @@
+/** @file
+
+  Latency histograms of transaction milestones.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <string>
+
+#include "P_EventSystem.h"
+#include "records/P_RecProcess.h"
+#include "records/P_RecUtils.h"
+#include "tscore/LogLinearHistogram.h"
+#include "HttpLatencyStats.h"
+
+namespace
+{
+// Microseconds, up to about 19 hours with a relative error of 1/8.
+using Histogram = ts::LogLinearHistogram<3, 36>;
+
+struct Latency {
+  const char *name;
+  TSMilestonesType start;
+  TSMilestonesType end;
+};
+
+const Latency LATENCIES[] = {
+  {"ua_read_header", TS_MILESTONE_SM_START, TS_MILESTONE_UA_READ_HEADER_DONE},
+  {"cache_open_read", TS_MILESTONE_CACHE_OPEN_READ_BEGIN, TS_MILESTONE_CACHE_OPEN_READ_END},
+  {"dns_lookup", TS_MILESTONE_DNS_LOOKUP_BEGIN, TS_MILESTONE_DNS_LOOKUP_END},
+  {"server_connect", TS_MILESTONE_SERVER_CONNECT, TS_MILESTONE_SERVER_CONNECT_END},
+  {"server_first_byte", TS_MILESTONE_SERVER_BEGIN_WRITE, TS_MILESTONE_SERVER_FIRST_READ},
+  {"total", TS_MILESTONE_SM_START, TS_MILESTONE_SM_FINISH},
+};
+
+struct Percentile {
+  const char *name;
+  double percent;
+};
+
+const Percentile PERCENTILES[] = {{"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p999", 99.9}};
+
+constexpr int N_LATENCIES   = sizeof(LATENCIES) / sizeof(LATENCIES[0]);
+constexpr int N_PERCENTILES = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+
+// The percentiles cover the transactions of the last one to two windows.
+constexpr ink_hrtime WINDOW = HRTIME_SECONDS(60);
+// All percentile stats of a sync share one merge of the thread histograms.
+constexpr ink_hrtime MERGE_INTERVAL = HRTIME_MSECONDS(100);
+
+off_t histogram_offset = -1;
+
+ink_mutex merge_mutex = PTHREAD_MUTEX_INITIALIZER;
+ink_hrtime merge_time = 0;
+ink_hrtime base_time  = 0;
+Histogram older_base[N_LATENCIES];
+Histogram newer_base[N_LATENCIES];
+Histogram window[N_LATENCIES];
+
+inline Histogram *
+thread_histograms(EThread *et)
+{
+  return static_cast<Histogram *>(ETHREAD_GET_PTR(et, histogram_offset));
+}
+
+void
+merge_histograms(Histogram *total)
+{
+  for (int i = 0; i < N_LATENCIES; ++i) {
+    total[i].clear();
+  }
+  for (EThread *et : eventProcessor.active_ethreads()) {
+    for (int i = 0; i < N_LATENCIES; ++i) {
+      total[i].add(thread_histograms(et)[i]);
+    }
+  }
+  for (EThread *et : eventProcessor.active_dthreads()) {
+    for (int i = 0; i < N_LATENCIES; ++i) {
+      total[i].add(thread_histograms(et)[i]);
+    }
+  }
+}
+
+int
+latency_stat_sync(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock * /* rsb ATS_UNUSED */, int id)
+{
+  int latency     = id / N_PERCENTILES;
+  int percentile  = id % N_PERCENTILES;
+  ink_hrtime now  = Thread::get_hrtime_updated();
+  uint64_t result = 0;
+
+  Debug("stats", "latency sync for %s", name);
+
+  ink_mutex_acquire(&merge_mutex);
+  if (now - merge_time >= MERGE_INTERVAL) {
+    static Histogram total[N_LATENCIES];
+
+    merge_histograms(total);
+    if (now - base_time >= WINDOW) {
+      for (int i = 0; i < N_LATENCIES; ++i) {
+        older_base[i] = newer_base[i];
+        newer_base[i] = total[i];
+      }
+      base_time = now;
+    }
+    for (int i = 0; i < N_LATENCIES; ++i) {
+      window[i] = total[i];
+      window[i].subtract(older_base[i]);
+    }
+    merge_time = now;
+  }
+  result = window[latency].percentile(PERCENTILES[percentile].percent);
+  ink_mutex_release(&merge_mutex);
+
+  RecDataSetFromInt64(data_type, data, static_cast<int64_t>(result));
+  return REC_ERR_OKAY;
+}
+} // namespace
+
+void
+HttpLatencyStats::startup()
+{
+  RecRawStatBlock *rsb;
+
+  if ((histogram_offset = eventProcessor.allocate(N_LATENCIES * sizeof(Histogram))) == -1) {
+    Warning("unable to allocate per thread latency histograms");
+    return;
+  }
+
+  // The block only provides the stat ids, the values are computed by the sync callback.
+  rsb = RecAllocateRawStatBlock(N_LATENCIES * N_PERCENTILES);
+  for (int i = 0; i < N_LATENCIES; ++i) {
+    for (int p = 0; p < N_PERCENTILES; ++p) {
+      std::string name = std::string("proxy.process.http.latency.") + LATENCIES[i].name + "." + PERCENTILES[p].name;
+      RecRegisterRawStat(rsb, RECT_PROCESS, name.c_str(), RECD_INT, RECP_NON_PERSISTENT, i * N_PERCENTILES + p, latency_stat_sync);
+    }
+  }
+}
+
+void
+HttpLatencyStats::record(const TransactionMilestones &milestones)
+{
+  if (histogram_offset == -1) {
+    return;
+  }
+
+  Histogram *histograms = thread_histograms(this_ethread());
+  for (int i = 0; i < N_LATENCIES; ++i) {
+    ink_hrtime start = milestones[LATENCIES[i].start];
+    ink_hrtime end   = milestones[LATENCIES[i].end];
+
+    if (start != 0 && end >= start) {
+      histograms[i].record(ink_hrtime_to_usec(end - start));
+    }
+  }
+}
@@ -0,0 +1,43 @@
+/** @file
+
+  Latency histograms of transaction milestones.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#pragma once
+
+#include "Milestones.h"
+
+/** Latency percentiles of the time between some transaction milestones.
+
+    Every thread records into its own log-linear histograms, without locks or atomics. The
+    histograms of all threads are merged when the stats are synced, and exported as
+    proxy.process.http.latency.<name>.<percentile> stats, in microseconds.
+ */
+class HttpLatencyStats
+{
+public:
+  /// Allocate the per thread histograms and register the stats. Must be called before the
+  /// event threads are started.
+  static void startup();
+
+  /// Record the latencies of a finished transaction, on the thread running it.
+  static void record(const TransactionMilestones &milestones);
+};
@@ -29,6 +29,7 @@
 #include "HttpServerSession.h"
 #include "HttpDebugNames.h"
 #include "HttpSessionManager.h"
+#include "HttpLatencyStats.h"
 #include "P_Cache.h"
 #include "P_Net.h"
 #include "StatPages.h"
@@ -1862,6 +1863,7 @@ HttpSM::state_read_server_response_header(int event, void *data)
     server_entry->read_vio->nbytes = server_entry->read_vio->ndone;
     http_parser_clear(&http_parser);
     milestones[TS_MILESTONE_SERVER_READ_HEADER_DONE] = Thread::get_hrtime();
+    origin_load_release();
   }
 
   switch (state) {
@@ -4629,6 +4631,120 @@ HttpSM::send_origin_throttled_response()
   call_transact_and_set_next_state(HttpTransact::HandleResponse);
 }
 
+// void HttpSM::queue_or_throttle_origin_request()
+//
+//   The origin has no room for the request, wait for it in the queue
+//    of the origin or fail the request if the queue is full
+//
+void
+HttpSM::queue_or_throttle_origin_request(const CryptoHash &hostname_hash)
+{
+  ip_port_text_buffer addrbuf;
+
+  ink_assert(pending_action == nullptr);
+
+  // if we were previously queued, or the queue is disabled-- just reschedule
+  if (t_state.origin_request_queued || t_state.txn_conf->origin_max_connections_queue < 0) {
+    pending_action = eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
+    return;
+  } else if (t_state.txn_conf->origin_max_connections_queue > 0) { // If we have a queue, lets see if there is a slot
+    ConnectionCountQueue *waiting_connections = ConnectionCountQueue::getInstance();
+    // if there is space in the queue
+    if (waiting_connections->getCount(t_state.current.server->dst_addr, hostname_hash,
+                                      (TSServerSessionSharingMatchType)t_state.txn_conf->server_session_sharing_match) <
+        t_state.txn_conf->origin_max_connections_queue) {
+      t_state.origin_request_queued = true;
+      Debug("http", "[%" PRId64 "] queued for this host: %s", sm_id,
+            ats_ip_ntop(&t_state.current.server->dst_addr.sa, addrbuf, sizeof(addrbuf)));
+      waiting_connections->incrementCount(t_state.current.server->dst_addr, hostname_hash,
+                                          (TSServerSessionSharingMatchType)t_state.txn_conf->server_session_sharing_match, 1);
+      pending_action = eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
+    } else { // the queue is full
+      HTTP_INCREMENT_DYN_STAT(http_origin_connections_throttled_stat);
+      send_origin_throttled_response();
+    }
+  } else { // the queue is set to 0
+    HTTP_INCREMENT_DYN_STAT(http_origin_connections_throttled_stat);
+    send_origin_throttled_response();
+  }
+}
+
+// bool HttpSM::origin_load_acquire()
+//
+//   Count the request as in flight to its origin. Returns false if the origin
+//    is at its adaptive concurrency limit, the request is then queued or failed.
+//    A request does not wait for the origin longer than connect_attempts_timeout
+//
+bool
+HttpSM::origin_load_acquire()
+{
+  const HttpConfigParams *params = t_state.http_config_param;
+  const char *hostname           = t_state.current.server->name;
+  CryptoHash hostname_hash;
+
+  // A retry or a redirect, the previous request is done with its origin.
+  origin_load_release();
+
+  ink_hrtime now = Thread::get_hrtime();
+
+  CryptoContext().hash_immediate(hostname_hash, static_cast<const void *>(hostname), static_cast<int>(strlen(hostname)));
+  if (OriginLoad::getInstance()->acquire(hostname, hostname_hash, params->origin_concurrency, now,
+                                         params->origin_concurrency_mode == 2, origin_load_wait_start != 0)) {
+    origin_load_hash       = hostname_hash;
+    origin_load_start      = now;
+    origin_load_wait_start = 0;
+    return true;
+  }
+
+  SMDebug("http", "[%" PRId64 "] origin %s is at its concurrency limit", sm_id, hostname);
+  if (origin_load_wait_start == 0) {
+    // Count the request once, not on every retry while it waits
+    origin_load_wait_start = now;
+    HTTP_INCREMENT_DYN_STAT(http_origin_concurrency_limited_stat);
+  } else if (now - origin_load_wait_start >= HRTIME_SECONDS(t_state.txn_conf->connect_attempts_timeout)) {
+    SMDebug("http", "[%" PRId64 "] gave up waiting for origin %s", sm_id, hostname);
+    origin_load_wait_start = 0;
+    if (t_state.origin_request_queued) {
+      ConnectionCountQueue *waiting_connections = ConnectionCountQueue::getInstance();
+      waiting_connections->incrementCount(t_state.current.server->dst_addr, hostname_hash,
+                                          (TSServerSessionSharingMatchType)t_state.txn_conf->server_session_sharing_match, -1);
+      t_state.origin_request_queued = false;
+    }
+    HTTP_INCREMENT_DYN_STAT(http_origin_connections_throttled_stat);
+    send_origin_throttled_response();
+    return false;
+  }
+  queue_or_throttle_origin_request(hostname_hash);
+  return false;
+}
+
+// void HttpSM::origin_load_release()
+//
+//   The request is done with its origin: it read the response header, or let
+//    go of the server session without one. If it did not get to the origin,
+//    @a completed is false and it does not count towards the latency and error rate
+//
+void
+HttpSM::origin_load_release(bool completed)
+{
+  if (origin_load_start == 0) {
+    return;
+  }
+
+  if (completed) {
+    // No response header is a failure, be it a connection error or a timeout.
+    ink_hrtime header_done = milestones[TS_MILESTONE_SERVER_READ_HEADER_DONE];
+    bool success           = header_done >= origin_load_start && t_state.hdr_info.server_response.valid() &&
+                   t_state.hdr_info.server_response.status_get() < HTTP_STATUS_INTERNAL_SERVER_ERROR;
+
+    OriginLoad::getInstance()->release(origin_load_hash, t_state.http_config_param->origin_concurrency, Thread::get_hrtime(),
+                                       header_done - origin_load_start, success);
+  } else {
+    OriginLoad::getInstance()->cancel(origin_load_hash);
+  }
+  origin_load_start = 0;
+}
+
 //////////////////////////////////////////////////////////////////////////
 //
 //  HttpSM::do_http_server_open()
@@ -4727,6 +4843,13 @@ HttpSM::do_http_server_open(bool raw)
     }
   }
 
+  // Count the request against the load of its origin, hold it back if the
+  //  origin is at its adaptive concurrency limit. A tunnel has no response
+  //  header to time, it is not a request to the origin.
+  if (!raw && t_state.http_config_param->origin_concurrency_mode != 0 && !origin_load_acquire()) {
+    return;
+  }
+
   // If this is not a raw connection, we try to get a session from the
   //  shared session pool.  Raw connections are for SSLs tunnel and
   //  require a new connection
@@ -4868,32 +4991,8 @@ HttpSM::do_http_server_open(bool raw)
               t_state.txn_conf->origin_max_connections, addrbuf);
       Warning("[%" PRId64 "] too many connections (%d) for this host (%" PRId64 "): %s", sm_id, ccount,
               t_state.txn_conf->origin_max_connections, addrbuf);
-      ink_assert(pending_action == nullptr);
-
-      // if we were previously queued, or the queue is disabled-- just reschedule
-      if (t_state.origin_request_queued || t_state.txn_conf->origin_max_connections_queue < 0) {
-        pending_action = eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
-        return;
-      } else if (t_state.txn_conf->origin_max_connections_queue > 0) { // If we have a queue, lets see if there is a slot
-        ConnectionCountQueue *waiting_connections = ConnectionCountQueue::getInstance();
-        // if there is space in the queue
-        if (waiting_connections->getCount(t_state.current.server->dst_addr, hostname_hash,
-                                          (TSServerSessionSharingMatchType)t_state.txn_conf->server_session_sharing_match) <
-            t_state.txn_conf->origin_max_connections_queue) {
-          t_state.origin_request_queued = true;
-          Debug("http", "[%" PRId64 "] queued for this host: %s", sm_id,
-                ats_ip_ntop(&t_state.current.server->dst_addr.sa, addrbuf, sizeof(addrbuf)));
-          waiting_connections->incrementCount(t_state.current.server->dst_addr, hostname_hash,
-                                              (TSServerSessionSharingMatchType)t_state.txn_conf->server_session_sharing_match, 1);
-          pending_action = eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
-        } else { // the queue is full
-          HTTP_INCREMENT_DYN_STAT(http_origin_connections_throttled_stat);
-          send_origin_throttled_response();
-        }
-      } else { // the queue is set to 0
-        HTTP_INCREMENT_DYN_STAT(http_origin_connections_throttled_stat);
-        send_origin_throttled_response();
-      }
+      origin_load_release(false);
+      queue_or_throttle_origin_request(hostname_hash);
       return;
     }
   }
@@ -5242,6 +5341,7 @@ HttpSM::mark_server_down_on_client_abort()
 void
 HttpSM::release_server_session(bool serve_from_cache)
 {
+  origin_load_release();
   if (server_session == nullptr) {
     return;
   }
@@ -5397,6 +5497,9 @@ HttpSM::handle_server_setup_error(int event, void *data)
 
   STATE_ENTER(&HttpSM::handle_server_setup_error, event);
 
+  // The origin failed to answer, it is done with this request.
+  origin_load_release();
+
   // If there is POST or PUT tunnel wait for the tunnel
   //  to figure out that things have gone to hell
 
@@ -6837,6 +6940,8 @@ HttpSM::kill_this()
   //   we must check it again
   if (kill_this_async_done == true) {
     ink_assert(pending_action == nullptr);
+    // Only left if the transaction ended before its server session got anywhere.
+    origin_load_release(false);
     if (t_state.http_config_param->enable_http_stats) {
       update_stats();
     }
@@ -6953,6 +7058,7 @@ HttpSM::update_stats()
     &t_state, total_time, ua_write_time, os_read_time, client_request_hdr_bytes, client_request_body_bytes,
     client_response_hdr_bytes, client_response_body_bytes, server_request_hdr_bytes, server_request_body_bytes,
     server_response_hdr_bytes, server_response_body_bytes, pushed_response_hdr_bytes, pushed_response_body_bytes, milestones);
+  HttpLatencyStats::record(milestones);
   /*
       if (is_action_tag_set("http_handler_times")) {
           print_all_http_handler_times();
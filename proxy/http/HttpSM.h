@@ -459,6 +459,9 @@ protected:
   void do_cache_lookup_and_read();
   void do_http_server_open(bool raw = false);
   void send_origin_throttled_response();
+  void queue_or_throttle_origin_request(const CryptoHash &hostname_hash);
+  bool origin_load_acquire();
+  void origin_load_release(bool completed = true);
   void do_setup_post_tunnel(HttpVC_t to_vc_type);
   void do_cache_prepare_write();
   void do_cache_prepare_write_transform();
@@ -568,6 +571,12 @@ protected:
   TSHttpHookID cur_hook_id = TS_HTTP_LAST_HOOK;
   APIHook *cur_hook        = nullptr;
 
+  // The origin this transaction is in flight to, if origin_load_start is set.
+  CryptoHash origin_load_hash;
+  ink_hrtime origin_load_start = 0;
+  // When the origin first turned this transaction away, 0 if it is not waiting for the origin.
+  ink_hrtime origin_load_wait_start = 0;
+
   //
   // Continuation time keeper
   int64_t prev_hook_start_time = 0;
@@ -37,13 +37,70 @@
 #include "HttpDebugNames.h"
 #include "tscore/ParseRules.h"
 
+#include <atomic>
+
 static const int min_block_transfer_bytes = 256;
-static const char *const CHUNK_HEADER_FMT = "%" PRIx64 "\r\n";
 // This should be as small as possible because it will only hold the
 // header and trailer per chunk - the chunk body will be a reference to
 // a block in the input stream.
 static int const CHUNK_IOBUFFER_SIZE_INDEX = MIN_IOBUFFER_SIZE;
 
+// Sum of the fan out lag of all tunnels, bounded by proxy.config.http.flow_control.fanout_memory_limit.
+static std::atomic<int64_t> fanout_reserved{0};
+
+namespace
+{
+/// Value of each character as a hex digit, -1 if it is not one.
+struct HexDigitTable {
+  int8_t value[256];
+
+  constexpr HexDigitTable() : value()
+  {
+    for (int i = 0; i < 256; ++i) {
+      value[i] = -1;
+    }
+    for (int i = 0; i < 10; ++i) {
+      value['0' + i] = i;
+    }
+    for (int i = 0; i < 6; ++i) {
+      value['a' + i] = value['A' + i] = 10 + i;
+    }
+  }
+
+  int
+  operator[](char c) const
+  {
+    return value[static_cast<uint8_t>(c)];
+  }
+};
+
+constexpr HexDigitTable hex_digit;
+
+/// A chunk size above this can't take another digit.
+constexpr int64_t CHUNK_SIZE_DIGIT_LIMIT = INT64_MAX >> 4;
+
+/// Write the chunk header for @a size to @a buf, which must hold 18 characters.
+/// @return The length of the header.
+int
+write_chunk_header(char *buf, int64_t size)
+{
+  static char const digits[] = "0123456789abcdef";
+  char tmp[16];
+  int n = 0;
+
+  do {
+    tmp[n++] = digits[size & 0xF];
+    size >>= 4;
+  } while (size);
+  for (int i = 0; i < n; ++i) {
+    buf[i] = tmp[n - 1 - i];
+  }
+  buf[n]     = '\r';
+  buf[n + 1] = '\n';
+  return n + 2;
+}
+} // namespace
+
 ChunkedHandler::ChunkedHandler()
   : action(ACTION_UNSET),
     chunked_reader(nullptr),
@@ -132,7 +189,7 @@ void
 ChunkedHandler::set_max_chunk_size(int64_t size)
 {
   max_chunk_size       = size ? size : DEFAULT_MAX_CHUNK_SIZE;
-  max_chunk_header_len = snprintf(max_chunk_header, sizeof(max_chunk_header), CHUNK_HEADER_FMT, max_chunk_size);
+  max_chunk_header_len = write_chunk_header(max_chunk_header, max_chunk_size);
 }
 
 void
@@ -146,24 +203,64 @@ ChunkedHandler::read_size()
     int64_t data_size = chunked_reader->block_read_avail();
 
     ink_assert(data_size > 0);
-    bytes_used = 0;
 
+    // Fast path, the size line is all in this block. Find its end with memchr and convert the
+    // digits with a table instead of stepping through the states for each character.
+    if (state == CHUNK_READ_SIZE_START || (state == CHUNK_READ_SIZE && num_digits == 0)) {
+      const char *end  = tmp + data_size;
+      const char *line = tmp;
+      const char *lf   = nullptr;
+
+      if (state == CHUNK_READ_SIZE_START) {
+        line = static_cast<const char *>(memchr(tmp, '\n', data_size));
+        line = line ? line + 1 : end;
+      }
+      if (line < end) {
+        lf = static_cast<const char *>(memchr(line, '\n', end - line));
+      }
+      if (lf) {
+        const char *spot = line;
+        int64_t size     = 0;
+        int digit;
+
+        while (spot < lf && (digit = hex_digit[*spot]) >= 0 && size <= CHUNK_SIZE_DIGIT_LIMIT) {
+          size = size * 16 + digit;
+          ++spot;
+        }
+        if (spot == line || (spot < lf && hex_digit[*spot] >= 0)) {
+          // Bogus or too large chunk size
+          state = CHUNK_READ_ERROR;
+          chunked_reader->consume(spot - tmp + 1);
+          break;
+        }
+        Debug("http_chunk", "read chunk size of %" PRId64 " bytes", size);
+        running_sum = size;
+        num_digits  = spot - line;
+        bytes_left  = (cur_chunk_size = size);
+        state       = (size == 0) ? CHUNK_READ_TRAILER_BLANK : CHUNK_READ_CHUNK;
+        chunked_reader->consume(lf - tmp + 1);
+        break;
+      }
+    }
+
+    bytes_used = 0;
     while (data_size > 0) {
       bytes_used++;
       if (state == CHUNK_READ_SIZE) {
         // The http spec says the chunked size is always in hex
-        if (ParseRules::is_hex(*tmp)) {
-          num_digits++;
-          running_sum *= 16;
-
-          if (ParseRules::is_digit(*tmp)) {
-            running_sum += *tmp - '0';
-          } else {
-            running_sum += ParseRules::ink_tolower(*tmp) - 'a' + 10;
+        int digit = hex_digit[*tmp];
+        if (digit >= 0) {
+          if (running_sum > CHUNK_SIZE_DIGIT_LIMIT) {
+            // Chunk size too large
+            state = CHUNK_READ_ERROR;
+            done  = true;
+            break;
           }
+          num_digits++;
+          running_sum = running_sum * 16 + digit;
         } else {
           // We are done parsing size
-          if (num_digits == 0 || running_sum < 0) {
+          if (num_digits == 0) {
             // Bogus chunk size
             state = CHUNK_READ_ERROR;
             done  = true;
@@ -172,9 +269,11 @@ ChunkedHandler::read_size()
             state = CHUNK_READ_SIZE_CRLF; // now look for CRLF
           }
         }
-      } else if (state == CHUNK_READ_SIZE_CRLF) { // Scan for a linefeed
+      }
+      // Not an else, a LF right after the digits ends the line.
+      if (state == CHUNK_READ_SIZE_CRLF) { // Scan for a linefeed
         if (ParseRules::is_lf(*tmp)) {
-          Debug("http_chunk", "read chunk size of %d bytes", running_sum);
+          Debug("http_chunk", "read chunk size of %" PRId64 " bytes", running_sum);
           bytes_left = (cur_chunk_size = running_sum);
           state      = (running_sum == 0) ? CHUNK_READ_TRAILER_BLANK : CHUNK_READ_CHUNK;
           done       = true;
@@ -333,7 +432,7 @@ ChunkedHandler::process_chunked_content()
 bool
 ChunkedHandler::generate_chunked_content()
 {
-  char tmp[16];
+  char tmp[min_block_transfer_bytes];
   bool server_done = false;
   int64_t r_avail;
 
@@ -355,7 +454,7 @@ ChunkedHandler::generate_chunked_content()
 
     // Output the chunk size.
     if (write_val != max_chunk_size) {
-      int len = snprintf(tmp, sizeof(tmp), CHUNK_HEADER_FMT, write_val);
+      int len = write_chunk_header(tmp, write_val);
       chunked_buffer->write(tmp, len);
       chunked_size += len;
     } else {
@@ -363,17 +462,15 @@ ChunkedHandler::generate_chunked_content()
       chunked_size += max_chunk_header_len;
     }
 
-    // Output the chunk itself.
-    //
-    // BZ# 54395 Note - we really should only do a
-    //   block transfer if there is sizable amount of
-    //   data (like we do for the case where we are
-    //   removing chunked encoding in ChunkedHandler::transfer_bytes()
-    //   However, I want to do this fix with as small a risk
-    //   as possible so I'm leaving this issue alone for
-    //   now
-    //
-    chunked_buffer->write(dechunked_reader, write_val);
+    // Output the chunk itself. Like ChunkedHandler::transfer_bytes(), a sizable chunk is a
+    // reference to the input blocks, between the small blocks which hold the chunk headers and
+    // CRLFs. A small chunk is copied next to its header rather than adding a block for a few bytes.
+    if (write_val >= min_block_transfer_bytes) {
+      chunked_buffer->write(dechunked_reader, write_val);
+    } else {
+      dechunked_reader->memcpy(tmp, write_val);
+      chunked_buffer->write(tmp, write_val);
+    }
     chunked_size += write_val;
     dechunked_reader->consume(write_val);
 
@@ -416,6 +513,7 @@ HttpTunnelProducer::HttpTunnelProducer()
     alive(false),
     read_success(false),
     flow_control_source(nullptr),
+    fanout_lag(0),
     name(nullptr)
 {
 }
@@ -591,6 +689,7 @@ HttpTunnel::deallocate_buffers()
   int num = 0;
   ink_release_assert(active == false);
   for (auto &producer : producers) {
+    fanout_stop(&producer);
     if (producer.read_buffer != nullptr) {
       ink_assert(producer.vc != nullptr);
       free_MIOBuffer(producer.read_buffer);
@@ -905,6 +1004,10 @@ HttpTunnel::producer_run(HttpTunnelProducer *p)
     }
   }
 
+  if (cache_write_consumer && p->vc_type == HT_HTTP_SERVER && p->num_consumers > 1) {
+    fanout_start(p);
+  }
+
   // YTS Team, yamsat Plugin
   // Allocate and copy partial POST data to buffers. Check for the various parameters
   // including the maximum configured post data size
@@ -1046,6 +1149,50 @@ HttpTunnel::producer_run(HttpTunnelProducer *p)
   p->buffer_start = nullptr;
 }
 
+// void HttpTunnel::fanout_start(HttpTunnelProducer* p)
+//
+//   The server producer @a p feeds both the cache write and the client.
+//   Both read the same buffer, and the producer stops reading once the
+//   slowest reader is a water mark behind, so a slow client holds the
+//   origin connection open and stalls the cache fill. Raise the water
+//   mark, and the flow control marks, by the configured fan out lag so
+//   the origin and the cache write run at full speed until the client
+//   is that far behind.
+//
+void
+HttpTunnel::fanout_start(HttpTunnelProducer *p)
+{
+  HttpConfigParams *params = sm->t_state.http_config_param;
+  int64_t lag              = params->flow_fanout_lag;
+
+  if (lag <= 0 || p->fanout_lag > 0) {
+    return;
+  }
+  int64_t reserved = fanout_reserved.fetch_add(lag) + lag;
+  if (params->flow_fanout_memory_limit > 0 && reserved > params->flow_fanout_memory_limit) {
+    fanout_reserved -= lag;
+    HTTP_INCREMENT_DYN_STAT(http_tunnel_fanout_denied_stat);
+    Debug("http_tunnel", "[%" PRId64 "] fan out denied, %" PRId64 " bytes reserved", sm->sm_id, fanout_reserved.load());
+    return;
+  }
+
+  p->fanout_lag = lag;
+  if (p->read_buffer->water_mark < lag) {
+    p->read_buffer->water_mark = lag;
+  }
+  HTTP_INCREMENT_DYN_STAT(http_tunnel_fanout_stat);
+  Debug("http_tunnel", "[%" PRId64 "] fan out [%s] with a client lag of %" PRId64, sm->sm_id, p->name, lag);
+}
+
+void
+HttpTunnel::fanout_stop(HttpTunnelProducer *p)
+{
+  if (p->fanout_lag > 0) {
+    fanout_reserved -= p->fanout_lag;
+    p->fanout_lag = 0;
+  }
+}
+
 int
 HttpTunnel::producer_handler_dechunked(int event, HttpTunnelProducer *p)
 {
@@ -1295,10 +1442,11 @@ HttpTunnel::consumer_reenable(HttpTunnelConsumer *c)
     // the backlog short cuts quit when the value is equal (or
     // greater) to the target, we use strict comparison only for
     // checking low water, otherwise the flow control can stall out.
-    uint64_t backlog         = (flow_state.enabled_p && p->is_source()) ? p->backlog(flow_state.high_water) : 0;
+    uint64_t high_water      = flow_state.high_water + p->fanout_lag;
+    uint64_t backlog         = (flow_state.enabled_p && p->is_source()) ? p->backlog(high_water) : 0;
     HttpTunnelProducer *srcp = p->flow_control_source;
 
-    if (backlog >= flow_state.high_water) {
+    if (backlog >= high_water) {
       if (is_debug_tag_set("http_tunnel")) {
         Debug("http_tunnel", "Throttle   %p %" PRId64 " / %" PRId64, p, backlog, p->backlog());
       }
@@ -1310,10 +1458,11 @@ HttpTunnel::consumer_reenable(HttpTunnelConsumer *c)
         // for this consumer. We don't have to recompute the backlog
         // if they are the same because we know low water <= high
         // water so the value is sufficiently accurate.
+        uint64_t low_water = flow_state.low_water + srcp->fanout_lag;
         if (srcp != p) {
-          backlog = srcp->backlog(flow_state.low_water);
+          backlog = srcp->backlog(low_water);
         }
-        if (backlog < flow_state.low_water) {
+        if (backlog < low_water) {
           if (is_debug_tag_set("http_tunnel")) {
             Debug("http_tunnel", "Unthrottle %p %" PRId64 " / %" PRId64, p, backlog, p->backlog());
           }
@@ -113,7 +113,7 @@ struct ChunkedHandler {
   int last_server_event;
 
   // Parsing Info
-  int running_sum;
+  int64_t running_sum;
   int num_digits;
 
   /// @name Output data.
@@ -124,7 +124,7 @@ struct ChunkedHandler {
   /// Caching members to avoid using printf on every chunk.
   /// It holds the header for a maximal sized chunk which will cover
   /// almost all output chunks.
-  char max_chunk_header[16];
+  char max_chunk_header[18];
   int max_chunk_header_len;
   //@}
   ChunkedHandler();
@@ -214,6 +214,9 @@ struct HttpTunnelProducer {
   /// If this is set, it points at the source producer that is under flow control.
   /// If @c NULL then data flow is not being throttled.
   HttpTunnelProducer *flow_control_source;
+  /// Bytes the client may fall behind the cache write before it paces this producer.
+  /// Reserved against proxy.config.http.flow_control.fanout_memory_limit while non-zero.
+  int64_t fanout_lag;
   const char *name;
 
   /** Get the largest number of bytes any consumer has not consumed.
@@ -333,6 +336,8 @@ private:
   void finish_all_internal(HttpTunnelProducer *p, bool chain);
   void update_stats_after_abort(HttpTunnelType_t t);
   void producer_run(HttpTunnelProducer *p);
+  void fanout_start(HttpTunnelProducer *p);
+  void fanout_stop(HttpTunnelProducer *p);
 
   HttpTunnelProducer *get_producer(VIO *vio);
   HttpTunnelConsumer *get_consumer(VIO *vio);
@@ -217,7 +217,8 @@ Stripe::Chunk::clear()
 Stripe::Stripe(Span *span, Bytes start, CacheStoreBlocks len) : _span(span), _start(start), _len(len)
 {
   ts::bwprint(hashText, "{} {}:{}", span->_path.path(), _start.count(), _len.count());
-  CryptoContext().hash_immediate(hash_id, hashText.data(), static_cast<int>(hashText.size()));
+  // Stripe ids always use the default hash, the URL hash of the stripe only changes the cache keys.
+  CryptoContext(CryptoContext::UNSPECIFIED).hash_immediate(hash_id, hashText.data(), static_cast<int>(hashText.size()));
   printf("hash id of stripe is hash of %.*s\n", static_cast<int>(hashText.size()), hashText.data());
 }
 
@@ -242,6 +243,7 @@ Stripe::InitializeMeta()
       j.phase = j.cycle = j.sync_serial = j.write_serial = j.dirty = 0;
       j.create_time                                                = time(nullptr);
       j.sector_size                                                = DEFAULT_HW_SECTOR_SIZE;
+      j.url_hash                                                   = CryptoContext::UNSPECIFIED;
     }
   }
   if (!freelist) // freelist is not allocated yet
@@ -868,6 +870,19 @@ Stripe::dir_check()
   ////////////////
 }
 
+CryptoContext::HashType
+Stripe::url_hash_type() const
+{
+  static const size_t SBSIZE = CacheStoreBlocks::SCALE;
+  alignas(SBSIZE) char stripe_buff[SBSIZE];
+  StripeMeta const *meta = reinterpret_cast<StripeMeta const *>(stripe_buff);
+
+  if (pread(_span->_fd, stripe_buff, SBSIZE, _start) < static_cast<ssize_t>(sizeof(StripeMeta)) || !validateMeta(meta)) {
+    return CryptoContext::UNSPECIFIED;
+  }
+  return static_cast<CryptoContext::HashType>(meta->url_hash);
+}
+
 Errata
 Stripe::loadMeta()
 {
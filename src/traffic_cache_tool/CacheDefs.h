@@ -158,7 +158,7 @@ public:
   uint32_t write_serial;
   uint32_t dirty;
   uint32_t sector_size;
-  uint32_t unused; // pad out to 8 byte boundary
+  uint32_t url_hash; // CryptoContext::HashType of the cache keys, zero before this was recorded
   uint16_t freelist[1];
 };
 
@@ -522,6 +522,8 @@ struct Stripe {
 
   /// Load metadata for this stripe.
   Errata loadMeta();
+  /// Read the hash of the cache keys of URLs from header A, @c UNSPECIFIED if it is not recorded.
+  CryptoContext::HashType url_hash_type() const;
   Errata loadDir();
   int check_loop(int s);
   void dir_check();
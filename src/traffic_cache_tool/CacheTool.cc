@@ -202,6 +202,8 @@ struct Cache {
   void dumpVolumes();
   void build_stripe_hash_table();
   Stripe *key_to_stripe(CryptoHash *key, const char *hostname, int host_len);
+  /// The hash of the cache keys of URLs, as recorded by the stripes.
+  CryptoContext::HashType url_hash_type() const;
   //  ts::CacheStripeBlocks calcTotalSpanPhysicalSize();
   ts::CacheStripeBlocks calcTotalSpanConfiguredSize();
 
@@ -1021,6 +1023,19 @@ Cache::key_to_stripe(CryptoHash *key, const char *hostname, int host_len)
   return globalVec_stripe[stripes_hash_table[h]];
 }
 
+CryptoContext::HashType
+Cache::url_hash_type() const
+{
+  // Stripes with another hash than traffic_server is configured with are cleared when it starts, so any stripe will do.
+  for (auto stripe : globalVec_stripe) {
+    CryptoContext::HashType type = stripe->url_hash_type();
+    if (type != CryptoContext::UNSPECIFIED) {
+      return type;
+    }
+  }
+  return CryptoContext::UNSPECIFIED;
+}
+
 /* --------------------------------------------------------------------------------------- */
 Errata
 VolumeConfig::load(FilePath const &path)
@@ -1202,8 +1217,9 @@ Find_Stripe(FilePath const &input_file_path)
   if ((zret = cache.loadSpan(SpanFile))) {
     cache.dumpSpans(Cache::SpanDumpDepth::SPAN);
     cache.build_stripe_hash_table();
+    CryptoContext::HashType url_hash = cache.url_hash_type();
     for (auto host : cache.URLset) {
-      CryptoContext ctx;
+      CryptoContext ctx(url_hash);
       CryptoHash hashT;
       ts::LocalBufferWriter<33> w;
       ctx.update(host->url.data(), host->url.size());
@@ -1331,8 +1347,9 @@ Get_Response(FilePath const &input_file_path)
   if ((zret = cache.loadSpan(SpanFile))) {
     cache.dumpSpans(Cache::SpanDumpDepth::SPAN);
     cache.build_stripe_hash_table();
+    CryptoContext::HashType url_hash = cache.url_hash_type();
     for (auto host : cache.URLset) {
-      CryptoContext ctx;
+      CryptoContext ctx(url_hash);
       CryptoHash hashT;
       ts::LocalBufferWriter<33> w;
       ctx.update(host->url.data(), host->url.size());
@@ -57,6 +57,7 @@
 #include "HttpDebugNames.h"
 #include "I_AIO.h"
 #include "I_Tasks.h"
+#include "I_WorkProcessor.h"
 
 #include "P_OCSPStapling.h"
 #include "records/I_RecDefs.h"
@@ -4428,12 +4429,19 @@ TSContSchedule(TSCont contp, ink_hrtime timeout, TSThreadPool tp)
   case TS_THREAD_POOL_UDP:
     etype = ET_UDP;
     break;
+  case TS_THREAD_POOL_WORK:
+    etype = ET_WORK;
+    break;
   default:
     etype = ET_TASK;
     break;
   }
 
-  if (timeout == 0) {
+  if (tp == TS_THREAD_POOL_WORK) {
+    // Immediate work goes through the work deques, it is moved to an idle thread if needed.
+    action = reinterpret_cast<TSAction>(timeout == 0 ? workProcessor.schedule_imm(i) :
+                                                       workProcessor.schedule_in(i, HRTIME_MSECONDS(timeout)));
+  } else if (timeout == 0) {
     action = reinterpret_cast<TSAction>(eventProcessor.schedule_imm(i, etype));
   } else {
     action = reinterpret_cast<TSAction>(eventProcessor.schedule_in(i, HRTIME_MSECONDS(timeout), etype));
@@ -4468,6 +4476,9 @@ TSContScheduleEvery(TSCont contp, ink_hrtime every, TSThreadPool tp)
   case TS_THREAD_POOL_TASK:
     etype = ET_TASK;
     break;
+  case TS_THREAD_POOL_WORK:
+    etype = ET_WORK;
+    break;
   default:
     etype = ET_TASK;
     break;
@@ -61,6 +61,7 @@ extern "C" int plock(int);
 #include "Main.h"
 #include "tscore/signals.h"
 #include "P_EventSystem.h"
+#include "I_EventTiming.h"
 #include "P_Net.h"
 #include "P_UDPNet.h"
 #include "P_DNS.h"
@@ -92,6 +93,7 @@ extern "C" int plock(int);
 #include "RemapConfig.h"
 #include "RemapProcessor.h"
 #include "I_Tasks.h"
+#include "I_WorkProcessor.h"
 #include "InkAPIInternal.h"
 #include "HTTP2.h"
 #include "tscore/ink_config.h"
@@ -128,6 +130,7 @@ int num_accept_threads = 0;
 
 static int num_of_udp_threads = 0;
 static int num_task_threads   = 0;
+static int num_work_threads   = 0;
 
 static char *http_accept_port_descriptor;
 int http_accept_file_descriptor = NO_FD;
@@ -1634,6 +1637,10 @@ main(int /* argc ATS_UNUSED */, const char **argv)
     REC_ReadConfigInteger(num_task_threads, "proxy.config.task_threads");
   }
 
+  if (!num_work_threads) {
+    REC_ReadConfigInteger(num_work_threads, "proxy.config.work_threads");
+  }
+
   ats_scoped_str user(MAX_LOGIN + 1);
 
   *user        = '\0';
@@ -1971,6 +1978,8 @@ main(int /* argc ATS_UNUSED */, const char **argv)
 
     // "Task" processor, possibly with its own set of task threads
     tasksProcessor.start(num_task_threads, stacksize);
+    // Work stealing pool, on ET_TASK if it has no threads
+    workProcessor.start(num_work_threads, stacksize);
 
     if (netProcessor.socks_conf_stuff->accept_enabled) {
       start_SocksProxy(netProcessor.socks_conf_stuff->accept_port);
@@ -2080,6 +2089,9 @@ mgmt_lifecycle_msg_callback(void *, char *data, int len)
     msg.tag       = tag;
     msg.data      = payload.ptr;
     msg.data_size = payload.len;
+    if (tag && strcmp(tag, "ts.eventloop.dump") == 0) {
+      event_timing_dump();
+    }
     while (hook) {
       TSPluginMsg tmp(msg); // Just to make sure plugins don't mess this up for others.
       hook->invoke(TS_EVENT_LIFECYCLE_MSG, &tmp);
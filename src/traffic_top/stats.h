@@ -31,6 +31,7 @@
 #include <cinttypes>
 #include <sys/time.h>
 #include "mgmtapi.h"
+#include "records/I_RecStatsSegment.h"
 
 struct LookupItem {
   LookupItem(const char *s, const char *n, const int t) : pretty(s), name(n), numerator(""), denominator(""), type(t) {}
@@ -64,8 +65,17 @@ class Stats
   template <class Key, class T> using map = std::map<Key, T>;
 
 public:
-  Stats(const string &url) : _url(url)
+  Stats(const string &url, const string &segment = "") : _url(url)
   {
+    if (segment != "") {
+      // read the stats straight from the shared memory of the local traffic_server
+      _segment = new RecStatsSegmentReader;
+      if (!_segment->open(segment.c_str())) {
+        fprintf(stderr, "Error: can't open the stats segment %s, is proxy.config.stats.segment.enabled set?\n", segment.c_str());
+        exit(1);
+      }
+    }
+
     if (url != "") {
       if (_url.substr(0, 4) != "http") {
         // looks like it is a host using it the old way
@@ -269,7 +279,9 @@ public:
   void
   getStats()
   {
-    if (_url == "") {
+    if (_segment != nullptr) {
+      getSegmentStats();
+    } else if (_url == "") {
       int64_t value = 0;
       if (_old_stats != nullptr) {
         delete _old_stats;
@@ -359,6 +371,45 @@ public:
     }
   }
 
+  void
+  getSegmentStats()
+  {
+    if (!_segment->reopen_if_replaced() || !_segment->snapshot()) {
+      // traffic_server is gone or busy, keep showing the last values
+      return;
+    }
+    if (_old_stats != nullptr) {
+      delete _old_stats;
+      _old_stats = nullptr;
+    }
+    _old_stats = _stats;
+    _stats     = new map<string, string>;
+
+    gettimeofday(&_time, nullptr);
+    double now = _time.tv_sec + (double)_time.tv_usec / 1000000;
+
+    for (map<string, LookupItem>::const_iterator lookup_it = lookup_table.begin(); lookup_it != lookup_table.end(); ++lookup_it) {
+      const LookupItem &item = lookup_it->second;
+
+      if (item.type == 1 || item.type == 2 || item.type == 5 || item.type == 8) {
+        int idx = _segment->find(item.name);
+        if (idx < 0) {
+          continue;
+        }
+        if (_segment->type(idx) == RECD_STRING) {
+          (*_stats)[item.name] = _segment->get_string(idx);
+        } else {
+          char buffer[32];
+          sprintf(buffer, "%" PRId64, _segment->get_int(idx));
+          (*_stats)[item.name] = buffer;
+        }
+      }
+    }
+    _old_time  = _now;
+    _now       = now;
+    _time_diff = _now - _old_time;
+  }
+
   int64_t
   getValue(const string &key, const map<string, string> *stats) const
   {
@@ -382,7 +433,7 @@ public:
   getStat(const string &key, string &value)
   {
     map<string, LookupItem>::const_iterator lookup_it = lookup_table.find(key);
-    assert(lookup_it != lookup_table.end());
+    ink_assert(lookup_it != lookup_table.end());
     const LookupItem &item = lookup_it->second;
 
     map<string, string>::const_iterator stats_it = _stats->find(item.name);
@@ -397,7 +448,7 @@ public:
   getStat(const string &key, double &value, string &prettyName, int &type, int overrideType = 0)
   {
     map<string, LookupItem>::const_iterator lookup_it = lookup_table.find(key);
-    assert(lookup_it != lookup_table.end());
+    ink_assert(lookup_it != lookup_table.end());
     const LookupItem &item = lookup_it->second;
     prettyName             = item.pretty;
     if (overrideType != 0) {
@@ -522,6 +573,7 @@ public:
     if (_old_stats != nullptr) {
       delete _old_stats;
     }
+    delete _segment;
   }
 
 private:
@@ -534,6 +586,7 @@ private:
   map<string, string> *_stats;
   map<string, string> *_old_stats;
   map<string, LookupItem> lookup_table;
+  RecStatsSegmentReader *_segment = nullptr;
   string _url;
   string _host;
   double _old_time;
@@ -387,20 +387,23 @@ int
 main(int argc, const char **argv)
 {
 #if HAS_CURL
-  static const char USAGE[] = "Usage: traffic_top [-s seconds] [URL|hostname|hostname:port]";
+  static const char USAGE[] = "Usage: traffic_top [-s seconds] [-m] [URL|hostname|hostname:port]";
 #else
-  static const char USAGE[] = "Usage: traffic_top [-s seconds]";
+  static const char USAGE[] = "Usage: traffic_top [-s seconds] [-m]";
 #endif
 
-  int sleep_time = 6; // In seconds
-  bool absolute  = false;
+  int sleep_time  = 6; // In seconds
+  int use_segment = 0;
+  bool absolute   = false;
   string url;
+  string segment;
 
   AppVersionInfo version;
   version.setup(PACKAGE_NAME, "traffic_top", PACKAGE_VERSION, __DATE__, __TIME__, BUILD_MACHINE, BUILD_PERSON, "");
 
   const ArgumentDescription argument_descriptions[] = {
     {"sleep", 's', "Sets the delay between updates (in seconds)", "I", &sleep_time, nullptr, nullptr},
+    {"segment", 'm', "Read the stats from the shared memory segment of the local traffic_server", "F", &use_segment, nullptr, nullptr},
     HELP_ARGUMENT_DESCRIPTION(),
     VERSION_ARGUMENT_DESCRIPTION(),
     RUNROOT_ARGUMENT_DESCRIPTION(),
@@ -417,6 +420,11 @@ main(int argc, const char **argv)
   case 0: {
     ats_scoped_str rundir(RecConfigReadRuntimeDir());
 
+    if (use_segment) {
+      segment = string(rundir) + "/" + REC_STATS_SEGMENT_FILE;
+      break;
+    }
+
     TSMgmtError err = TSInit(rundir, static_cast<TSInitOptionT>(TS_MGMT_OPT_NO_EVENTS | TS_MGMT_OPT_NO_SOCK_TESTS));
     if (err != TS_ERR_OKAY) {
       fprintf(stderr, "Error: connecting to local manager: %s\n", TSGetErrorMessage(err));
@@ -437,7 +445,7 @@ main(int argc, const char **argv)
     usage(argument_descriptions, countof(argument_descriptions), USAGE);
   }
 
-  Stats stats(url);
+  Stats stats(url, segment);
   stats.getStats();
   const string &host = stats.getHost();
 
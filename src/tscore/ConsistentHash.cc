@@ -20,6 +20,7 @@
  */
 
 #include "tscore/ConsistentHash.h"
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <sstream>
@@ -27,13 +28,132 @@
 #include <climits>
 #include <cstdio>
 
+namespace
+{
+// Buckets per unit of weight for the JUMP algorithm.
+constexpr int JUMP_BUCKETS_PER_WEIGHT = 10;
+// Minimum MAGLEV table entries per node, the table size is the next prime.
+constexpr size_t MAGLEV_ENTRIES_PER_NODE = 100;
+
+// Branch free lower bound in [base, base + len), the loop has a fixed trip count for a given
+// length and the compiler turns the comparison into a conditional move.
+inline size_t
+lower_bound_branchless(const uint64_t *base, size_t len, uint64_t key)
+{
+  const uint64_t *first = base;
+
+  if (len == 0) {
+    return 0;
+  }
+  while (len > 1) {
+    size_t half = len / 2;
+    base += (base[half - 1] < key) ? half : 0;
+    len -= half;
+  }
+  return (base - first) + (*base < key);
+}
+
+// The ring points are hash values and uniformly distributed, so the position of a key can be
+// guessed. The guess is bracketed with exponentially growing steps, which usually touches only
+// a cache line or two, and the bracket is searched.
+inline size_t
+lower_bound_index(const std::vector<uint64_t> &v, uint64_t key)
+{
+  size_t n = v.size();
+  size_t lo, hi, step = 1;
+
+  if (n == 0) {
+    return 0;
+  }
+
+  size_t guess = static_cast<size_t>(((key >> 32) * static_cast<uint64_t>(n)) >> 32);
+  if (v[guess] < key) {
+    lo = hi = guess + 1;
+    while (hi < n && v[hi] < key) {
+      lo = hi + 1;
+      hi += step;
+      step <<= 1;
+    }
+    hi = std::min(hi, n);
+  } else {
+    lo = hi = guess;
+    while (lo > 0 && v[lo - 1] >= key) {
+      hi = lo - 1;
+      lo = lo > step ? lo - step : 0;
+      step <<= 1;
+    }
+  }
+  // All values before lo are less than the key, the value at hi (if any) is not.
+  return lo + lower_bound_branchless(v.data() + lo, hi - lo, key);
+}
+
+inline uint64_t
+mix64(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+inline size_t
+gcd(size_t a, size_t b)
+{
+  while (b != 0) {
+    size_t t = a % b;
+    a        = b;
+    b        = t;
+  }
+  return a;
+}
+
+bool
+is_prime(size_t n)
+{
+  if (n < 2) {
+    return false;
+  }
+  for (size_t d = 2; d * d <= n; ++d) {
+    if (n % d == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Lamping and Veach.
+inline size_t
+jump_consistent_hash(uint64_t key, size_t buckets)
+{
+  int64_t b = -1, j = 0;
+
+  while (j < static_cast<int64_t>(buckets)) {
+    b   = j;
+    key = key * 2862933555777941757ULL + 1;
+    j   = static_cast<int64_t>((b + 1) * (static_cast<double>(1LL << 31) / static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<size_t>(b);
+}
+
+std::string
+node_name(ATSConsistentHashNode *node)
+{
+  std::ostringstream string_stream;
+
+  string_stream << *node;
+  return string_stream.str();
+}
+} // namespace
+
 std::ostream &
 operator<<(std::ostream &os, ATSConsistentHashNode &thing)
 {
   return os << thing.name;
 }
 
-ATSConsistentHash::ATSConsistentHash(int r, ATSHash64 *h) : replicas(r), hash(h) {}
+ATSConsistentHash::ATSConsistentHash(int r, ATSHash64 *h, ATSConsistentHashAlgorithm a) : replicas(r), hash(h), algo(a) {}
 
 void
 ATSConsistentHash::insert(ATSConsistentHashNode *node, float weight, ATSHash64 *h)
@@ -41,7 +161,6 @@ ATSConsistentHash::insert(ATSConsistentHashNode *node, float weight, ATSHash64 *
   int i;
   char numstr[256];
   ATSHash64 *thash;
-  std::ostringstream string_stream;
   std::string std_string;
 
   if (h) {
@@ -52,17 +171,196 @@ ATSConsistentHash::insert(ATSConsistentHashNode *node, float weight, ATSHash64 *
     return;
   }
 
-  string_stream << *node;
-  std_string = string_stream.str();
+  if (algo != ATS_CONSISTENT_HASH_RING) {
+    Nodes.push_back(node);
+    Weights.push_back(weight);
+    if (algo == ATS_CONSISTENT_HASH_JUMP) {
+      int buckets = std::max(1, static_cast<int>(roundf(weight * JUMP_BUCKETS_PER_WEIGHT)));
+      JumpBuckets.insert(JumpBuckets.end(), buckets, static_cast<uint32_t>(Nodes.size() - 1));
+    }
+    return;
+  }
+
+  std_string = node_name(node);
 
+  std::vector<std::pair<uint64_t, ATSConsistentHashNode *>> added;
   for (i = 0; i < (int)roundf(replicas * weight); i++) {
     snprintf(numstr, 256, "%d-", i);
     thash->update(numstr, strlen(numstr));
     thash->update(std_string.c_str(), strlen(std_string.c_str()));
     thash->final();
-    NodeMap.insert(std::pair<uint64_t, ATSConsistentHashNode *>(thash->get(), node));
+    added.emplace_back(thash->get(), node);
+    thash->clear();
+  }
+  std::stable_sort(added.begin(), added.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  // Merge into the ring. Like inserting into a map, the first node to claim a hash value keeps it.
+  std::vector<uint64_t> hashes;
+  std::vector<ATSConsistentHashNode *> nodes;
+  size_t o = 0, n = 0;
+
+  hashes.reserve(RingHashes.size() + added.size());
+  nodes.reserve(RingHashes.size() + added.size());
+  while (o < RingHashes.size() || n < added.size()) {
+    uint64_t value;
+    ATSConsistentHashNode *owner;
+
+    if (n == added.size() || (o < RingHashes.size() && RingHashes[o] <= added[n].first)) {
+      value = RingHashes[o];
+      owner = RingNodes[o++];
+    } else {
+      value = added[n].first;
+      owner = added[n++].second;
+    }
+    if (hashes.empty() || hashes.back() != value) {
+      hashes.push_back(value);
+      nodes.push_back(owner);
+    }
+  }
+  RingHashes.swap(hashes);
+  RingNodes.swap(nodes);
+}
+
+void
+ATSConsistentHash::build(ATSHash64 *h)
+{
+  ATSHash64 *thash = h ? h : hash;
+
+  if (algo != ATS_CONSISTENT_HASH_MAGLEV || Nodes.empty() || thash == nullptr) {
+    return;
+  }
+
+  size_t size = std::max(Nodes.size() * MAGLEV_ENTRIES_PER_NODE, static_cast<size_t>(101));
+  while (!is_prime(size)) {
+    ++size;
+  }
+
+  std::vector<size_t> offset(Nodes.size()), skip(Nodes.size()), next(Nodes.size(), 0);
+  std::vector<float> credit(Nodes.size(), 0);
+  float max_weight = *std::max_element(Weights.begin(), Weights.end());
+
+  for (size_t i = 0; i < Nodes.size(); ++i) {
+    std::string name = node_name(Nodes[i]);
+
+    thash->update(name.c_str(), name.size());
+    thash->final();
+    uint64_t value = thash->get();
     thash->clear();
+
+    offset[i] = value % size;
+    skip[i]   = (value >> 32) % (size - 1) + 1;
+  }
+
+  // Every node takes turns claiming its next free preferred entry, a node with half the
+  // weight of the heaviest node gets every other turn.
+  MaglevTable.assign(size, UINT32_MAX);
+  size_t filled = 0;
+  while (filled < size) {
+    for (size_t i = 0; i < Nodes.size() && filled < size; ++i) {
+      credit[i] += max_weight > 0 ? Weights[i] / max_weight : 1.0;
+      if (credit[i] < 1.0) {
+        continue;
+      }
+      credit[i] -= 1.0;
+
+      size_t c = (offset[i] + next[i] * skip[i]) % size;
+      while (MaglevTable[c] != UINT32_MAX) {
+        ++next[i];
+        c = (offset[i] + next[i] * skip[i]) % size;
+      }
+      MaglevTable[c] = static_cast<uint32_t>(i);
+      ++next[i];
+      ++filled;
+    }
+  }
+}
+
+size_t
+ATSConsistentHash::slots() const
+{
+  switch (algo) {
+  case ATS_CONSISTENT_HASH_MAGLEV:
+    return MaglevTable.empty() ? 0 : Nodes.size();
+  case ATS_CONSISTENT_HASH_JUMP:
+    return JumpBuckets.size();
+  case ATS_CONSISTENT_HASH_RING:
+  default:
+    return RingHashes.size();
+  }
+}
+
+ATSConsistentHashNode *
+ATSConsistentHash::slot_node(size_t slot) const
+{
+  switch (algo) {
+  case ATS_CONSISTENT_HASH_MAGLEV:
+    return Nodes[slot];
+  case ATS_CONSISTENT_HASH_JUMP:
+    return Nodes[JumpBuckets[slot]];
+  case ATS_CONSISTENT_HASH_RING:
+  default:
+    return RingNodes[slot];
+  }
+}
+
+size_t
+ATSConsistentHash::positions() const
+{
+  size_t n = slots();
+
+  // MAGLEV, JUMP: the first choice, followed by all slots.
+  return (algo == ATS_CONSISTENT_HASH_RING || n == 0) ? n : n + 1;
+}
+
+void
+ATSConsistentHash::start(uint64_t hashval, ATSConsistentHashIter *iter) const
+{
+  size_t n = slots();
+
+  if (algo == ATS_CONSISTENT_HASH_RING) {
+    iter->pos = lower_bound_index(RingHashes, hashval);
+    return;
+  }
+
+  iter->pos     = 0;
+  iter->first   = 0;
+  iter->offset  = 0;
+  iter->stride  = 0;
+  iter->hashval = hashval;
+  if (n == 0) {
+    return;
   }
+
+  iter->first = algo == ATS_CONSISTENT_HASH_MAGLEV ? MaglevTable[hashval % MaglevTable.size()] : jump_consistent_hash(hashval, n);
+}
+
+ATSConsistentHashNode *
+ATSConsistentHash::current(ATSConsistentHashIter *iter) const
+{
+  if (algo == ATS_CONSISTENT_HASH_RING) {
+    return RingNodes[iter->pos];
+  }
+  if (iter->pos == 0) {
+    return slot_node(iter->first);
+  }
+
+  size_t n = slots();
+  if (iter->stride == 0) {
+    // The next choices start at a random slot, so the keys of a down node are spread over all
+    // other nodes. Any stride coprime to the number of slots visits every slot once. This is
+    // only needed if the first choice is not available.
+    uint64_t r   = mix64(iter->hashval);
+    iter->offset = r % n;
+    iter->stride = 1;
+    if (n > 2) {
+      size_t stride = 1 + (r >> 32) % (n - 1);
+      while (gcd(stride, n) != 1) {
+        stride = stride % (n - 1) + 1;
+      }
+      iter->stride = stride;
+    }
+  }
+  return slot_node((iter->offset + (iter->pos - 1) * iter->stride) % n);
 }
 
 ATSConsistentHashNode *
@@ -72,6 +370,7 @@ ATSConsistentHash::lookup(const char *url, ATSConsistentHashIter *i, bool *w, AT
   ATSConsistentHashIter NodeMapIterUp, *iter;
   ATSHash64 *thash;
   bool *wptr, wrapped = false;
+  size_t end = positions();
 
   if (h) {
     thash = h;
@@ -99,26 +398,26 @@ ATSConsistentHash::lookup(const char *url, ATSConsistentHashIter *i, bool *w, AT
     url_hash = thash->get();
     thash->clear();
 
-    *iter = NodeMap.lower_bound(url_hash);
+    start(url_hash, iter);
 
-    if (*iter == NodeMap.end()) {
-      *wptr = true;
-      *iter = NodeMap.begin();
+    if (iter->pos >= end) {
+      *wptr     = true;
+      iter->pos = 0;
     }
   } else {
-    (*iter)++;
+    iter->pos++;
   }
 
-  if (!(*wptr) && *iter == NodeMap.end()) {
-    *wptr = true;
-    *iter = NodeMap.begin();
+  if (!(*wptr) && iter->pos >= end) {
+    *wptr     = true;
+    iter->pos = 0;
   }
 
-  if (*wptr && *iter == NodeMap.end()) {
+  if (*wptr && iter->pos >= end) {
     return nullptr;
   }
 
-  return (*iter)->second;
+  return current(iter);
 }
 
 ATSConsistentHashNode *
@@ -128,6 +427,7 @@ ATSConsistentHash::lookup_available(const char *url, ATSConsistentHashIter *i, b
   ATSConsistentHashIter NodeMapIterUp, *iter;
   ATSHash64 *thash;
   bool *wptr, wrapped = false;
+  size_t end = positions();
 
   if (h) {
     thash = h;
@@ -149,32 +449,36 @@ ATSConsistentHash::lookup_available(const char *url, ATSConsistentHashIter *i, b
     iter = &NodeMapIterUp;
   }
 
+  if (end == 0) {
+    return nullptr;
+  }
+
   if (url) {
     thash->update(url, strlen(url));
     thash->final();
     url_hash = thash->get();
     thash->clear();
 
-    *iter = NodeMap.lower_bound(url_hash);
+    start(url_hash, iter);
   }
 
-  if (*iter == NodeMap.end()) {
-    *wptr = true;
-    *iter = NodeMap.begin();
+  if (iter->pos >= end) {
+    *wptr     = true;
+    iter->pos = 0;
   }
 
-  while (!(*iter)->second->available) {
-    (*iter)++;
+  while (!current(iter)->available) {
+    iter->pos++;
 
-    if (!(*wptr) && *iter == NodeMap.end()) {
-      *wptr = true;
-      *iter = NodeMap.begin();
-    } else if (*wptr && *iter == NodeMap.end()) {
+    if (!(*wptr) && iter->pos >= end) {
+      *wptr     = true;
+      iter->pos = 0;
+    } else if (*wptr && iter->pos >= end) {
       return nullptr;
     }
   }
 
-  return (*iter)->second;
+  return current(iter);
 }
 
 ATSConsistentHashNode *
@@ -182,6 +486,7 @@ ATSConsistentHash::lookup_by_hashval(uint64_t hashval, ATSConsistentHashIter *i,
 {
   ATSConsistentHashIter NodeMapIterUp, *iter;
   bool *wptr, wrapped = false;
+  size_t end = positions();
 
   if (w) {
     wptr = w;
@@ -195,14 +500,18 @@ ATSConsistentHash::lookup_by_hashval(uint64_t hashval, ATSConsistentHashIter *i,
     iter = &NodeMapIterUp;
   }
 
-  *iter = NodeMap.lower_bound(hashval);
+  if (end == 0) {
+    return nullptr;
+  }
+
+  start(hashval, iter);
 
-  if (*iter == NodeMap.end()) {
-    *wptr = true;
-    *iter = NodeMap.begin();
+  if (iter->pos >= end) {
+    *wptr     = true;
+    iter->pos = 0;
   }
 
-  return (*iter)->second;
+  return current(iter);
 }
 
 ATSConsistentHash::~ATSConsistentHash()
@@ -9,6 +9,7 @@ https://github.com/floodyberry/siphash
  */
 
 #include "tscore/HashSip.h"
+#include <algorithm>
 #include <cstring>
 
 using namespace std;
@@ -139,3 +140,97 @@ ATSHash64Sip24::clear()
   total_len        = 0;
   block_buffer_len = 0;
 }
+
+SipHashContext::SipHashContext()
+{
+  this->init(0, 0);
+}
+
+SipHashContext::SipHashContext(const unsigned char key[16])
+{
+  this->init(U8TO64_LE(key), U8TO64_LE(key + sizeof(uint64_t)));
+}
+
+void
+SipHashContext::init(uint64_t k0, uint64_t k1)
+{
+  // The 128 bit variant differs from the 64 bit one in the initial v1 and in the finalization.
+  v0               = k0 ^ 0x736f6d6570736575ull;
+  v1               = k1 ^ 0x646f72616e646f6dull ^ 0xee;
+  v2               = k0 ^ 0x6c7967656e657261ull;
+  v3               = k1 ^ 0x7465646279746573ull;
+  total_len        = 0;
+  block_buffer_len = 0;
+}
+
+bool
+SipHashContext::update(void const *data, int length)
+{
+  const unsigned char *m = static_cast<const unsigned char *>(data);
+  const unsigned char *e = m + length;
+  uint64_t x0 = v0, x1 = v1, x2 = v2, x3 = v3;
+  uint64_t mi;
+
+  total_len += length;
+
+  if (block_buffer_len > 0) {
+    int n = std::min<int>(SIP_BLOCK_SIZE - block_buffer_len, length);
+    memcpy(block_buffer + block_buffer_len, m, n);
+    block_buffer_len += n;
+    m += n;
+    if (block_buffer_len < SIP_BLOCK_SIZE) {
+      return true;
+    }
+    mi = U8TO64_LE(block_buffer);
+    x3 ^= mi;
+    SIPCOMPRESS(x0, x1, x2, x3);
+    SIPCOMPRESS(x0, x1, x2, x3);
+    x0 ^= mi;
+    block_buffer_len = 0;
+  }
+
+  for (; e - m >= SIP_BLOCK_SIZE; m += SIP_BLOCK_SIZE) {
+    mi = U8TO64_LE(m);
+    x3 ^= mi;
+    SIPCOMPRESS(x0, x1, x2, x3);
+    SIPCOMPRESS(x0, x1, x2, x3);
+    x0 ^= mi;
+  }
+
+  block_buffer_len = e - m;
+  memcpy(block_buffer, m, block_buffer_len);
+
+  v0 = x0;
+  v1 = x1;
+  v2 = x2;
+  v3 = x3;
+  return true;
+}
+
+bool
+SipHashContext::finalize(CryptoHash &hash)
+{
+  uint64_t last7 = total_len << 56;
+
+  for (int i = block_buffer_len - 1; i >= 0; i--) {
+    last7 |= static_cast<uint64_t>(block_buffer[i]) << (i * 8);
+  }
+
+  v3 ^= last7;
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  v0 ^= last7;
+  v2 ^= 0xee;
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  hash.u64[0] = v0 ^ v1 ^ v2 ^ v3;
+  v1 ^= 0xdd;
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  SIPCOMPRESS(v0, v1, v2, v3);
+  hash.u64[1] = v0 ^ v1 ^ v2 ^ v3;
+  return true;
+}
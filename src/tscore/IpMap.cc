@@ -1,6 +1,9 @@
 #include "tscore/IpMap.h"
 #include "tscore/ink_inet.h"
 
+#include <algorithm>
+#include <vector>
+
 /** @file
     IP address map support.
 
@@ -560,8 +563,10 @@ namespace detail
         y = n;
         n = next(n);
         this->remove(y);
-      } else if (n->_min <= max) { // skew overlap different payload
-        n->setMin(max_plus);
+      } else { // skew overlap or adj., different payload
+        if (n->_min <= max) {
+          n->setMin(max_plus);
+        }
         break;
       }
     }
@@ -1065,6 +1070,165 @@ namespace detail
   {
     friend class ::IpMap;
   };
+
+  //----------------------------------------------------------------------------
+  /// IPv6 address as an integer in host order, for the frozen map.
+  struct Ip6Key {
+    uint64_t _hi;
+    uint64_t _lo;
+
+    Ip6Key() = default;
+    explicit Ip6Key(sockaddr_in6 const &addr)
+    {
+      uint8_t const *b = addr.sin6_addr.s6_addr;
+      _hi = _lo = 0;
+      for (int i = 0; i < 8; ++i) {
+        _hi = (_hi << 8) | b[i];
+        _lo = (_lo << 8) | b[i + 8];
+      }
+    }
+  };
+
+  inline bool
+  operator<(Ip6Key const &lhs, Ip6Key const &rhs)
+  {
+    return lhs._hi < rhs._hi || (lhs._hi == rhs._hi && lhs._lo < rhs._lo);
+  }
+
+  inline bool
+  operator<=(Ip6Key const &lhs, Ip6Key const &rhs)
+  {
+    return !(rhs < lhs);
+  }
+
+  /// @return The number of leading bits @a lhs and @a rhs have in common.
+  inline unsigned
+  common_prefix(uint32_t lhs, uint32_t rhs)
+  {
+    return lhs == rhs ? 32 : __builtin_clz(lhs ^ rhs);
+  }
+
+  inline unsigned
+  common_prefix(Ip6Key const &lhs, Ip6Key const &rhs)
+  {
+    if (lhs._hi != rhs._hi) {
+      return __builtin_clzll(lhs._hi ^ rhs._hi);
+    }
+    return lhs._lo == rhs._lo ? 128 : 64 + __builtin_clzll(lhs._lo ^ rhs._lo);
+  }
+
+  /// @return The @a n bits of @a key after the first @a skip bits, @a n > 0.
+  inline unsigned
+  key_bits(uint32_t key, unsigned skip, unsigned n)
+  {
+    return static_cast<uint32_t>(key << skip) >> (32 - n);
+  }
+
+  inline unsigned
+  key_bits(Ip6Key const &key, unsigned skip, unsigned n)
+  {
+    uint64_t window;
+    if (skip == 0) {
+      window = key._hi;
+    } else if (skip < 64) {
+      window = (key._hi << skip) | (key._lo >> (64 - skip));
+    } else {
+      window = key._lo << (skip - 64);
+    }
+    return window >> (64 - n);
+  }
+
+  /** Disjoint ranges of keys in sorted flat arrays, for lookup only.
+
+      The ranges are bucketed by the bits of their minimum which follow the prefix common to all
+      minimums, with about as many buckets as ranges. A lookup indexes the bucket and does a binary
+      search of the few minimums in it. The range which holds a key is the last one which starts at
+      or before it, possibly the last range of an earlier bucket.
+  */
+  template <typename K> class FrozenSpans
+  {
+  public:
+    static constexpr unsigned MAX_INDEX_BITS = 16;
+
+    /// Add a range, in increasing order.
+    void
+    add(K const &min, K const &max, void *data)
+    {
+      _min.push_back(min);
+      _max.push_back(max);
+      _data.push_back(data);
+    }
+
+    /// Build the bucket index, after all ranges are added.
+    void
+    build()
+    {
+      size_t n = _min.size();
+
+      _bits = 0;
+      while (_bits < MAX_INDEX_BITS && (size_t(2) << _bits) <= n) {
+        ++_bits;
+      }
+      if (_bits == 0) {
+        return;
+      }
+      _skip = std::min(common_prefix(_min.front(), _min.back()), static_cast<unsigned>(sizeof(K) * 8) - _bits);
+
+      size_t buckets = size_t(1) << _bits;
+      _index.resize(buckets + 1);
+      size_t i = 0;
+      for (size_t b = 0; b < buckets; ++b) {
+        while (i < n && key_bits(_min[i], _skip, _bits) < b) {
+          ++i;
+        }
+        _index[b] = i;
+      }
+      _index[buckets] = n;
+    }
+
+    bool
+    contains(K const &key, void **ptr) const
+    {
+      size_t i;
+
+      if (_min.empty() || key < _min.front()) {
+        return false;
+      }
+      if (_min.back() <= key) {
+        i = _min.size() - 1;
+      } else if (_bits == 0) {
+        i = 0;
+      } else {
+        // Between the first and last minimums, so the key has their common prefix.
+        unsigned b = key_bits(key, _skip, _bits);
+        auto spot  = std::upper_bound(_min.begin() + _index[b], _min.begin() + _index[b + 1], key);
+        i          = (spot - _min.begin()) - 1;
+      }
+      if (key <= _max[i]) {
+        if (ptr) {
+          *ptr = _data[i];
+        }
+        return true;
+      }
+      return false;
+    }
+
+  private:
+    std::vector<K> _min;
+    std::vector<K> _max;
+    std::vector<void *> _data;
+    std::vector<uint32_t> _index; ///< First range of each bucket, and the range count.
+    unsigned _skip = 0;           ///< Leading bits common to all minimums.
+    unsigned _bits = 0;           ///< Bits of the bucket index.
+  };
+
+  /// The frozen form of an @c IpMap.
+  class IpMapFrozen
+  {
+  public:
+    FrozenSpans<uint32_t> _v4; ///< Host order addresses.
+    FrozenSpans<Ip6Key> _v6;
+  };
 } // namespace detail
 } // namespace ts
 //----------------------------------------------------------------------------
@@ -1072,6 +1236,7 @@ IpMap::~IpMap()
 {
   delete _m4;
   delete _m6;
+  delete _frozen;
 }
 
 inline ts::detail::Ip4Map *
@@ -1097,9 +1262,17 @@ IpMap::contains(sockaddr const *target, void **ptr) const
 {
   bool zret = false;
   if (AF_INET == target->sa_family) {
-    zret = _m4 && _m4->contains(ntohl(ats_ip4_addr_cast(target)), ptr);
+    if (_frozen) {
+      zret = _frozen->_v4.contains(ntohl(ats_ip4_addr_cast(target)), ptr);
+    } else {
+      zret = _m4 && _m4->contains(ntohl(ats_ip4_addr_cast(target)), ptr);
+    }
   } else if (AF_INET6 == target->sa_family) {
-    zret = _m6 && _m6->contains(ats_ip6_cast(target), ptr);
+    if (_frozen) {
+      zret = _frozen->_v6.contains(ts::detail::Ip6Key(*ats_ip6_cast(target)), ptr);
+    } else {
+      zret = _m6 && _m6->contains(ats_ip6_cast(target), ptr);
+    }
   }
   return zret;
 }
@@ -1107,6 +1280,9 @@ IpMap::contains(sockaddr const *target, void **ptr) const
 bool
 IpMap::contains(in_addr_t target, void **ptr) const
 {
+  if (_frozen) {
+    return _frozen->_v4.contains(ntohl(target), ptr);
+  }
   return _m4 && _m4->contains(ntohl(target), ptr);
 }
 
@@ -1114,6 +1290,7 @@ IpMap &
 IpMap::mark(sockaddr const *min, sockaddr const *max, void *data)
 {
   ink_assert(min->sa_family == max->sa_family);
+  this->thaw();
   if (AF_INET == min->sa_family) {
     this->force4()->mark(ntohl(ats_ip4_addr_cast(min)), ntohl(ats_ip4_addr_cast(max)), data);
   } else if (AF_INET6 == min->sa_family) {
@@ -1125,6 +1302,7 @@ IpMap::mark(sockaddr const *min, sockaddr const *max, void *data)
 IpMap &
 IpMap::mark(in_addr_t min, in_addr_t max, void *data)
 {
+  this->thaw();
   this->force4()->mark(ntohl(min), ntohl(max), data);
   return *this;
 }
@@ -1133,6 +1311,7 @@ IpMap &
 IpMap::unmark(sockaddr const *min, sockaddr const *max)
 {
   ink_assert(min->sa_family == max->sa_family);
+  this->thaw();
   if (AF_INET == min->sa_family) {
     if (_m4) {
       _m4->unmark(ntohl(ats_ip4_addr_cast(min)), ntohl(ats_ip4_addr_cast(max)));
@@ -1148,6 +1327,7 @@ IpMap::unmark(sockaddr const *min, sockaddr const *max)
 IpMap &
 IpMap::unmark(in_addr_t min, in_addr_t max)
 {
+  this->thaw();
   if (_m4) {
     _m4->unmark(ntohl(min), ntohl(max));
   }
@@ -1158,6 +1338,7 @@ IpMap &
 IpMap::fill(sockaddr const *min, sockaddr const *max, void *data)
 {
   ink_assert(min->sa_family == max->sa_family);
+  this->thaw();
   if (AF_INET == min->sa_family) {
     this->force4()->fill(ntohl(ats_ip4_addr_cast(min)), ntohl(ats_ip4_addr_cast(max)), data);
   } else if (AF_INET6 == min->sa_family) {
@@ -1169,6 +1350,7 @@ IpMap::fill(sockaddr const *min, sockaddr const *max, void *data)
 IpMap &
 IpMap::fill(in_addr_t min, in_addr_t max, void *data)
 {
+  this->thaw();
   this->force4()->fill(ntohl(min), ntohl(max), data);
   return *this;
 }
@@ -1189,6 +1371,7 @@ IpMap::getCount() const
 IpMap &
 IpMap::clear()
 {
+  this->thaw();
   if (_m4) {
     _m4->clear();
   }
@@ -1198,6 +1381,34 @@ IpMap::clear()
   return *this;
 }
 
+IpMap &
+IpMap::freeze()
+{
+  ts::detail::IpMapFrozen *frozen = new ts::detail::IpMapFrozen;
+
+  // Iteration is in address order, IPv4 first.
+  for (auto &node : *this) {
+    if (AF_INET == node.min()->sa_family) {
+      frozen->_v4.add(ntohl(ats_ip4_addr_cast(node.min())), ntohl(ats_ip4_addr_cast(node.max())), node.data());
+    } else {
+      frozen->_v6.add(ts::detail::Ip6Key(*ats_ip6_cast(node.min())), ts::detail::Ip6Key(*ats_ip6_cast(node.max())), node.data());
+    }
+  }
+  frozen->_v4.build();
+  frozen->_v6.build();
+
+  delete _frozen;
+  _frozen = frozen;
+  return *this;
+}
+
+void
+IpMap::thaw()
+{
+  delete _frozen;
+  _frozen = nullptr;
+}
+
 IpMap::iterator
 IpMap::begin() const
 {
@@ -0,0 +1,102 @@
+/** @file
+
+  Micro benchmark of cache key generation with each CryptoContext hash.
+
+  Hashes random URL strings the way url_CryptoHash_get() does, the URL text and then the port,
+  and reports the time per key.
+
+    benchmark_CryptoHash [keys [URL length]]
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "tscore/CryptoHash.h"
+#include "tscore/ink_hrtime.h"
+
+#include <cinttypes>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+int n_keys     = 2000000;
+int url_length = 80;
+
+// Hash all @a urls with the current CryptoContext setting, @return the time per key in ns.
+double
+generate(std::vector<std::string> const &urls, uint64_t &check)
+{
+  uint16_t port    = 80;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (auto const &url : urls) {
+    CryptoHash hash;
+    CryptoContext ctx;
+    ctx.update(url.data(), url.size());
+    ctx.update(&port, sizeof(port));
+    ctx.finalize(hash);
+    check ^= hash.fold();
+  }
+  return static_cast<double>(ink_get_hrtime_internal() - start) / urls.size();
+}
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  if (argc > 1) {
+    n_keys = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    url_length = atoi(argv[2]);
+  }
+
+  static char const chars[] = "abcdefghijklmnopqrstuvwxyz0123456789-_/.";
+  std::mt19937_64 rng(1);
+  std::vector<std::string> urls(n_keys);
+  for (auto &url : urls) {
+    url = "http://@www.example.com/";
+    while (static_cast<int>(url.size()) < url_length) {
+      url += chars[rng() % (sizeof(chars) - 1)];
+    }
+    url += ";?";
+  }
+
+  struct {
+    CryptoContext::HashType type;
+    char const *name;
+  } const types[] = {
+#if TS_ENABLE_FIPS == 0
+    {CryptoContext::MD5, "MD5"},
+    {CryptoContext::MMH, "MMH"},
+    {CryptoContext::SIPHASH, "SipHash"},
+#else
+    {CryptoContext::SHA256, "SHA256"},
+#endif
+  };
+
+  printf("%d keys, %d byte URLs\n", n_keys, url_length);
+  for (auto const &t : types) {
+    uint64_t check         = 0;
+    CryptoContext::Setting = t.type;
+    double ns              = generate(urls, check);
+    printf("%-8s %6.1f ns per key, %7.1f MB/s (%016" PRIx64 ")\n", t.name, ns, url_length * 1e3 / ns, check);
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+/** @file
+
+  Micro benchmark of IpMap lookups, before and after freezing the map.
+
+  Marks a number of random disjoint ranges, like a large geo or ACL address list, and looks up
+  random addresses in the red / black trees and then in the frozen map.
+
+    benchmark_IpMap [ranges [lookups]]
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "tscore/IpMap.h"
+#include "tscore/ink_hrtime.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+int n_ranges  = 200000;
+int n_lookups = 5000000;
+
+// Look up all @a addrs, @return the number found.
+size_t
+lookup(IpMap const &map, std::vector<IpEndpoint> const &addrs, ink_hrtime &elapsed)
+{
+  size_t found     = 0;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (auto const &addr : addrs) {
+    void *data = nullptr;
+    if (map.contains(&addr, &data)) {
+      found += reinterpret_cast<uintptr_t>(data) != 0;
+    }
+  }
+  elapsed = ink_get_hrtime_internal() - start;
+  return found;
+}
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+  if (argc > 1) {
+    n_ranges = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    n_lookups = atoi(argv[2]);
+  }
+
+  std::mt19937_64 rng(1);
+  IpMap map;
+
+  // IPv4 ranges of /24 to /16 size, and IPv6 /48s in 2001::/16, three to one.
+  for (int i = 0; i < n_ranges; ++i) {
+    void *data = reinterpret_cast<void *>(1 + rng() % 64);
+    if (i % 4) {
+      uint32_t min = rng() & 0xFFFFFF00;
+      uint32_t max = min + (256 << (rng() % 9)) - 1;
+      map.mark(htonl(min), htonl(max < min ? UINT32_MAX : max), data);
+    } else {
+      IpEndpoint min, max;
+      in6_addr a;
+      uint64_t prefix = (UINT64_C(0x2001) << 48) | (rng() & UINT64_C(0xFFFFFFFF0000));
+      for (int b = 0; b < 8; ++b) {
+        a.s6_addr[b]     = prefix >> (56 - 8 * b);
+        a.s6_addr[b + 8] = 0;
+      }
+      ats_ip6_set(&min, a);
+      for (int b = 6; b < 16; ++b) {
+        a.s6_addr[b] = 0xFF;
+      }
+      ats_ip6_set(&max, a);
+      map.mark(&min, &max, data);
+    }
+  }
+
+  std::vector<IpEndpoint> addrs(n_lookups);
+  for (auto &addr : addrs) {
+    if (rng() % 4) {
+      ats_ip4_set(&addr, static_cast<in_addr_t>(rng()));
+    } else {
+      in6_addr a;
+      for (auto &b : a.s6_addr) {
+        b = rng();
+      }
+      a.s6_addr[0] = 0x20;
+      a.s6_addr[1] = 0x01;
+      a.s6_addr[2] = 0;
+      a.s6_addr[3] = 0;
+      ats_ip6_set(&addr, a);
+    }
+  }
+
+  ink_hrtime tree_time, frozen_time;
+  size_t tree_found = lookup(map, addrs, tree_time);
+  map.freeze();
+  size_t frozen_found = lookup(map, addrs, frozen_time);
+
+  printf("%zu ranges, %d lookups, %zu found\n", map.getCount(), n_lookups, tree_found);
+  printf("tree   %.1f ns per lookup\n", static_cast<double>(tree_time) / n_lookups);
+  printf("frozen %.1f ns per lookup\n", static_cast<double>(frozen_time) / n_lookups);
+  if (tree_found != frozen_found) {
+    printf("MISMATCH: frozen map found %zu\n", frozen_found);
+    return 1;
+  }
+  return 0;
+}
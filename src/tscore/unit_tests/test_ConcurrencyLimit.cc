@@ -0,0 +1,135 @@
+/** @file
+
+    Unit tests for ConcurrencyLimit
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "catch.hpp"
+
+#include "tscore/ConcurrencyLimit.h"
+
+namespace
+{
+const int64_t MSEC = 1000000;
+
+// Keep the server busy with requests of @a latency until @a n requests are done, return the time.
+int64_t
+drive(ts::ConcurrencyLimit &cl, const ts::ConcurrencyLimit::Params &p, int64_t now, int n, int64_t latency, bool success = true)
+{
+  for (int i = 0; i < n; ++i) {
+    while (cl.acquire(p)) {
+    }
+    now += latency / cl.in_flight();
+    cl.release(p, now, latency, success);
+  }
+  return now;
+}
+} // namespace
+
+TEST_CASE("ConcurrencyLimit acquire", "[libts][ConcurrencyLimit]")
+{
+  ts::ConcurrencyLimit::Params p;
+  p.min_limit = 4;
+  ts::ConcurrencyLimit cl(p);
+
+  REQUIRE(cl.limit() == 4);
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(cl.acquire(p));
+  }
+  REQUIRE(!cl.acquire(p));
+  REQUIRE(cl.in_flight() == 4);
+  REQUIRE(cl.rejected() == 1);
+
+  // A request retrying while it waits is not counted again.
+  REQUIRE(!cl.acquire(p, true, true));
+  REQUIRE(cl.rejected() == 1);
+
+  cl.release(p, 0, 10 * MSEC, true);
+  REQUIRE(cl.in_flight() == 3);
+  REQUIRE(cl.requests() == 1);
+  REQUIRE(cl.latency() == 10 * MSEC);
+  REQUIRE(cl.acquire(p));
+
+  // Not enforced, the request is only counted.
+  while (cl.acquire(p)) {
+  }
+  int limit = cl.limit();
+  REQUIRE(cl.acquire(p, false));
+  REQUIRE(cl.in_flight() == limit + 1);
+
+  cl.cancel();
+  REQUIRE(cl.in_flight() == limit);
+  REQUIRE(cl.requests() == 1);
+}
+
+TEST_CASE("ConcurrencyLimit adapts", "[libts][ConcurrencyLimit]")
+{
+  ts::ConcurrencyLimit::Params p;
+  p.min_limit = 4;
+  p.max_limit = 200;
+  ts::ConcurrencyLimit cl(p);
+  int64_t now = 0;
+
+  // A healthy server, the limit grows up to the maximum.
+  now = drive(cl, p, now, 50000, 10 * MSEC);
+  REQUIRE(cl.limit() == p.max_limit);
+  REQUIRE(cl.error_rate() == 0);
+
+  // The server slows down, the limit goes down to the minimum.
+  now         = drive(cl, p, now, 1800, 100 * MSEC);
+  int reduced = cl.limit();
+  REQUIRE(reduced < p.max_limit / 4);
+
+  // And it does not grow back while the server stays slow.
+  now = drive(cl, p, now, 200, 100 * MSEC);
+  REQUIRE(cl.limit() <= reduced);
+
+  // Until the slower latency becomes the new normal.
+  now = drive(cl, p, now, 50000, 100 * MSEC);
+  REQUIRE(cl.limit() > p.max_limit / 2);
+
+  // Errors also lower the limit.
+  ts::ConcurrencyLimit failing(p);
+  now = drive(failing, p, now, 50000, 10 * MSEC);
+  REQUIRE(failing.limit() == p.max_limit);
+  now = drive(failing, p, now, 2000, 10 * MSEC, false);
+  REQUIRE(failing.limit() == p.min_limit);
+  REQUIRE(failing.error_rate() > 0.9);
+  REQUIRE(failing.errors() == 2000);
+
+  // The server recovers.
+  drive(failing, p, now, 50000, 10 * MSEC);
+  REQUIRE(failing.limit() > p.max_limit / 2);
+  REQUIRE(failing.error_rate() < 0.01);
+}
+
+TEST_CASE("ConcurrencyLimit idle", "[libts][ConcurrencyLimit]")
+{
+  ts::ConcurrencyLimit::Params p;
+  p.min_limit = 4;
+  ts::ConcurrencyLimit cl(p);
+
+  // The limit only grows when it is in use.
+  for (int i = 0; i < 10000; ++i) {
+    REQUIRE(cl.acquire(p));
+    cl.release(p, i * MSEC, MSEC, true);
+  }
+  REQUIRE(cl.limit() <= 4);
+}
@@ -0,0 +1,288 @@
+/** @file
+
+    Unit tests for ATSConsistentHash
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "tscore/ConsistentHash.h"
+#include "tscore/HashSip.h"
+
+namespace
+{
+struct TestNodes {
+  explicit TestNodes(int n)
+  {
+    names.resize(n);
+    nodes.resize(n);
+    for (int i = 0; i < n; ++i) {
+      names[i]           = "parent" + std::to_string(i) + ".example.com";
+      nodes[i].name      = const_cast<char *>(names[i].c_str());
+      nodes[i].available = true;
+    }
+  }
+
+  void
+  add_to(ATSConsistentHash &chash, ATSHash64 *h)
+  {
+    for (auto &node : nodes) {
+      chash.insert(&node, 1.0, h);
+    }
+    chash.build(h);
+  }
+
+  int
+  index(const ATSConsistentHashNode *node) const
+  {
+    return node ? static_cast<int>(node - nodes.data()) : -1;
+  }
+
+  std::vector<std::string> names;
+  std::vector<ATSConsistentHashNode> nodes;
+};
+
+uint64_t
+key_hash(int key)
+{
+  ATSHash64Sip24 h;
+  std::string url = "/object/" + std::to_string(key);
+
+  h.update(url.c_str(), url.size());
+  h.final();
+  return h.get();
+}
+
+// First available node for each key, walking the lookup order of the algorithm.
+std::vector<int>
+assign(ATSConsistentHash &chash, const TestNodes &nodes, int keys)
+{
+  std::vector<int> result(keys);
+
+  for (int k = 0; k < keys; ++k) {
+    ATSConsistentHashIter iter;
+    bool wrapped                = false;
+    ATSConsistentHashNode *node = chash.lookup_by_hashval(key_hash(k), &iter, &wrapped);
+    ATSHash64Sip24 h;
+
+    while (node && !node->available) {
+      node = chash.lookup(nullptr, &iter, &wrapped, &h);
+    }
+    result[k] = nodes.index(node);
+  }
+  return result;
+}
+
+const ATSConsistentHashAlgorithm ALGORITHMS[] = {ATS_CONSISTENT_HASH_RING, ATS_CONSISTENT_HASH_MAGLEV, ATS_CONSISTENT_HASH_JUMP};
+const char *ALGORITHM_NAMES[]                 = {"ring", "maglev", "jump"};
+} // namespace
+
+TEST_CASE("ConsistentHash ring", "[libts][ConsistentHash]")
+{
+  TestNodes nodes(8);
+  ATSHash64Sip24 h;
+  ATSConsistentHash chash(64);
+
+  nodes.add_to(chash, &h);
+
+  // Reference: the ring as a map, first inserted node wins on a collision.
+  std::map<uint64_t, int> ring;
+  for (int n = 0; n < 8; ++n) {
+    for (int i = 0; i < 64; ++i) {
+      std::string point = std::to_string(i) + "-" + nodes.names[n];
+      h.update(point.c_str(), point.size());
+      h.final();
+      ring.emplace(h.get(), n);
+      h.clear();
+    }
+  }
+
+  for (int k = 0; k < 1000; ++k) {
+    uint64_t hv = key_hash(k);
+    auto spot   = ring.lower_bound(hv);
+    if (spot == ring.end()) {
+      spot = ring.begin();
+    }
+    REQUIRE(nodes.index(chash.lookup_by_hashval(hv)) == spot->second);
+  }
+  REQUIRE(nodes.index(chash.lookup_by_hashval(UINT64_MAX)) == ring.begin()->second);
+  REQUIRE(nodes.index(chash.lookup_by_hashval(0)) == ring.begin()->second);
+}
+
+TEST_CASE("ConsistentHash empty", "[libts][ConsistentHash]")
+{
+  for (auto algo : ALGORITHMS) {
+    ATSConsistentHash chash(16, nullptr, algo);
+    ATSHash64Sip24 h;
+    bool wrapped = false;
+
+    chash.build(&h);
+    REQUIRE(chash.lookup_by_hashval(42) == nullptr);
+    REQUIRE(chash.lookup("/foo", nullptr, &wrapped, &h) == nullptr);
+    REQUIRE(chash.lookup_available("/foo", nullptr, &wrapped, &h) == nullptr);
+  }
+}
+
+TEST_CASE("ConsistentHash lookup order", "[libts][ConsistentHash]")
+{
+  for (size_t a = 0; a < 3; ++a) {
+    SECTION(ALGORITHM_NAMES[a])
+    {
+      TestNodes nodes(7);
+      ATSHash64Sip24 h;
+      ATSConsistentHash chash(32, nullptr, ALGORITHMS[a]);
+
+      nodes.add_to(chash, &h);
+
+      // Every node is visited before the lookup ends.
+      for (int k = 0; k < 100; ++k) {
+        ATSConsistentHashIter iter;
+        bool wrapped                = false;
+        ATSConsistentHashNode *node = chash.lookup_by_hashval(key_hash(k), &iter, &wrapped);
+        std::set<int> seen;
+
+        while (node) {
+          seen.insert(nodes.index(node));
+          node = chash.lookup(nullptr, &iter, &wrapped, &h);
+        }
+        REQUIRE(wrapped);
+        REQUIRE(seen.size() == 7);
+      }
+
+      // All nodes down, the lookup ends.
+      for (auto &node : nodes.nodes) {
+        node.available = false;
+      }
+      bool wrapped = false;
+      REQUIRE(chash.lookup_available("/foo", nullptr, &wrapped, &h) == nullptr);
+    }
+  }
+}
+
+TEST_CASE("ConsistentHash distribution", "[libts][ConsistentHash]")
+{
+  const int N_NODES = 10;
+  const int N_KEYS  = 20000;
+
+  for (size_t a = 0; a < 3; ++a) {
+    SECTION(ALGORITHM_NAMES[a])
+    {
+      TestNodes nodes(N_NODES);
+      ATSHash64Sip24 h;
+      ATSConsistentHash chash(1024, nullptr, ALGORITHMS[a]);
+
+      nodes.add_to(chash, &h);
+
+      std::vector<int> before = assign(chash, nodes, N_KEYS);
+      std::vector<int> count(N_NODES, 0);
+      for (int n : before) {
+        REQUIRE(n >= 0);
+        ++count[n];
+      }
+      for (int c : count) {
+        REQUIRE(c > N_KEYS / N_NODES / 2);
+        REQUIRE(c < N_KEYS / N_NODES * 2);
+      }
+
+      // Only the keys of a down node move, and they are spread over the remaining nodes.
+      nodes.nodes[3].available = false;
+      std::vector<int> after   = assign(chash, nodes, N_KEYS);
+      std::set<int> targets;
+      for (int k = 0; k < N_KEYS; ++k) {
+        if (before[k] == 3) {
+          REQUIRE(after[k] != 3);
+          targets.insert(after[k]);
+        } else {
+          REQUIRE(after[k] == before[k]);
+        }
+      }
+      REQUIRE(targets.size() > N_NODES / 2);
+    }
+  }
+}
+
+TEST_CASE("ConsistentHash weights", "[libts][ConsistentHash]")
+{
+  for (size_t a = 0; a < 3; ++a) {
+    SECTION(ALGORITHM_NAMES[a])
+    {
+      TestNodes nodes(2);
+      ATSHash64Sip24 h;
+      ATSConsistentHash chash(1024, nullptr, ALGORITHMS[a]);
+
+      chash.insert(&nodes.nodes[0], 1.0, &h);
+      chash.insert(&nodes.nodes[1], 3.0, &h);
+      chash.build(&h);
+
+      std::vector<int> owner = assign(chash, nodes, 10000);
+      int heavy              = std::count(owner.begin(), owner.end(), 1);
+      REQUIRE(heavy > 6500);
+      REQUIRE(heavy < 8500);
+    }
+  }
+}
+
+TEST_CASE("ConsistentHash performance", "[libts][ConsistentHash][performance]")
+{
+  const int N_NODES   = 250;
+  const int N_LOOKUPS = 1000000;
+  std::vector<uint64_t> keys(4096);
+
+  for (size_t k = 0; k < keys.size(); ++k) {
+    keys[k] = key_hash(k);
+  }
+
+  for (size_t a = 0; a < 3; ++a) {
+    TestNodes nodes(N_NODES);
+    ATSHash64Sip24 h;
+    ATSConsistentHash chash(1024, nullptr, ALGORITHMS[a]);
+    uintptr_t sum = 0;
+
+    nodes.add_to(chash, &h);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N_LOOKUPS; ++i) {
+      sum += reinterpret_cast<uintptr_t>(chash.lookup_by_hashval(keys[i & (keys.size() - 1)]));
+    }
+    auto delta = std::chrono::high_resolution_clock::now() - start;
+
+    // Fraction of keys which move when one node goes down, ideally 1 / N_NODES.
+    std::vector<int> before  = assign(chash, nodes, keys.size());
+    nodes.nodes[0].available = false;
+    std::vector<int> after   = assign(chash, nodes, keys.size());
+    int moved                = 0;
+    for (size_t k = 0; k < keys.size(); ++k) {
+      moved += before[k] != after[k];
+    }
+
+    std::cout << ALGORITHM_NAMES[a] << ": " << std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count() / N_LOOKUPS
+              << "ns per lookup with " << N_NODES << " nodes, " << (100.0 * moved / keys.size())
+              << "% of keys moved when one node is down" << std::endl;
+    REQUIRE(sum != 0);
+  }
+}
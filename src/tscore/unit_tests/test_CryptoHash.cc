@@ -0,0 +1,117 @@
+/** @file
+
+    Unit tests for CryptoContext and the 128 bit SipHash context.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "catch.hpp"
+
+#include <string>
+
+#include "tscore/CryptoHash.h"
+#include "tscore/HashSip.h"
+
+namespace
+{
+std::string
+to_hex(CryptoHash const &hash)
+{
+  char buff[CRYPTO_HEX_SIZE];
+  std::string s = hash.toHexStr(buff);
+  for (auto &c : s) {
+    c = tolower(c);
+  }
+  return s.substr(0, 32);
+}
+
+// Reference SipHash-2-4 key and messages, 00 01 02 ...
+const unsigned char KEY[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+std::string
+reference_message(int n)
+{
+  std::string s;
+  for (int i = 0; i < n; ++i) {
+    s += static_cast<char>(i);
+  }
+  return s;
+}
+} // namespace
+
+TEST_CASE("SipHash 128", "[libts][CryptoHash]")
+{
+  struct {
+    int length;
+    char const *hash;
+  } const vectors[] = {
+    {0, "a3817f04ba25a8e66df67214c7550293"},  {1, "da87c1d86b99af44347659119b22fc45"},
+    {2, "8177228da4a45dc7fca38bdef60affe4"},  {15, "5493e99933b0a8117e08ec0f97cfc3d9"},
+    {63, "5150d1772f50834a503e069a973fbd7c"},
+  };
+
+  for (auto const &v : vectors) {
+    std::string msg = reference_message(v.length);
+    CryptoHash hash;
+    SipHashContext ctx(KEY);
+    ctx.hash_immediate(hash, msg.data(), msg.size());
+    CHECK(to_hex(hash) == v.hash);
+  }
+
+  // Split updates must give the same result, whatever the split.
+  std::string msg = reference_message(63);
+  for (int split = 0; split <= 63; ++split) {
+    CryptoHash hash;
+    SipHashContext ctx(KEY);
+    ctx.update(msg.data(), split);
+    ctx.update(msg.data() + split, 63 - split);
+    ctx.finalize(hash);
+    CHECK(to_hex(hash) == "5150d1772f50834a503e069a973fbd7c");
+  }
+
+  CryptoHash hash;
+  SipHashContext ctx(KEY);
+  for (char c : msg) {
+    ctx.update(&c, 1);
+  }
+  ctx.finalize(hash);
+  CHECK(to_hex(hash) == "5150d1772f50834a503e069a973fbd7c");
+}
+
+#if TS_ENABLE_FIPS == 0
+TEST_CASE("CryptoContext SipHash", "[libts][CryptoHash]")
+{
+  static char const URL[] = "http://example.com/index.html";
+  CryptoHash sip, md5, hash;
+
+  SipHashContext().hash_immediate(sip, URL, sizeof(URL) - 1);
+  CHECK(to_hex(sip) == "96485ade12284d2a175016c694aaef72");
+  CryptoContext().hash_immediate(md5, URL, sizeof(URL) - 1);
+
+  CryptoContext::HashType saved = CryptoContext::Setting;
+  CryptoContext::Setting        = CryptoContext::SIPHASH;
+  CryptoContext().hash_immediate(hash, URL, sizeof(URL) - 1);
+  CHECK(hash == sip);
+  CryptoContext::Setting = saved;
+
+  CryptoContext().hash_immediate(hash, URL, sizeof(URL) - 1);
+  CHECK(hash == md5);
+  CHECK(hash != sip);
+}
+#endif
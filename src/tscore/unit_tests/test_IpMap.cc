@@ -22,7 +22,10 @@
 */
 
 #include "tscore/IpMap.h"
+#include <functional>
+#include <random>
 #include <sstream>
+#include <vector>
 #include <catch.hpp>
 
 std::ostream &
@@ -603,3 +606,146 @@ TEST_CASE("IpMap CloseIntersection", "[libts][ipmap]")
 
   CHECK(map.getCount() == 13);
 }
+
+TEST_CASE("IpMap Adjacent", "[libts][ipmap]")
+{
+  IpMap map;
+  void *const markA = reinterpret_cast<void *>(1);
+  void *const markB = reinterpret_cast<void *>(2);
+
+  // Marking up to the start of a span with different data leaves the span alone.
+  map.mark(htonl(100), htonl(199), markA);
+  map.mark(htonl(50), htonl(99), markB);
+  CHECK(map.getCount() == 2);
+  map.mark(htonl(10), htonl(20), markA);
+  map.mark(htonl(21), htonl(49), markA);
+  CHECK(map.getCount() == 3);
+
+  void *mark = nullptr;
+  CHECK(map.contains(htonl(49), &mark));
+  CHECK(mark == markA);
+  CHECK(map.contains(htonl(50), &mark));
+  CHECK(mark == markB);
+  CHECK(map.contains(htonl(100), &mark));
+  CHECK(mark == markA);
+}
+
+TEST_CASE("IpMap Freeze", "[libts][ipmap]")
+{
+  std::mt19937_64 rng(13);
+  IpMap map;
+  std::vector<IpEndpoint> probes;
+
+  auto random_v4 = [&]() -> IpEndpoint {
+    IpEndpoint addr;
+    // Clustered in a few /8s, like real address lists.
+    ats_ip4_set(&addr, htonl(((10 + rng() % 4) << 24) | (rng() & 0xFFFFFF)));
+    return addr;
+  };
+  auto random_v6 = [&]() -> IpEndpoint {
+    IpEndpoint addr;
+    in6_addr a;
+    for (auto &b : a.s6_addr) {
+      b = rng();
+    }
+    a.s6_addr[0] = 0x20;
+    a.s6_addr[1] = 0x01;
+    ats_ip6_set(&addr, a);
+    return addr;
+  };
+  auto add_ranges = [&](std::function<IpEndpoint()> const &random_addr) {
+    for (int i = 0; i < 5000; ++i) {
+      IpEndpoint a = random_addr();
+      IpEndpoint b = random_addr();
+      if (ats_ip_addr_cmp(&b, &a) < 0) {
+        std::swap(a, b);
+      }
+      void *mark = reinterpret_cast<void *>(rng() % 8);
+      switch (rng() % 8) {
+      case 0:
+        map.unmark(&a, &b);
+        break;
+      case 1:
+        map.fill(&a, &b, mark);
+        break;
+      case 2:
+        // Single address.
+        map.mark(&a, &a, mark);
+        break;
+      default:
+        map.mark(&a, &b, mark);
+        break;
+      }
+      probes.push_back(a);
+      probes.push_back(b);
+    }
+  };
+
+  // Empty.
+  map.freeze();
+  REQUIRE(map.isFrozen());
+  CHECK_FALSE(map.contains(htonl(INADDR_LOOPBACK)));
+
+  add_ranges(random_v4);
+  add_ranges(random_v6);
+  // Probe the range boundaries and the addresses next to them, and random addresses.
+  for (auto &node : map) {
+    for (sockaddr const *sa : {node.min(), node.max()}) {
+      IpEndpoint addr, before, after;
+      addr.assign(sa);
+      before.assign(sa);
+      after.assign(sa);
+      if (AF_INET == sa->sa_family) {
+        in_addr_t host = ntohl(ats_ip4_addr_cast(sa));
+        ats_ip4_set(&before, htonl(host - 1));
+        ats_ip4_set(&after, htonl(host + 1));
+      } else {
+        --before.sin6.sin6_addr.s6_addr[15];
+        ++after.sin6.sin6_addr.s6_addr[15];
+      }
+      probes.insert(probes.end(), {addr, before, after});
+    }
+  }
+  for (int i = 0; i < 20000; ++i) {
+    probes.push_back(random_v4());
+    probes.push_back(random_v6());
+  }
+  for (char const *text : {"0.0.0.0", "255.255.255.255", "::", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"}) {
+    IpEndpoint addr;
+    ats_ip_pton(text, &addr);
+    probes.push_back(addr);
+  }
+
+  std::vector<std::pair<bool, void *>> expected;
+  for (auto &addr : probes) {
+    void *mark = nullptr;
+    bool found = map.contains(&addr, &mark);
+    expected.emplace_back(found, mark);
+  }
+
+  map.freeze();
+  REQUIRE(map.isFrozen());
+  for (size_t i = 0; i < probes.size(); ++i) {
+    void *mark = nullptr;
+    bool found = map.contains(&probes[i], &mark);
+    INFO("probe " << probes[i]);
+    REQUIRE(found == expected[i].first);
+    REQUIRE(mark == expected[i].second);
+  }
+
+  // Changes thaw the map.
+  IpEndpoint addr = random_v4();
+  void *const markX = reinterpret_cast<void *>(99);
+  map.mark(&addr, markX);
+  CHECK_FALSE(map.isFrozen());
+  CHECK_THAT(map, IsMarkedWith(addr, markX));
+
+  // The whole IPv4 space.
+  map.clear();
+  map.mark(INADDR_ANY, INADDR_BROADCAST, markX);
+  map.freeze();
+  CHECK_THAT(map, IsMarkedWith(addr, markX));
+  CHECK(map.contains(INADDR_ANY));
+  CHECK(map.contains(INADDR_BROADCAST));
+  CHECK_FALSE(map.contains(&probes.back()));
+}
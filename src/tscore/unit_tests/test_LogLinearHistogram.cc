@@ -0,0 +1,99 @@
+/** @file
+
+    Unit tests for LogLinearHistogram
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "catch.hpp"
+
+#include "tscore/LogLinearHistogram.h"
+
+using Histogram = ts::LogLinearHistogram<3, 36>;
+
+TEST_CASE("LogLinearHistogram buckets", "[libts][histogram]")
+{
+  // Small values are exact.
+  for (uint64_t v = 0; v < Histogram::SUB_BUCKETS; ++v) {
+    REQUIRE(Histogram::bucket(v) == v);
+    REQUIRE(Histogram::lower_bound(v) == v);
+    REQUIRE(Histogram::upper_bound(v) == v);
+  }
+
+  REQUIRE(Histogram::bucket(8) == 8);
+  REQUIRE(Histogram::bucket(15) == 15);
+  REQUIRE(Histogram::bucket(16) == 16);
+  REQUIRE(Histogram::bucket(17) == 16);
+  REQUIRE(Histogram::bucket(18) == 17);
+  REQUIRE(Histogram::upper_bound(16) == 17);
+
+  // Buckets are contiguous and every value is in its bucket, with bounded error.
+  for (unsigned idx = 0; idx + 1 < Histogram::N_BUCKETS; ++idx) {
+    REQUIRE(Histogram::upper_bound(idx) + 1 == Histogram::lower_bound(idx + 1));
+  }
+  for (uint64_t v = 1; v < Histogram::MAX_VALUE; v = v * 3 + 1) {
+    unsigned idx = Histogram::bucket(v);
+    REQUIRE(Histogram::lower_bound(idx) <= v);
+    REQUIRE(Histogram::upper_bound(idx) >= v);
+    REQUIRE(Histogram::upper_bound(idx) - Histogram::lower_bound(idx) <= v / Histogram::SUB_BUCKETS);
+  }
+
+  REQUIRE(Histogram::bucket(Histogram::MAX_VALUE) == Histogram::N_BUCKETS - 1);
+  REQUIRE(Histogram::bucket(UINT64_MAX) == Histogram::N_BUCKETS - 1);
+  REQUIRE(Histogram::upper_bound(Histogram::N_BUCKETS - 1) == Histogram::MAX_VALUE);
+}
+
+TEST_CASE("LogLinearHistogram percentiles", "[libts][histogram]")
+{
+  Histogram h = {};
+
+  REQUIRE(h.count() == 0);
+  REQUIRE(h.percentile(50) == 0);
+
+  for (uint64_t v = 1; v <= 1000; ++v) {
+    h.record(v);
+  }
+  REQUIRE(h.count() == 1000);
+
+  uint64_t p50 = h.percentile(50);
+  uint64_t p99 = h.percentile(99);
+  REQUIRE(p50 >= 500);
+  REQUIRE(p50 <= 500 + 500 / 8);
+  REQUIRE(p99 >= 990);
+  REQUIRE(p99 <= 990 + 990 / 8);
+  REQUIRE(h.percentile(100) >= 1000);
+  REQUIRE(h.percentile(0) == 1);
+
+  Histogram base = h;
+  for (int i = 0; i < 100; ++i) {
+    h.record(1000000);
+  }
+  Histogram delta = h;
+  delta.subtract(base);
+  REQUIRE(delta.count() == 100);
+  REQUIRE(delta.percentile(50) >= 1000000);
+
+  Histogram sum = {};
+  sum.add(base);
+  sum.add(delta);
+  REQUIRE(sum.count() == h.count());
+
+  h.clear();
+  REQUIRE(h.count() == 0);
+}